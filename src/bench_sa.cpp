@@ -0,0 +1,431 @@
+/**
+ * @file    src/bench_sa.cpp
+ * @section LICENCE
+ *
+ * This file is part of fSAIS v0.1.0
+ * See: https://github.com/dominikkempa/fsais
+ *
+ * Copyright (C) 2016-2020
+ *   Dominik Kempa <dominik.kempa (at) gmail.com>
+ *   Juha Karkkainen <juha.karkkainen (at) cs.helsinki.fi>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ **/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <ctime>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <algorithm>
+#include <getopt.h>
+#include <unistd.h>
+
+#include "fsais_src/em_compute_sa.hpp"
+#include "fsais_src/utils.hpp"
+#include "uint40.hpp"
+
+
+char *program_name;
+
+void usage(int status) {
+  printf(
+
+"Usage: %s [OPTION]...\n"
+"Generate a fixed set of synthetic corpora, compute their suffix arrays\n"
+"under several RAM budgets and print the results (one JSON object per\n"
+"line) to standard output.\n"
+"\n"
+"Mandatory arguments to long options are mandatory for short options too.\n"
+"  -d, --dir=DIR           store texts and suffix arrays in DIR. Default: .\n"
+"  -h, --help              display this help and exit\n"
+"  -m, --mem=LIST          comma-separated list of RAM budgets. Metric and\n"
+"                          IEC suffixes are recognized (see construct_sa).\n"
+"                          Default: 8Mi,64Mi,512Mi\n"
+"  -n, --length=LENGTH     length of each corpus (in symbols). Default: 8Mi\n"
+"  -o, --output=OUTFILE    append the results to OUTFILE instead of\n"
+"                          printing them to standard output\n"
+"  -s, --seed=SEED         seed used to generate the corpora. Default: 1\n",
+
+    program_name);
+
+  std::exit(status);
+}
+
+template<typename int_type>
+bool parse_number(char *str, int_type *ret) {
+  *ret = 0;
+  std::uint64_t n_digits = 0;
+  std::uint64_t str_len = std::strlen(str);
+  while (n_digits < str_len && std::isdigit(str[n_digits])) {
+    std::uint64_t digit = str[n_digits] - '0';
+    *ret = (*ret) * 10 + digit;
+    ++n_digits;
+  }
+
+  if (n_digits == 0)
+    return false;
+
+  std::uint64_t suffix_length = str_len - n_digits;
+  if (suffix_length > 0) {
+    if (suffix_length > 2)
+      return false;
+
+    for (std::uint64_t j = 0; j < suffix_length; ++j)
+      str[n_digits + j] = std::tolower(str[n_digits + j]);
+    if (suffix_length == 2 && str[n_digits + 1] != 'i')
+      return false;
+
+    switch(str[n_digits]) {
+      case 'k':
+        if (suffix_length == 1)
+          *ret *= 1000;
+        else
+          *ret <<= 10;
+        break;
+      case 'm':
+        if (suffix_length == 1)
+          *ret *= 1000000;
+        else
+          *ret <<= 20;
+        break;
+      case 'g':
+        if (suffix_length == 1)
+          *ret *= 1000000000;
+        else
+          *ret <<= 30;
+        break;
+      case 't':
+        if (suffix_length == 1)
+          *ret *= 1000000000000;
+        else
+          *ret <<= 40;
+        break;
+      default:
+        return false;
+    }
+  }
+
+  return true;
+}
+
+bool parse_number_list(char *str, std::vector<std::uint64_t> &ret) {
+  ret.clear();
+  for (char *tok = std::strtok(str, ","); tok != NULL;
+      tok = std::strtok(NULL, ",")) {
+    std::uint64_t value = 0;
+    if (!parse_number(tok, &value) || value == 0)
+      return false;
+    ret.push_back(value);
+  }
+
+  return !ret.empty();
+}
+
+//=============================================================================
+// Corpus generators. All use rand(). Since the computation also
+// calls rand(), the generator is reseeded before every corpus.
+//=============================================================================
+
+// Uniformly random symbols from [0..sigma).
+template<typename char_type>
+void generate_random(
+    char_type *text,
+    std::uint64_t length,
+    std::uint64_t sigma) {
+  for (std::uint64_t i = 0; i < length; ++i)
+    text[i] = fsais_private::utils::random_int64(0L, sigma - 1);
+}
+
+// Random block of 10^4 letters repeated
+// with mutation rate 10^{-4} per symbol.
+template<typename char_type>
+void generate_repetitive(
+    char_type *text,
+    std::uint64_t length) {
+  std::uint64_t block_length = std::min(length, (std::uint64_t)10000);
+  for (std::uint64_t i = 0; i < block_length; ++i)
+    text[i] = 'a' + fsais_private::utils::random_int32(0, 25);
+  for (std::uint64_t i = block_length; i < length; ++i) {
+    if (fsais_private::utils::random_int32(0, 9999) == 0)
+      text[i] = 'a' + fsais_private::utils::random_int32(0, 25);
+    else text[i] = text[i - block_length];
+  }
+}
+
+// Prefix of the infinite Fibonacci word over {a, b}.
+template<typename char_type>
+void generate_fibonacci(
+    char_type *text,
+    std::uint64_t length) {
+  if (length == 0) return;
+  text[0] = 'a';
+  std::uint64_t prev_length = 1;
+  std::uint64_t cur_length = 1;
+  if (length > 1) {
+    text[1] = 'b';
+    cur_length = 2;
+  }
+
+  // F_{k+1} = F_k F_{k-1}.
+  while (cur_length < length) {
+    std::uint64_t copy_length = std::min(prev_length, length - cur_length);
+    std::copy(text, text + copy_length, text + cur_length);
+    prev_length = cur_length;
+    cur_length += copy_length;
+  }
+}
+
+// Random segments over {A, C, G, T} interleaved with approximate
+// copies (1% mutations) of earlier segments, both of length 10^2..10^4.
+template<typename char_type>
+void generate_dna_like(
+    char_type *text,
+    std::uint64_t length) {
+  static const char acgt[] = "ACGT";
+  std::uint64_t i = 0;
+  while (i < length) {
+    std::uint64_t segment_length = std::min(length - i,
+        (std::uint64_t)fsais_private::utils::random_int64(100L, 10000L));
+    if (i >= segment_length && fsais_private::utils::random_int32(0, 1)) {
+      std::uint64_t src = fsais_private::utils::random_int64(0L, i - segment_length);
+      for (std::uint64_t j = 0; j < segment_length; ++j) {
+        if (fsais_private::utils::random_int32(0, 99) == 0)
+          text[i + j] = acgt[fsais_private::utils::random_int32(0, 3)];
+        else text[i + j] = text[src + j];
+      }
+    } else {
+      for (std::uint64_t j = 0; j < segment_length; ++j)
+        text[i + j] = acgt[fsais_private::utils::random_int32(0, 3)];
+    }
+    i += segment_length;
+  }
+}
+
+// Token ids from [0..sigma) with (approximately) Zipfian
+// frequencies, as in tokenized natural language text.
+template<typename char_type>
+void generate_zipf_tokens(
+    char_type *text,
+    std::uint64_t length,
+    std::uint64_t sigma) {
+  long double log_sigma = std::log((long double)sigma);
+  for (std::uint64_t i = 0; i < length; ++i) {
+    long double u = fsais_private::utils::random_int64(0L, (1L << 30) - 1) / (long double)(1L << 30);
+    text[i] = std::min(sigma - 1, (std::uint64_t)std::exp(u * log_sigma) - 1);
+  }
+}
+
+//=============================================================================
+// Benchmark driver.
+//=============================================================================
+
+template<typename char_type>
+void bench_corpus(
+    std::string corpus_name,
+    const char_type *text,
+    std::uint64_t text_length,
+    std::uint64_t text_alphabet_size,
+    std::vector<std::uint64_t> &ram_budgets,
+    std::string dir,
+    std::FILE *out) {
+  typedef uint40 text_offset_type;
+
+  std::string text_filename = dir + "/bench_" + corpus_name + "." +
+    fsais_private::utils::random_string_hash();
+  std::string output_filename = text_filename + ".sa" +
+    fsais_private::utils::intToStr(sizeof(text_offset_type));
+  fsais_private::utils::write_to_file(text, text_length, text_filename);
+
+  for (std::uint64_t j = 0; j < ram_budgets.size(); ++j) {
+    std::uint64_t ram_use = ram_budgets[j];
+    fsais_private::utils::initialize_stats();
+    // The input text counts towards the disk usage.
+    fsais_private::utils::current_disk_allocation =
+      text_length * sizeof(char_type);
+
+    long double start = fsais_private::utils::wclock();
+    fsais_private::em_compute_sa<char_type, text_offset_type>(
+        ram_use, text_alphabet_size, text_filename, output_filename);
+    long double total_time = fsais_private::utils::wclock() - start;
+
+    std::uint64_t bytes_read = fsais_private::utils::get_total_bytes_read();
+    std::uint64_t bytes_written = fsais_private::utils::get_total_bytes_written();
+    std::uint64_t io_volume = bytes_read + bytes_written;
+    fprintf(out, "{\"version\": \"0.1.0\", "
+        "\"corpus\": \"%s\", "
+        "\"text_length\": %lu, "
+        "\"text_alphabet_size\": %lu, "
+        "\"sizeof_char_type\": %lu, "
+        "\"sizeof_text_offset_type\": %lu, "
+        "\"ram_use\": %lu, "
+        "\"time_sec\": %.3Lf, "
+        "\"us_per_symbol\": %.4Lf, "
+        "\"bytes_read\": %lu, "
+        "\"bytes_written\": %lu, "
+        "\"io_bytes_per_symbol\": %.3Lf, "
+        "\"peak_ram_bytes\": %lu, "
+        "\"peak_disk_bytes\": %lu}\n",
+        corpus_name.c_str(), text_length, text_alphabet_size,
+        sizeof(char_type), sizeof(text_offset_type), ram_use,
+        total_time, (1000000.L * total_time) / text_length,
+        bytes_read, bytes_written, (1.L * io_volume) / text_length,
+        fsais_private::utils::get_peak_ram_allocation(),
+        fsais_private::utils::get_peak_disk_allocation());
+    std::fflush(out);
+    fsais_private::utils::file_delete(output_filename);
+  }
+
+  fsais_private::utils::file_delete(text_filename);
+}
+
+int main(int argc, char **argv) {
+  program_name = argv[0];
+
+  static struct option long_options[] = {
+    {"dir",      required_argument, NULL, 'd'},
+    {"help",     no_argument,       NULL, 'h'},
+    {"mem",      required_argument, NULL, 'm'},
+    {"length",   required_argument, NULL, 'n'},
+    {"output",   required_argument, NULL, 'o'},
+    {"seed",     required_argument, NULL, 's'},
+    {NULL,       0,                 NULL, 0}
+  };
+
+  std::string dir(".");
+  std::string output_filename("");
+  std::uint64_t text_length = ((std::uint64_t)8 << 20);
+  std::uint64_t seed = 1;
+  std::vector<std::uint64_t> ram_budgets;
+  ram_budgets.push_back((std::uint64_t)8 << 20);
+  ram_budgets.push_back((std::uint64_t)64 << 20);
+  ram_budgets.push_back((std::uint64_t)512 << 20);
+
+  // Parse command-line options.
+  int c;
+  while ((c = getopt_long(argc, argv, "d:hm:n:o:s:",
+          long_options, NULL)) != -1) {
+    switch(c) {
+      case 'd':
+        dir = std::string(optarg);
+        break;
+      case 'h':
+        usage(EXIT_FAILURE);
+        break;
+      case 'm':
+        if (!parse_number_list(optarg, ram_budgets)) {
+          fprintf(stderr, "Error: parsing the list of "
+              "RAM budgets (%s) failed\n\n", optarg);
+          usage(EXIT_FAILURE);
+        }
+        break;
+      case 'n':
+        if (!parse_number(optarg, &text_length) || text_length == 0) {
+          fprintf(stderr, "Error: parsing corpus "
+              "length (%s) failed\n\n", optarg);
+          usage(EXIT_FAILURE);
+        }
+        break;
+      case 'o':
+        output_filename = std::string(optarg);
+        break;
+      case 's':
+        if (!parse_number(optarg, &seed)) {
+          fprintf(stderr, "Error: parsing seed "
+              "(%s) failed\n\n", optarg);
+          usage(EXIT_FAILURE);
+        }
+        break;
+      default:
+        usage(EXIT_FAILURE);
+        break;
+    }
+  }
+
+  std::FILE *out = stdout;
+  if (!output_filename.empty())
+    out = fsais_private::utils::file_open(output_filename, "a");
+
+  dir = fsais_private::utils::absolute_path(dir);
+
+  // Byte corpora use the same alphabet size as construct_sa.
+  {
+    std::uint8_t *text = new std::uint8_t[text_length];
+    static const std::uint64_t sigmas[] = { 2, 4, 26, 256 };
+    for (std::uint64_t j = 0; j < 4; ++j) {
+      srand(seed + j);
+      generate_random(text, text_length, sigmas[j]);
+      bench_corpus<std::uint8_t>("random_sigma_" +
+          fsais_private::utils::intToStr(sigmas[j]), text,
+          text_length, 256, ram_budgets, dir, out);
+    }
+    srand(seed + 4);
+    generate_repetitive(text, text_length);
+    bench_corpus<std::uint8_t>("repetitive", text,
+        text_length, 256, ram_budgets, dir, out);
+    generate_fibonacci(text, text_length);
+    bench_corpus<std::uint8_t>("fibonacci", text,
+        text_length, 256, ram_budgets, dir, out);
+    srand(seed + 5);
+    generate_dna_like(text, text_length);
+    bench_corpus<std::uint8_t>("dna_like", text,
+        text_length, 256, ram_budgets, dir, out);
+    delete[] text;
+  }
+
+  // 16-bit symbols.
+  {
+    static const std::uint64_t sigma16 = ((std::uint64_t)1 << 16);
+    std::uint16_t *text = new std::uint16_t[text_length];
+    srand(seed + 7);
+    generate_random(text, text_length, sigma16);
+    bench_corpus<std::uint16_t>("random_sigma_" +
+        fsais_private::utils::intToStr(sigma16), text,
+        text_length, sigma16, ram_budgets, dir, out);
+    delete[] text;
+  }
+
+  // Large integer alphabet.
+  {
+    static const std::uint64_t large_sigma = ((std::uint64_t)1 << 20);
+    std::uint32_t *text = new std::uint32_t[text_length];
+    srand(seed + 6);
+    generate_random(text, text_length, large_sigma);
+    bench_corpus<std::uint32_t>("random_sigma_" +
+        fsais_private::utils::intToStr(large_sigma), text,
+        text_length, large_sigma, ram_budgets, dir, out);
+    static const std::uint64_t token_sigma = ((std::uint64_t)1 << 24);
+    srand(seed + 8);
+    generate_zipf_tokens(text, text_length, token_sigma);
+    bench_corpus<std::uint32_t>("zipf_tokens_" +
+        fsais_private::utils::intToStr(token_sigma), text,
+        text_length, token_sigma, ram_budgets, dir, out);
+    delete[] text;
+  }
+
+  if (out != stdout)
+    std::fclose(out);
+}
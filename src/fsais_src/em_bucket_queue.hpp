@@ -0,0 +1,355 @@
+/**
+ * @file    fsais_src/em_bucket_queue.hpp
+ * @section LICENCE
+ *
+ * This file is part of fSAIS v0.1.0
+ * See: https://github.com/dominikkempa/fsais
+ *
+ * Copyright (C) 2016-2020
+ *   Dominik Kempa <dominik.kempa (at) gmail.com>
+ *   Juha Karkkainen <juha.karkkainen (at) cs.helsinki.fi>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ **/
+
+#ifndef __FSAIS_SRC_EM_BUCKET_QUEUE_HPP_INCLUDED
+#define __FSAIS_SRC_EM_BUCKET_QUEUE_HPP_INCLUDED
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <limits>
+#include <type_traits>
+#include <numeric>
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+#include "em_radix_heap.hpp"
+#include "packed_pair.hpp"
+#include "utils.hpp"
+#include "heap_stats.hpp"
+#include "hardware_profile.hpp"
+
+
+namespace fsais_private {
+
+// A drop-in replacement for em_radix_heap for small key
+// universes. Every key has its own em_queue (bucket), so
+// there is no redistribution: extract_min only advances the
+// pointer to the smallest non-empty bucket. This is efficient
+// when, as in the inducing sweeps, keys are pushed at or beyond
+// the current minimum. The constructor takes the same radix_logs
+// as em_radix_heap, but only uses their sum to determine the
+// number of buckets (keys must be smaller than 2^sum).
+template<typename KeyType, typename ValueType>
+class em_bucket_queue {
+  static_assert(sizeof(KeyType) <= 8,
+      "em_bucket_queue: sizeof(KeyType) > 8!");
+  static_assert(std::is_unsigned<KeyType>::value,
+      "em_bucket_queue: KeyType not unsigned!");
+
+  public:
+    typedef KeyType key_type;
+    typedef ValueType value_type;
+    typedef em_bucket_queue<key_type, value_type> bucket_queue_type;
+
+    // Every bucket needs at least one RAM queue and, once it
+    // spills, its own file (i.e., an open file descriptor), so the
+    // bucket queue is only used for small alphabets. The limit is
+    // well under the common limit of 1024 open files per process.
+    static const std::uint64_t k_max_bucket_count = (1UL << 8);
+
+  private:
+    typedef packed_pair<key_type, value_type> pair_type;
+    typedef ram_queue<pair_type> ram_queue_type;
+    typedef em_queue<pair_type, bucket_queue_type> em_queue_type;
+    typedef em_queue_io<pair_type> em_queue_io_type;
+    friend em_queue_type;
+
+    static const std::uint64_t k_io_queues = em_queue_io_type::k_io_queues;
+
+  private:
+    em_queue_io_type *m_io;
+
+    std::uint64_t m_size;
+    std::uint64_t m_min_bucket_ptr;
+    std::uint64_t m_get_empty_ram_queue_ptr;
+    std::uint64_t m_bucket_count;
+
+    // Internal queues (one per key).
+    pair_type *m_mem;
+    pair_type *m_mem_ptr;
+    em_queue_type **m_queues;
+    std::vector<ram_queue_type*> m_empty_ram_queues;
+
+#ifdef MONITOR_HEAP_STATS
+    heap_stats m_stats;
+#endif
+
+  private:
+    static std::uint64_t compute_bucket_count(
+        std::vector<std::uint64_t> &radix_logs) {
+      std::uint64_t radix_logs_sum =
+        std::accumulate(radix_logs.begin(), radix_logs.end(), 0UL);
+
+      if (radix_logs_sum == 0) {
+        fprintf(stderr, "\nError: radix_logs_sum == 0 "
+            "in bucket_queue constructor!\n");
+        std::exit(EXIT_FAILURE);
+      }
+
+      return (1UL << radix_logs_sum);
+    }
+
+    void init(
+        std::uint64_t bucket_count,
+        std::string filename,
+        std::uint64_t n_ram_queues,
+        std::uint64_t items_per_ram_queue) {
+      m_size = 0;
+      m_min_bucket_ptr = 0;
+      m_get_empty_ram_queue_ptr = 0;
+      m_bucket_count = bucket_count;
+
+      // Allocate EM queues.
+      m_queues = new em_queue_type*[m_bucket_count];
+      for (std::uint64_t i = 0; i < m_bucket_count; ++i) {
+        std::string queue_filename = filename + ".queue." +
+          utils::intToStr(i) + "." + utils::random_string_hash();
+        m_queues[i] = new em_queue_type(items_per_ram_queue,
+            queue_filename, this);
+      }
+
+#ifdef MONITOR_HEAP_STATS
+      std::vector<std::uint64_t> queue_level(m_bucket_count, 0UL);
+      m_stats.init("em_bucket_queue", queue_level);
+#endif
+
+      // Request RAM for queues.
+      n_ram_queues = std::max(n_ram_queues, m_bucket_count + 1);
+      std::uint64_t n_all_queues = n_ram_queues + k_io_queues;
+      std::uint64_t toalloc = n_all_queues * items_per_ram_queue;
+      m_mem = utils::allocate_array<pair_type>(toalloc);
+      m_mem_ptr = m_mem;
+
+      // Allocate empty RAM queues.
+      for (std::uint64_t j = 0; j < n_ram_queues; ++j) {
+        m_empty_ram_queues.push_back(
+            new ram_queue_type(items_per_ram_queue, m_mem_ptr));
+        m_mem_ptr += items_per_ram_queue;
+      }
+
+      // Start I/O thread.
+      m_io = new em_queue_io_type(items_per_ram_queue, m_mem_ptr);
+      m_mem_ptr += k_io_queues * items_per_ram_queue;
+    }
+
+    // Note: the read request is blocking!
+    void issue_read_request(
+        ram_queue_type *q,
+        std::uint64_t pos,
+        std::FILE *f) {
+      m_io->issue_read_request(q, pos, f);
+
+#ifdef MONITOR_HEAP_STATS
+      m_stats.reload(q->size_in_bytes());
+#endif
+    }
+
+    // Note: the write request is non-blocking!
+    // Returns the new, empty ram queue.
+    ram_queue_type* issue_write_request(ram_queue_type *q, std::FILE *f) {
+
+#ifdef MONITOR_HEAP_STATS
+      m_stats.spill(q->size_in_bytes());
+#endif
+
+      return m_io->issue_write_request(q, f);
+    }
+
+    // When out of RAM, spill the bucket with the largest key
+    // (i.e., the one that will be extracted last).
+    ram_queue_type* get_empty_ram_queue() {
+      if (m_empty_ram_queues.empty()) {
+
+#ifdef SAIS_DEBUG
+        for (std::uint64_t j = m_get_empty_ram_queue_ptr + 1;
+            j < m_bucket_count; ++j) {
+          if (m_queues[j]->full_ram_queue_available()) {
+            fprintf(stderr, "Error: m_get_empty_ram_queue_ptr incorrect!\n");
+            std::exit(EXIT_FAILURE);
+          }
+        }
+#endif
+
+        while (!m_queues[m_get_empty_ram_queue_ptr]->full_ram_queue_available())
+          --m_get_empty_ram_queue_ptr;
+        m_empty_ram_queues.push_back(
+            m_queues[m_get_empty_ram_queue_ptr]->flush_front_ram_queue());
+      }
+
+      ram_queue_type *q = m_empty_ram_queues.back();
+      m_empty_ram_queues.pop_back();
+      return q;
+    }
+
+    void add_empty_ram_queue(ram_queue_type *q) {
+      m_empty_ram_queues.push_back(q);
+    }
+
+  public:
+    em_bucket_queue(
+        std::vector<std::uint64_t> radix_logs,
+        std::string filename,
+        std::uint64_t ram_use) {
+      std::uint64_t bucket_count = compute_bucket_count(radix_logs);
+      std::uint64_t required_ram_queues_count = bucket_count + 1;
+
+      // Decide on the size of a single ram queue and their number.
+      std::uint64_t opt_single_queue_size_bytes =
+        hardware_profile::opt_request_size();
+      if ((required_ram_queues_count + k_io_queues) *
+          opt_single_queue_size_bytes <= ram_use) {
+
+        // Best case, we can allocate at least the required
+        // number of ram queues of optimal size.
+        std::uint64_t ram_for_nonio_ram_queues =
+          ram_use - k_io_queues * opt_single_queue_size_bytes;
+        std::uint64_t n_ram_queues =
+          ram_for_nonio_ram_queues / opt_single_queue_size_bytes;
+        std::uint64_t items_per_ram_queue =
+          utils::disk_block_size<pair_type>(opt_single_queue_size_bytes);
+        init(bucket_count, filename, n_ram_queues, items_per_ram_queue);
+      } else {
+
+        // Not enough RAM to use optimal queue size. We shrink
+        // the queue size and allocate only the required amount.
+        std::uint64_t single_queue_size_bytes =
+          ram_use / (required_ram_queues_count + k_io_queues);
+        std::uint64_t n_ram_queues =
+          required_ram_queues_count;
+        std::uint64_t items_per_ram_queue =
+          utils::disk_block_size<pair_type>(single_queue_size_bytes);
+        init(bucket_count, filename, n_ram_queues, items_per_ram_queue);
+      }
+    }
+
+    em_bucket_queue(
+        std::vector<std::uint64_t> radix_logs,
+        std::string filename,
+        std::uint64_t n_ram_queues,
+        std::uint64_t items_per_ram_queue) {
+      init(compute_bucket_count(radix_logs), filename,
+          n_ram_queues, items_per_ram_queue);
+    }
+
+    inline void push(key_type key, value_type value) {
+      ++m_size;
+      std::uint64_t id = (std::uint64_t)key;
+      if (m_queues[id]->push(pair_type((key_type)key, (value_type)value)))
+        m_get_empty_ram_queue_ptr = std::max(m_get_empty_ram_queue_ptr, id);
+      m_min_bucket_ptr = std::min(m_min_bucket_ptr, id);
+#ifdef MONITOR_HEAP_STATS
+      m_stats.push(id);
+#endif
+    }
+
+    // Return true iff x <= key, where x is the
+    // smallest element currently stored in the queue.
+    inline bool min_compare(key_type key) {
+      if (empty()) return false;
+      std::uint64_t id = std::min((std::uint64_t)key, m_bucket_count - 1);
+      while (m_min_bucket_ptr < id && m_queues[m_min_bucket_ptr]->empty())
+        ++m_min_bucket_ptr;
+      return (m_min_bucket_ptr <= (std::uint64_t)key &&
+          !m_queues[m_min_bucket_ptr]->empty());
+    }
+
+    // Remove and return the item with the smallest key.
+    inline std::pair<key_type, value_type> extract_min() {
+      while (m_queues[m_min_bucket_ptr]->empty())
+        ++m_min_bucket_ptr;
+      em_queue_type *q = m_queues[m_min_bucket_ptr];
+      key_type key = q->front().first;
+      value_type value = q->front().second;
+      q->pop();
+#ifdef MONITOR_HEAP_STATS
+      m_stats.pop(m_min_bucket_ptr);
+#endif
+      if (q->empty()) {
+        q->reset_buffers();
+        q->reset_file();
+      }
+      --m_size;
+      return std::make_pair(key, value);
+    }
+
+    inline std::uint64_t size() const {
+      return m_size;
+    }
+
+    inline bool empty() const {
+      return m_size == 0;
+    }
+
+    inline std::uint64_t io_volume() const {
+      std::uint64_t result = 0;
+      for (std::uint64_t i = 0; i < m_bucket_count; ++i)
+        result += m_queues[i]->io_volume();
+      return result;
+    }
+
+    // Name of the phase using the queue, reported
+    // together with the MONITOR_HEAP_STATS counters.
+    void set_phase_name(std::string phase_name) {
+#ifdef MONITOR_HEAP_STATS
+      m_stats.set_phase_name(phase_name);
+#else
+      (void) phase_name;
+#endif
+    }
+
+    ~em_bucket_queue() {
+#ifdef MONITOR_HEAP_STATS
+      m_stats.print();
+#endif
+
+      // Stop the I/O thread.
+      delete m_io;
+
+      // Clean up.
+      for (std::uint64_t i = 0; i < m_bucket_count; ++i)
+        delete m_queues[i];
+      delete[] m_queues;
+      for (std::uint64_t i = 0; i < m_empty_ram_queues.size(); ++i)
+        delete m_empty_ram_queues[i];
+      utils::deallocate(m_mem);
+    }
+};
+
+}  // namespace fsais_private
+
+#endif  // __FSAIS_SRC_EM_BUCKET_QUEUE_HPP_INCLUDED
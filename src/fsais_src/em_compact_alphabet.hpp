@@ -0,0 +1,199 @@
+/**
+ * @file    fsais_src/em_compact_alphabet.hpp
+ * @section LICENCE
+ *
+ * This file is part of fSAIS v0.1.0
+ * See: https://github.com/dominikkempa/fsais
+ *
+ * Copyright (C) 2016-2020
+ *   Dominik Kempa <dominik.kempa (at) gmail.com>
+ *   Juha Karkkainen <juha.karkkainen (at) cs.helsinki.fi>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ **/
+
+#ifndef __FSAIS_SRC_EM_COMPACT_ALPHABET_HPP_INCLUDED
+#define __FSAIS_SRC_EM_COMPACT_ALPHABET_HPP_INCLUDED
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include "io/async_stream_reader.hpp"
+#include "io/async_stream_writer.hpp"
+#include "utils.hpp"
+
+
+namespace fsais_private {
+
+// Return the alphabet size of the text, i.e.,
+// the largest symbol occurring in it plus one.
+template<typename char_type>
+std::uint64_t em_detect_alphabet_size(
+    std::string text_filename,
+    std::uint64_t &total_io_volume) {
+  std::uint64_t text_length = utils::file_size(text_filename) / sizeof(char_type);
+  fprintf(stderr, "Detect alphabet size... ");
+  long double start = utils::wclock();
+
+  typedef async_stream_reader<char_type> text_reader_type;
+  text_reader_type *text_reader = new text_reader_type(text_filename, (4UL << 20), 4UL);
+  std::uint64_t max_char = 0;
+  for (std::uint64_t j = 0; j < text_length; ++j)
+    max_char = std::max(max_char, (std::uint64_t)text_reader->read());
+  total_io_volume += text_reader->bytes_read();
+  delete text_reader;
+
+  long double elapsed = utils::wclock() - start;
+  fprintf(stderr, "%.2Lfs\n", elapsed);
+  fprintf(stderr, "Detected alphabet size = %lu\n", max_char + 1);
+  return max_char + 1;
+}
+
+// Check that all symbols of the text are smaller than the given
+// alphabet size. Otherwise, print the first offending symbol and
+// exit (the computation indexes arrays of text_alphabet_size
+// entries with symbols and would corrupt the memory).
+template<typename char_type>
+void em_check_alphabet_size(
+    std::uint64_t text_alphabet_size,
+    std::string text_filename) {
+  std::uint64_t text_length = utils::file_size(text_filename) / sizeof(char_type);
+  fprintf(stderr, "Check alphabet size... ");
+  long double start = utils::wclock();
+
+  typedef async_stream_reader<char_type> text_reader_type;
+  text_reader_type *text_reader = new text_reader_type(text_filename, (4UL << 20), 4UL);
+  for (std::uint64_t j = 0; j < text_length; ++j) {
+    std::uint64_t c = text_reader->read();
+    if (c >= text_alphabet_size) {
+      fprintf(stderr, "\nError: symbol %lu at position %lu is not smaller "
+          "than the alphabet size (%lu)\n", c, j, text_alphabet_size);
+      std::exit(EXIT_FAILURE);
+    }
+  }
+  delete text_reader;
+
+  long double elapsed = utils::wclock() - start;
+  fprintf(stderr, "%.2Lfs\n\n", elapsed);
+}
+
+// Compute the set of symbols occurring in the text and write the
+// text with every symbol replaced by its rank in that set to
+// compact_text_filename. The mapping preserves the order of
+// symbols and hence the suffix array. On return, symbols[c] is
+// the original symbol mapped to c. If the occurring symbols are
+// already 0, 1, .., sigma - 1, the text is not rewritten and
+// compact_text_filename is left empty. Returns sigma.
+template<typename char_type>
+std::uint64_t em_compact_alphabet(
+    std::uint64_t text_alphabet_size,
+    std::string text_filename,
+    std::string &compact_text_filename,
+    std::vector<char_type> &symbols,
+    std::uint64_t &total_io_volume) {
+  std::uint64_t text_length = utils::file_size(text_filename) / sizeof(char_type);
+  fprintf(stderr, "Compact alphabet... ");
+  long double start = utils::wclock();
+  std::uint64_t io_volume = 0;
+
+  // Compute the symbol histogram.
+  std::vector<std::uint64_t> count(text_alphabet_size, 0);
+  typedef async_stream_reader<char_type> text_reader_type;
+  {
+    text_reader_type *text_reader = new text_reader_type(text_filename, (4UL << 20), 4UL);
+    for (std::uint64_t j = 0; j < text_length; ++j) {
+      std::uint64_t c = text_reader->read();
+      if (c >= text_alphabet_size) {
+        fprintf(stderr, "\nError: text symbol (%lu) is not smaller "
+            "than the alphabet size (%lu)\n", c, text_alphabet_size);
+        std::exit(EXIT_FAILURE);
+      }
+      ++count[c];
+    }
+    io_volume += text_reader->bytes_read();
+    delete text_reader;
+  }
+
+  // Compute the mapping.
+  std::vector<char_type> rank(text_alphabet_size);
+  symbols.clear();
+  for (std::uint64_t c = 0; c < text_alphabet_size; ++c) {
+    if (count[c] > 0) {
+      rank[c] = symbols.size();
+      symbols.push_back(c);
+    }
+  }
+  std::uint64_t compact_alphabet_size = std::max(1UL, (std::uint64_t)symbols.size());
+
+  // Remap the text (unless the mapping is the identity).
+  if (symbols.empty() || (std::uint64_t)symbols.back() + 1 == symbols.size())
+    compact_text_filename = std::string("");
+  else {
+    typedef async_stream_writer<char_type> text_writer_type;
+    text_reader_type *text_reader = new text_reader_type(text_filename, (4UL << 20), 4UL);
+    text_writer_type *text_writer = new text_writer_type(compact_text_filename, (4UL << 20), 4UL);
+    for (std::uint64_t j = 0; j < text_length; ++j)
+      text_writer->write(rank[text_reader->read()]);
+    io_volume += text_reader->bytes_read();
+    io_volume += text_writer->bytes_written();
+    delete text_reader;
+    delete text_writer;
+  }
+
+  long double elapsed = utils::wclock() - start;
+  fprintf(stderr, "%.2Lfs, I/O vol = %.2Lfbytes/input symbol\n",
+      elapsed, (1.L * io_volume) / std::max(1UL, text_length));
+  fprintf(stderr, "Compact alphabet size = %lu\n", compact_alphabet_size);
+  total_io_volume += io_volume;
+  return compact_alphabet_size;
+}
+
+// Replace (in place) every symbol c of the file storing
+// items of char_type with symbols[c].
+template<typename char_type>
+void restore_symbols(
+    std::string filename,
+    std::vector<char_type> &symbols,
+    std::uint64_t &total_io_volume) {
+  std::uint64_t length = utils::file_size(filename) / sizeof(char_type);
+  std::uint64_t buf_size = std::max(1UL, (4UL << 20) / sizeof(char_type));
+  char_type *buf = utils::allocate_array<char_type>(buf_size);
+  std::FILE *f = utils::file_open_nobuf(filename, "r+");
+  for (std::uint64_t beg = 0; beg < length; beg += buf_size) {
+    std::uint64_t end = std::min(beg + buf_size, length);
+    utils::read_at_offset(buf, beg * sizeof(char_type), end - beg, f);
+    for (std::uint64_t j = 0; j < end - beg; ++j)
+      buf[j] = symbols[(std::uint64_t)buf[j]];
+    utils::overwrite_at_offset(buf, beg, end - beg, f);
+  }
+  std::fclose(f);
+  utils::deallocate(buf);
+  total_io_volume += 2 * length * sizeof(char_type);
+}
+
+}  // namespace fsais_private
+
+#endif  // __FSAIS_SRC_EM_COMPACT_ALPHABET_HPP_INCLUDED
@@ -0,0 +1,281 @@
+/**
+ * @file    fsais_src/em_compute_gsa.hpp
+ * @section LICENCE
+ *
+ * This file is part of fSAIS v0.1.0
+ * See: https://github.com/dominikkempa/fsais
+ *
+ * Copyright (C) 2016-2020
+ *   Dominik Kempa <dominik.kempa (at) gmail.com>
+ *   Juha Karkkainen <juha.karkkainen (at) cs.helsinki.fi>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ **/
+
+#ifndef __FSAIS_SRC_EM_COMPUTE_GSA_HPP_INCLUDED
+#define __FSAIS_SRC_EM_COMPUTE_GSA_HPP_INCLUDED
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <limits>
+
+#include "io/async_stream_reader.hpp"
+#include "io/async_stream_writer.hpp"
+#include "em_compute_sa.hpp"
+#include "utils.hpp"
+
+
+namespace fsais_private {
+
+// The text of the document collection encodes the end of document
+// d as symbol d and byte c as symbol n_docs + c, i.e., each document
+// ends with a unique symbol smaller than all bytes, and the ends are
+// ordered by the document id. The symbols are 16-bit integers if
+// n_docs + 256 <= 2^16, and 32-bit integers otherwise.
+
+// The byte replacing the end-of-document symbols
+// when the BWT is mapped back to bytes.
+static const std::uint8_t gsa_bwt_separator = 0;
+
+// Read the list of document filenames (one per line, empty
+// lines are skipped) from list_filename.
+inline std::vector<std::string> read_document_filenames(std::string list_filename) {
+  std::vector<std::string> filenames;
+  std::FILE *f = utils::file_open(list_filename, "r");
+  char *line = NULL;
+  std::size_t buflen = 0;
+  std::int64_t len = 0;
+  while ((len = getline(&line, &buflen, f)) != -1) {
+    while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+      line[--len] = '\0';
+    if (len > 0)
+      filenames.push_back(std::string(line));
+  }
+  free(line);
+  std::fclose(f);
+  return filenames;
+}
+
+// Read the starting offsets of documents (in decimal, one per
+// line) in the file of length text_length from offsets_filename.
+inline std::vector<std::uint64_t> read_document_offsets(
+    std::string offsets_filename,
+    std::uint64_t text_length) {
+  std::vector<std::uint64_t> offsets;
+  std::FILE *f = utils::file_open(offsets_filename, "r");
+  std::uint64_t offset = 0;
+  while (fscanf(f, "%lu", &offset) == 1) {
+    if ((offsets.empty() && offset != 0) ||
+        (!offsets.empty() && offset < offsets.back()) ||
+        offset > text_length) {
+      fprintf(stderr, "\nError: invalid document offset (%lu) in %s\n",
+          offset, offsets_filename.c_str());
+      std::exit(EXIT_FAILURE);
+    }
+    offsets.push_back(offset);
+  }
+  std::fclose(f);
+  if (offsets.empty()) {
+    fprintf(stderr, "\nError: no document offsets in %s\n",
+        offsets_filename.c_str());
+    std::exit(EXIT_FAILURE);
+  }
+  return offsets;
+}
+
+// Write the text of the document collection given as the list of
+// document filenames or (if doc_offsets is not empty) as a single
+// file containing the concatenation of documents. Returns the
+// starting positions of documents in the written text.
+template<typename gsa_char_type>
+std::vector<std::uint64_t> create_gsa_text(
+    std::vector<std::string> &document_filenames,
+    std::vector<std::uint64_t> &doc_offsets,
+    std::string gsa_text_filename) {
+  std::uint64_t n_docs = doc_offsets.empty() ?
+    document_filenames.size() : doc_offsets.size();
+
+  fprintf(stderr, "Create the text of the document collection... ");
+  long double start = utils::wclock();
+
+  std::vector<std::uint64_t> doc_starts(n_docs);
+  typedef async_stream_reader<std::uint8_t> text_reader_type;
+  typedef async_stream_writer<gsa_char_type> gsa_text_writer_type;
+  gsa_text_writer_type *gsa_text_writer = new gsa_text_writer_type(gsa_text_filename, (4UL << 20), 4UL);
+  std::uint64_t gsa_text_length = 0;
+  if (doc_offsets.empty()) {
+    for (std::uint64_t doc_id = 0; doc_id < n_docs; ++doc_id) {
+      doc_starts[doc_id] = gsa_text_length;
+      std::uint64_t doc_length = utils::file_size(document_filenames[doc_id]);
+      text_reader_type *text_reader = new text_reader_type(document_filenames[doc_id], (4UL << 20), 4UL);
+      for (std::uint64_t j = 0; j < doc_length; ++j)
+        gsa_text_writer->write(n_docs + (std::uint64_t)text_reader->read());
+      delete text_reader;
+      gsa_text_writer->write(doc_id);
+      gsa_text_length += doc_length + 1;
+    }
+  } else {
+    std::uint64_t text_length = utils::file_size(document_filenames[0]);
+    text_reader_type *text_reader = new text_reader_type(document_filenames[0], (4UL << 20), 4UL);
+    for (std::uint64_t doc_id = 0; doc_id < n_docs; ++doc_id) {
+      std::uint64_t doc_beg = doc_offsets[doc_id];
+      std::uint64_t doc_end = (doc_id + 1 < n_docs) ? doc_offsets[doc_id + 1] : text_length;
+      doc_starts[doc_id] = doc_beg + doc_id;
+      for (std::uint64_t j = doc_beg; j < doc_end; ++j)
+        gsa_text_writer->write(n_docs + (std::uint64_t)text_reader->read());
+      gsa_text_writer->write(doc_id);
+    }
+    delete text_reader;
+  }
+  delete gsa_text_writer;
+
+  long double elapsed = utils::wclock() - start;
+  fprintf(stderr, "%.2Lfs\n", elapsed);
+  return doc_starts;
+}
+
+// Replace the symbols of the BWT (stored in bwt_filename) of the
+// text of the document collection by the bytes they encode and the
+// end-of-document symbols by gsa_bwt_separator.
+template<typename gsa_char_type>
+void gsa_bwt_to_bytes(
+    std::string bwt_filename,
+    std::uint64_t n_docs) {
+  fprintf(stderr, "Map the BWT to bytes... ");
+  long double start = utils::wclock();
+
+  std::string byte_bwt_filename = bwt_filename + "tmp." + utils::random_string_hash();
+  std::uint64_t length = utils::file_size(bwt_filename) / sizeof(gsa_char_type);
+  typedef async_stream_reader<gsa_char_type> bwt_reader_type;
+  typedef async_stream_writer<std::uint8_t> bwt_writer_type;
+  bwt_reader_type *bwt_reader = new bwt_reader_type(bwt_filename, (4UL << 20), 4UL);
+  bwt_writer_type *bwt_writer = new bwt_writer_type(byte_bwt_filename, (4UL << 20), 4UL);
+  for (std::uint64_t j = 0; j < length; ++j) {
+    std::uint64_t c = bwt_reader->read();
+    bwt_writer->write((c < n_docs) ? gsa_bwt_separator : (std::uint8_t)(c - n_docs));
+  }
+  delete bwt_writer;
+  delete bwt_reader;
+
+  // Replace the BWT file. Its space is released (the file was written
+  // by the stream writer) and the space of the new one stays allocated.
+  utils::file_delete(bwt_filename);
+  if (std::rename(byte_bwt_filename.c_str(), bwt_filename.c_str())) {
+    std::perror(bwt_filename.c_str());
+    std::exit(EXIT_FAILURE);
+  }
+
+  long double elapsed = utils::wclock() - start;
+  fprintf(stderr, "%.2Lfs\n", elapsed);
+}
+
+// Compute the GSA using gsa_char_type as the type
+// of symbols of the text of the document collection.
+template<typename gsa_char_type,
+  typename text_offset_type>
+void em_compute_gsa_with_char_type(
+    std::uint64_t ram_use,
+    std::vector<std::string> &document_filenames,
+    std::vector<std::uint64_t> &doc_offsets,
+    std::string output_filename,
+    std::string da_filename,
+    std::string stats_json_filename,
+    std::string progress_filename,
+    std::string bwt_filename,
+    std::string lcp_filename,
+    std::uint64_t lcp_width,
+    std::uint64_t sa_sample_rate,
+    bool write_sa,
+    std::string isa_filename,
+    bool pack_output,
+    bool compact_alphabet) {
+  std::string gsa_text_filename = output_filename + "tmp." + utils::random_string_hash();
+  std::vector<std::uint64_t> doc_starts = create_gsa_text<gsa_char_type>(
+      document_filenames, doc_offsets, gsa_text_filename);
+  std::uint64_t text_alphabet_size = doc_starts.size() + 256;
+
+  em_compute_sa<gsa_char_type, text_offset_type>(ram_use, text_alphabet_size,
+      gsa_text_filename, output_filename, stats_json_filename, progress_filename,
+      bwt_filename, lcp_filename, lcp_width, sa_sample_rate, write_sa, isa_filename,
+      pack_output, da_filename, &doc_starts, compact_alphabet);
+  utils::file_delete(gsa_text_filename);
+  if (!bwt_filename.empty())
+    gsa_bwt_to_bytes<gsa_char_type>(utils::absolute_path(bwt_filename), doc_starts.size());
+}
+
+// Compute the (generalized) suffix array of the collection of
+// documents given either as a list of document filenames or as
+// a single file (document_filenames[0]) and the starting offsets
+// of documents. The suffix array is computed for the text in
+// which every document is followed by its own unique sentinel
+// symbol (see above) so that no suffix comparison crosses the
+// document boundary. Optionally, the document array is written to
+// da_filename by the last inducing pass. The BWT (if requested) is
+// mapped back to bytes, with gsa_bwt_separator at the positions
+// preceding the starts of documents.
+template<typename text_offset_type>
+void em_compute_gsa(
+    std::uint64_t ram_use,
+    std::vector<std::string> document_filenames,
+    std::vector<std::uint64_t> doc_offsets,
+    std::string output_filename,
+    std::string da_filename = std::string(""),
+    std::string stats_json_filename = std::string(""),
+    std::string progress_filename = std::string(""),
+    std::string bwt_filename = std::string(""),
+    std::string lcp_filename = std::string(""),
+    std::uint64_t lcp_width = 5,
+    std::uint64_t sa_sample_rate = 1,
+    bool write_sa = true,
+    std::string isa_filename = std::string(""),
+    bool pack_output = false,
+    bool compact_alphabet = false) {
+  output_filename = utils::absolute_path(output_filename);
+  std::uint64_t n_docs = doc_offsets.empty() ?
+    document_filenames.size() : doc_offsets.size();
+  if (n_docs == 0) {
+    fprintf(stderr, "\nError: the document collection is empty\n");
+    std::exit(EXIT_FAILURE);
+  }
+  if (n_docs > (std::uint64_t)std::numeric_limits<std::uint32_t>::max() - 255UL) {
+    fprintf(stderr, "\nError: too many documents (%lu)\n", n_docs);
+    std::exit(EXIT_FAILURE);
+  }
+
+  if (n_docs + 256 <= (1UL << 16))
+    em_compute_gsa_with_char_type<std::uint16_t, text_offset_type>(ram_use, document_filenames,
+        doc_offsets, output_filename, da_filename, stats_json_filename,
+        progress_filename, bwt_filename, lcp_filename, lcp_width, sa_sample_rate,
+        write_sa, isa_filename, pack_output, compact_alphabet);
+  else
+    em_compute_gsa_with_char_type<std::uint32_t, text_offset_type>(ram_use, document_filenames,
+        doc_offsets, output_filename, da_filename, stats_json_filename,
+        progress_filename, bwt_filename, lcp_filename, lcp_width, sa_sample_rate,
+        write_sa, isa_filename, pack_output, compact_alphabet);
+}
+
+}  // namespace fsais_private
+
+#endif  // __FSAIS_SRC_EM_COMPUTE_GSA_HPP_INCLUDED
@@ -0,0 +1,572 @@
+/**
+ * @file    fsais_src/em_compute_lcp.hpp
+ * @section LICENCE
+ *
+ * This file is part of fSAIS v0.1.0
+ * See: https://github.com/dominikkempa/fsais
+ *
+ * Copyright (C) 2016-2020
+ *   Dominik Kempa <dominik.kempa (at) gmail.com>
+ *   Juha Karkkainen <juha.karkkainen (at) cs.helsinki.fi>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ **/
+
+#ifndef __FSAIS_SRC_EM_COMPUTE_LCP_HPP_INCLUDED
+#define __FSAIS_SRC_EM_COMPUTE_LCP_HPP_INCLUDED
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <limits>
+#include <algorithm>
+
+#include "io/async_stream_reader.hpp"
+#include "io/async_stream_writer.hpp"
+#include "io/async_multi_stream_reader.hpp"
+#include "io/async_multi_stream_writer.hpp"
+#include "phase_stats.hpp"
+#include "progress_reporter.hpp"
+#include "utils.hpp"
+
+#include "../uint24.hpp"
+#include "../uint40.hpp"
+#include "../uint48.hpp"
+
+
+namespace fsais_private {
+
+// Compute the LCP array from the suffix array (stored in
+// sa_filename) and the BWT (stored in bwt_filename, as written
+// by the final pass of em_induce_minus_and_plus_suffixes) using
+// the external-memory Phi algorithm. The text is split into blocks
+// and the LCP is computed explicitly only for irreducible positions
+// i of the permuted LCP array (PLCP), i.e., those where the BWT
+// symbols preceding SA[ISA[i]] and SA[ISA[i] - 1] differ, which
+// requires at most 2n log n symbol comparisons in total. The
+// comparison of suffixes i and j is carried out by scanning
+// the pair of text blocks containing i + l and j + l (in the
+// lexicographical order of pairs of blocks, with pairs reaching
+// the end of a block moved to the next pair of blocks). The
+// remaining PLCP values are obtained from PLCP[i] = PLCP[i - 1] - 1.
+// LCP values exceeding the maximum value of lcp_type are written
+// as that maximum value.
+template<typename char_type,
+  typename text_offset_type,
+  typename lcp_type>
+void em_compute_lcp(
+    std::uint64_t text_length,
+    std::uint64_t ram_use,
+    std::string text_filename,
+    std::string sa_filename,
+    std::string bwt_filename,
+    std::string output_filename,
+    std::uint64_t &total_io_volume) {
+  if (text_length == 0) {
+    fprintf(stderr, "\nError: text_length = 0\n");
+    std::exit(EXIT_FAILURE);
+  }
+
+#ifdef SAIS_DEBUG
+  std::uint64_t max_block_size = 0;
+  std::uint64_t n_blocks = 0;
+  do {
+    max_block_size = utils::random_int64(1L, text_length);
+    n_blocks = (text_length + max_block_size - 1) / max_block_size;
+  } while (n_blocks > (1UL << 8));
+#else
+  std::uint64_t max_block_size = std::max(1UL, (std::uint64_t)((ram_use / 2) /
+        std::max(2.L * sizeof(char_type), sizeof(text_offset_type) + 0.125L)));
+  std::uint64_t n_blocks = (text_length + max_block_size - 1) / max_block_size;
+#endif
+
+  fprintf(stderr, "Compute LCP array\n");
+  fprintf(stderr, "  LCP filename = %s\n", output_filename.c_str());
+  fprintf(stderr, "  sizeof(lcp_type) = %lu\n", sizeof(lcp_type));
+  fprintf(stderr, "  Max block size = %lu\n", max_block_size);
+  fprintf(stderr, "  Number of blocks = %lu\n", n_blocks);
+  long double start = utils::wclock();
+  phase_stats::begin_phase("Compute LCP array", 0);
+
+  std::uint64_t io_volume = 0;
+  std::uint64_t n_buffers = 16 + 3 * n_blocks;
+  std::uint64_t computed_buf_size = std::max(1UL, (ram_use / 2) / n_buffers);
+
+  std::vector<std::string> pairs_filenames(n_blocks);
+  std::vector<std::string> positions_filenames(n_blocks);
+  std::vector<std::string> plcp_filenames(n_blocks);
+  std::vector<std::string> lcp_filenames(n_blocks);
+  for (std::uint64_t block_id = 0; block_id < n_blocks; ++block_id) {
+    pairs_filenames[block_id] = output_filename + "tmp." + utils::random_string_hash();
+    positions_filenames[block_id] = output_filename + "tmp." + utils::random_string_hash();
+    plcp_filenames[block_id] = output_filename + "tmp." + utils::random_string_hash();
+    lcp_filenames[block_id] = output_filename + "tmp." + utils::random_string_hash();
+  }
+
+  // Writer of the irreducible PLCP values (pairs (i - block_beg,
+  // PLCP[i])) into blocks of the text, used in the first two steps.
+  typedef async_multi_stream_writer<text_offset_type> plcp_writer_type;
+  plcp_writer_type *plcp_writer = new plcp_writer_type(n_blocks, computed_buf_size, 4UL);
+  for (std::uint64_t block_id = 0; block_id < n_blocks; ++block_id)
+    plcp_writer->add_file(plcp_filenames[block_id]);
+
+  // Scan SA and BWT. For every block of the text, write the
+  // positions of the block in the order of SA, and the irreducible
+  // pairs (i, j = Phi(i), 0) such that i belongs to the block.
+  std::uint64_t n_irreducible = 0;
+  {
+    fprintf(stderr, "  Distribute SA into text blocks: ");
+    long double step_start = utils::wclock();
+    phase_stats::begin_phase("Distribute SA into text blocks");
+
+    typedef async_stream_reader<text_offset_type> sa_reader_type;
+    typedef async_stream_reader<char_type> bwt_reader_type;
+    typedef async_multi_stream_writer<text_offset_type> writer_type;
+    sa_reader_type *sa_reader = new sa_reader_type(sa_filename, 4UL * computed_buf_size, 4UL);
+    bwt_reader_type *bwt_reader = new bwt_reader_type(bwt_filename, 4UL * computed_buf_size, 4UL, 1UL);
+    writer_type *positions_writer = new writer_type(n_blocks, computed_buf_size, 4UL);
+    writer_type *pairs_writer = new writer_type(n_blocks, computed_buf_size, 4UL);
+    for (std::uint64_t block_id = 0; block_id < n_blocks; ++block_id) {
+      positions_writer->add_file(positions_filenames[block_id]);
+      pairs_writer->add_file(pairs_filenames[block_id]);
+    }
+
+    std::uint64_t prev_pos = 0;
+    std::uint64_t prev_symbol = 0;
+    progress_counter progress(text_length);
+    for (std::uint64_t i = 0; i < text_length; ++i) {
+      std::uint64_t pos = sa_reader->read();
+      std::uint64_t symbol = (pos > 0) ? (std::uint64_t)bwt_reader->read() : 0;
+      std::uint64_t block_id = pos / max_block_size;
+      std::uint64_t block_offset = pos - block_id * max_block_size;
+      positions_writer->write_to_ith_file(block_id, block_offset);
+      if (i == 0) {
+        plcp_writer->write_to_ith_file(block_id, block_offset);
+        plcp_writer->write_to_ith_file(block_id, 0UL);
+      } else if (pos == 0 || prev_pos == 0 || symbol != prev_symbol) {
+        pairs_writer->write_to_ith_file(block_id, pos);
+        pairs_writer->write_to_ith_file(block_id, prev_pos);
+        pairs_writer->write_to_ith_file(block_id, 0UL);
+        ++n_irreducible;
+      }
+      prev_pos = pos;
+      prev_symbol = symbol;
+      progress.increment();
+    }
+
+    // Stop I/O threads.
+    sa_reader->stop_reading();
+    bwt_reader->stop_reading();
+
+    // Update I/O volume.
+    std::uint64_t step_io_volume =
+      sa_reader->bytes_read() +
+      bwt_reader->bytes_read() +
+      positions_writer->bytes_written() +
+      pairs_writer->bytes_written();
+    io_volume += step_io_volume;
+
+    // Clean up.
+    delete pairs_writer;
+    delete positions_writer;
+    delete bwt_reader;
+    delete sa_reader;
+
+    long double step_time = utils::wclock() - step_start;
+    fprintf(stderr, "time = %.2Lfs, I/O = %.2LfMiB/s, irreducible = %lu (%.2Lf%%)\n",
+        step_time, (1.L * step_io_volume / (1L << 20)) / step_time,
+        n_irreducible, (100.L * n_irreducible) / text_length);
+    phase_stats::end_phase();
+  }
+
+  // Compute the irreducible PLCP values. The pairs (i, j, l)
+  // with i + l in block X are distributed according to the block Y
+  // containing j + l and then processed for Y = 0, 1, ... (with
+  // blocks X and Y in RAM). Pairs reaching the end of block Y are
+  // carried to block Y + 1, pairs reaching the end of block X are
+  // carried to block X + 1 (and processed in the next round).
+  {
+    fprintf(stderr, "  Compute irreducible LCP values: ");
+    long double step_start = utils::wclock();
+    phase_stats::begin_phase("Compute irreducible LCP values");
+    std::uint64_t step_io_volume = 0;
+    std::uint64_t n_symbol_comparisons = 0;
+    std::uint64_t n_block_pairs = 0;
+
+    char_type *x_block_text = utils::allocate_array<char_type>(max_block_size);
+    char_type *y_block_text = utils::allocate_array<char_type>(max_block_size);
+    std::vector<std::string> y_pairs_filenames(n_blocks);
+    std::string next_x_pairs_filename = output_filename + "tmp." + utils::random_string_hash();
+    std::FILE *f_text = utils::file_open_nobuf(text_filename, "r");
+    for (std::uint64_t x_block_id = 0; x_block_id < n_blocks; ++x_block_id) {
+      std::uint64_t x_block_beg = x_block_id * max_block_size;
+      std::uint64_t x_block_end = std::min(x_block_beg + max_block_size, text_length);
+      std::string x_pairs_filename = next_x_pairs_filename;
+
+      // Distribute pairs with i + l in block X.
+      {
+        typedef async_stream_reader<text_offset_type> pairs_reader_type;
+        typedef async_multi_stream_writer<text_offset_type> pairs_writer_type;
+        pairs_writer_type *pairs_writer = new pairs_writer_type(n_blocks, computed_buf_size, 4UL);
+        for (std::uint64_t y_block_id = 0; y_block_id < n_blocks; ++y_block_id) {
+          y_pairs_filenames[y_block_id] = output_filename + "tmp." + utils::random_string_hash();
+          pairs_writer->add_file(y_pairs_filenames[y_block_id]);
+        }
+        for (std::uint64_t t = 0; t < 2; ++t) {
+          std::string filename = (t == 0) ? pairs_filenames[x_block_id] : x_pairs_filename;
+          if (!utils::file_exists(filename))
+            continue;
+          pairs_reader_type *pairs_reader = new pairs_reader_type(filename, 4UL * computed_buf_size, 4UL);
+          while (!pairs_reader->empty()) {
+            std::uint64_t i = pairs_reader->read();
+            std::uint64_t j = pairs_reader->read();
+            std::uint64_t lcp = pairs_reader->read();
+            std::uint64_t y_block_id = (j + lcp) / max_block_size;
+            pairs_writer->write_to_ith_file(y_block_id, i);
+            pairs_writer->write_to_ith_file(y_block_id, j);
+            pairs_writer->write_to_ith_file(y_block_id, lcp);
+          }
+          pairs_reader->stop_reading();
+          step_io_volume += pairs_reader->bytes_read();
+          delete pairs_reader;
+          utils::file_delete(filename);
+        }
+        step_io_volume += pairs_writer->bytes_written();
+        delete pairs_writer;
+      }
+
+      // Read block X of the text.
+      utils::read_at_offset(x_block_text, x_block_beg * sizeof(char_type),
+          x_block_end - x_block_beg, f_text);
+      step_io_volume += (x_block_end - x_block_beg) * sizeof(char_type);
+
+      // Process blocks Y left to right.
+      typedef async_stream_reader<text_offset_type> pairs_reader_type;
+      typedef async_stream_writer<text_offset_type> pairs_writer_type;
+      pairs_writer_type *next_x_pairs_writer = NULL;
+      if (x_block_id + 1 < n_blocks) {
+        next_x_pairs_filename = output_filename + "tmp." + utils::random_string_hash();
+        next_x_pairs_writer = new pairs_writer_type(next_x_pairs_filename, 4UL * computed_buf_size, 4UL);
+      }
+      std::string y_carry_filename;
+      for (std::uint64_t y_block_id = 0; y_block_id < n_blocks; ++y_block_id) {
+        std::uint64_t y_block_beg = y_block_id * max_block_size;
+        std::uint64_t y_block_end = std::min(y_block_beg + max_block_size, text_length);
+        std::string cur_y_carry_filename = y_carry_filename;
+        bool is_cur_y_carry_empty = (cur_y_carry_filename.empty() ||
+            utils::file_size(cur_y_carry_filename) == 0);
+        if (utils::file_size(y_pairs_filenames[y_block_id]) == 0 && is_cur_y_carry_empty) {
+          utils::file_delete(y_pairs_filenames[y_block_id]);
+          if (!cur_y_carry_filename.empty())
+            utils::file_delete(cur_y_carry_filename);
+          y_carry_filename = std::string("");
+          continue;
+        }
+
+        // Read block Y of the text (unless Y = X).
+        const char_type *y_text = x_block_text;
+        if (y_block_id != x_block_id) {
+          utils::read_at_offset(y_block_text, y_block_beg * sizeof(char_type),
+              y_block_end - y_block_beg, f_text);
+          step_io_volume += (y_block_end - y_block_beg) * sizeof(char_type);
+          y_text = y_block_text;
+        }
+        ++n_block_pairs;
+
+        pairs_writer_type *y_carry_writer = NULL;
+        if (y_block_id + 1 < n_blocks) {
+          y_carry_filename = output_filename + "tmp." + utils::random_string_hash();
+          y_carry_writer = new pairs_writer_type(y_carry_filename, 4UL * computed_buf_size, 4UL);
+        }
+
+        for (std::uint64_t t = 0; t < 2; ++t) {
+          std::string filename = (t == 0) ? y_pairs_filenames[y_block_id] : cur_y_carry_filename;
+          if (filename.empty())
+            continue;
+          pairs_reader_type *pairs_reader = new pairs_reader_type(filename, 4UL * computed_buf_size, 4UL);
+          while (!pairs_reader->empty()) {
+            std::uint64_t i = pairs_reader->read();
+            std::uint64_t j = pairs_reader->read();
+            std::uint64_t lcp = pairs_reader->read();
+            std::uint64_t x_pos = i + lcp;
+            std::uint64_t y_pos = j + lcp;
+            while (x_pos < x_block_end && y_pos < y_block_end &&
+                x_block_text[x_pos - x_block_beg] == y_text[y_pos - y_block_beg]) {
+              ++x_pos;
+              ++y_pos;
+            }
+            n_symbol_comparisons += x_pos - (i + lcp) + 1;
+            lcp = x_pos - i;
+
+            if ((x_pos < x_block_end && y_pos < y_block_end) ||
+                x_pos == text_length || y_pos == text_length) {
+              std::uint64_t i_block_id = i / max_block_size;
+              plcp_writer->write_to_ith_file(i_block_id, i - i_block_id * max_block_size);
+              plcp_writer->write_to_ith_file(i_block_id, lcp);
+            } else if (x_pos == x_block_end) {
+              next_x_pairs_writer->write(i);
+              next_x_pairs_writer->write(j);
+              next_x_pairs_writer->write(lcp);
+            } else {
+              y_carry_writer->write(i);
+              y_carry_writer->write(j);
+              y_carry_writer->write(lcp);
+            }
+          }
+          pairs_reader->stop_reading();
+          step_io_volume += pairs_reader->bytes_read();
+          delete pairs_reader;
+          utils::file_delete(filename);
+        }
+
+        if (y_carry_writer != NULL) {
+          step_io_volume += y_carry_writer->bytes_written();
+          delete y_carry_writer;
+        }
+      }
+
+      if (next_x_pairs_writer != NULL) {
+        step_io_volume += next_x_pairs_writer->bytes_written();
+        delete next_x_pairs_writer;
+      }
+      progress_reporter::set_items_processed(
+          (text_length * (x_block_id + 1)) / n_blocks);
+    }
+    std::fclose(f_text);
+
+    // Update I/O volume.
+    step_io_volume += plcp_writer->bytes_written();
+    io_volume += step_io_volume;
+
+    // Clean up.
+    delete plcp_writer;
+    utils::deallocate(y_block_text);
+    utils::deallocate(x_block_text);
+
+    long double step_time = utils::wclock() - step_start;
+    fprintf(stderr, "time = %.2Lfs, I/O = %.2LfMiB/s, block pairs = %lu, "
+        "comparisons = %.2Lf/symbol\n", step_time,
+        (1.L * step_io_volume / (1L << 20)) / step_time, n_block_pairs,
+        (1.L * n_symbol_comparisons) / text_length);
+    phase_stats::end_phase();
+  }
+
+  // For every block (left to right), compute the PLCP values of
+  // the block and write them in the order of SA.
+  std::uint64_t n_saturated = 0;
+  {
+    fprintf(stderr, "  Compute PLCP blocks: ");
+    long double step_start = utils::wclock();
+    phase_stats::begin_phase("Compute PLCP blocks");
+    std::uint64_t step_io_volume = 0;
+
+    text_offset_type *block_plcp = utils::allocate_array<text_offset_type>(max_block_size);
+    std::uint64_t irreducible_bv_size = (max_block_size + 63) / 64;
+    std::uint64_t *irreducible_bv = utils::allocate_array<std::uint64_t>(irreducible_bv_size);
+    std::uint64_t max_lcp = std::numeric_limits<lcp_type>::max();
+    std::uint64_t prev_plcp = 0;
+    progress_reporter::set_items_expected(text_length);
+    for (std::uint64_t block_id = 0; block_id < n_blocks; ++block_id) {
+      std::uint64_t block_beg = block_id * max_block_size;
+      std::uint64_t block_end = std::min(block_beg + max_block_size, text_length);
+      std::uint64_t block_size = block_end - block_beg;
+      std::fill(irreducible_bv, irreducible_bv + irreducible_bv_size, 0UL);
+
+      // Read irreducible PLCP values.
+      {
+        typedef async_stream_reader<text_offset_type> plcp_reader_type;
+        plcp_reader_type *plcp_reader = new plcp_reader_type(plcp_filenames[block_id], 4UL * computed_buf_size, 4UL);
+        while (!plcp_reader->empty()) {
+          std::uint64_t block_offset = plcp_reader->read();
+          block_plcp[block_offset] = plcp_reader->read();
+          irreducible_bv[block_offset >> 6] |= (1UL << (block_offset & 63));
+        }
+        plcp_reader->stop_reading();
+        step_io_volume += plcp_reader->bytes_read();
+        delete plcp_reader;
+        utils::file_delete(plcp_filenames[block_id]);
+      }
+
+      // Compute reducible PLCP values.
+      for (std::uint64_t j = 0; j < block_size; ++j) {
+        if (!(irreducible_bv[j >> 6] & (1UL << (j & 63)))) {
+#ifdef SAIS_DEBUG
+          if (prev_plcp == 0) {
+            fprintf(stderr, "\nError: reducible PLCP[%lu] with PLCP[%lu] = 0\n",
+                block_beg + j, block_beg + j - 1);
+            std::exit(EXIT_FAILURE);
+          }
+#endif
+          block_plcp[j] = prev_plcp - 1;
+        }
+        prev_plcp = block_plcp[j];
+      }
+
+      // Permute PLCP values into SA order.
+      {
+        typedef async_stream_reader<text_offset_type> positions_reader_type;
+        typedef async_stream_writer<lcp_type> lcp_writer_type;
+        positions_reader_type *positions_reader =
+          new positions_reader_type(positions_filenames[block_id], 4UL * computed_buf_size, 4UL);
+        lcp_writer_type *lcp_writer = new lcp_writer_type(lcp_filenames[block_id], 4UL * computed_buf_size, 4UL);
+        for (std::uint64_t j = 0; j < block_size; ++j) {
+          std::uint64_t block_offset = positions_reader->read();
+          std::uint64_t lcp = block_plcp[block_offset];
+          if (lcp > max_lcp) {
+            lcp = max_lcp;
+            ++n_saturated;
+          }
+          lcp_writer->write(lcp);
+        }
+        positions_reader->stop_reading();
+        step_io_volume +=
+          positions_reader->bytes_read() +
+          lcp_writer->bytes_written();
+        delete lcp_writer;
+        delete positions_reader;
+        utils::file_delete(positions_filenames[block_id]);
+      }
+      progress_reporter::set_items_processed(block_end);
+    }
+
+    // Clean up.
+    utils::deallocate(irreducible_bv);
+    utils::deallocate(block_plcp);
+    io_volume += step_io_volume;
+
+    long double step_time = utils::wclock() - step_start;
+    fprintf(stderr, "time = %.2Lfs, I/O = %.2LfMiB/s\n", step_time,
+        (1.L * step_io_volume / (1L << 20)) / step_time);
+    phase_stats::end_phase();
+  }
+
+  // Merge the LCP values of blocks into the LCP array.
+  {
+    fprintf(stderr, "  Merge LCP blocks: ");
+    long double step_start = utils::wclock();
+    phase_stats::begin_phase("Merge LCP blocks");
+
+    typedef async_stream_reader<text_offset_type> sa_reader_type;
+    typedef async_multi_stream_reader<lcp_type> lcp_reader_type;
+    typedef async_stream_writer<lcp_type> output_writer_type;
+    sa_reader_type *sa_reader = new sa_reader_type(sa_filename, 4UL * computed_buf_size, 4UL);
+    lcp_reader_type *lcp_reader = new lcp_reader_type(n_blocks, 2UL * computed_buf_size);
+    output_writer_type *output_writer = new output_writer_type(output_filename, 4UL * computed_buf_size, 4UL);
+    for (std::uint64_t block_id = 0; block_id < n_blocks; ++block_id)
+      lcp_reader->add_file(lcp_filenames[block_id]);
+
+    progress_counter progress(text_length);
+    for (std::uint64_t i = 0; i < text_length; ++i) {
+      std::uint64_t pos = sa_reader->read();
+      output_writer->write(lcp_reader->read_from_ith_file(pos / max_block_size));
+      progress.increment();
+    }
+
+    // Stop I/O threads.
+    sa_reader->stop_reading();
+    lcp_reader->stop_reading();
+
+    // Update I/O volume.
+    std::uint64_t step_io_volume =
+      sa_reader->bytes_read() +
+      lcp_reader->bytes_read() +
+      output_writer->bytes_written();
+    io_volume += step_io_volume;
+
+    // Clean up.
+    delete output_writer;
+    delete lcp_reader;
+    delete sa_reader;
+    for (std::uint64_t block_id = 0; block_id < n_blocks; ++block_id)
+      utils::file_delete(lcp_filenames[block_id]);
+
+    long double step_time = utils::wclock() - step_start;
+    fprintf(stderr, "time = %.2Lfs, I/O = %.2LfMiB/s\n", step_time,
+        (1.L * step_io_volume / (1L << 20)) / step_time);
+    phase_stats::end_phase();
+  }
+
+  if (n_saturated > 0)
+    fprintf(stderr, "  Warning: %lu LCP values exceed the maximum value "
+        "of lcp_type and were saturated\n", n_saturated);
+
+  // Print summary.
+  total_io_volume += io_volume;
+  long double total_time = utils::wclock() - start;
+  phase_stats::end_phase();
+  fprintf(stderr, "  Time = %.2Lfs, I/O = %.2LfMiB/s, "
+      "I/O vol = %.1Lf bytes/symbol\n\n", total_time,
+      (1.L * io_volume / (1L << 20)) / total_time,
+      (1.L * io_volume) / text_length);
+}
+
+template<typename char_type,
+  typename text_offset_type>
+void em_compute_lcp(
+    std::uint64_t text_length,
+    std::uint64_t ram_use,
+    std::uint64_t lcp_width,
+    std::string text_filename,
+    std::string sa_filename,
+    std::string bwt_filename,
+    std::string output_filename,
+    std::uint64_t &total_io_volume) {
+  switch (lcp_width) {
+    case 1:
+      em_compute_lcp<char_type, text_offset_type, std::uint8_t>(text_length, ram_use,
+          text_filename, sa_filename, bwt_filename, output_filename, total_io_volume);
+      break;
+    case 2:
+      em_compute_lcp<char_type, text_offset_type, std::uint16_t>(text_length, ram_use,
+          text_filename, sa_filename, bwt_filename, output_filename, total_io_volume);
+      break;
+    case 3:
+      em_compute_lcp<char_type, text_offset_type, uint24>(text_length, ram_use,
+          text_filename, sa_filename, bwt_filename, output_filename, total_io_volume);
+      break;
+    case 4:
+      em_compute_lcp<char_type, text_offset_type, std::uint32_t>(text_length, ram_use,
+          text_filename, sa_filename, bwt_filename, output_filename, total_io_volume);
+      break;
+    case 5:
+      em_compute_lcp<char_type, text_offset_type, uint40>(text_length, ram_use,
+          text_filename, sa_filename, bwt_filename, output_filename, total_io_volume);
+      break;
+    case 6:
+      em_compute_lcp<char_type, text_offset_type, uint48>(text_length, ram_use,
+          text_filename, sa_filename, bwt_filename, output_filename, total_io_volume);
+      break;
+    case 8:
+      em_compute_lcp<char_type, text_offset_type, std::uint64_t>(text_length, ram_use,
+          text_filename, sa_filename, bwt_filename, output_filename, total_io_volume);
+      break;
+    default:
+      fprintf(stderr, "\nError: unsupported LCP integer width (%lu)\n", lcp_width);
+      std::exit(EXIT_FAILURE);
+  }
+}
+
+}  // namespace fsais_private
+
+#endif  // __FSAIS_SRC_EM_COMPUTE_LCP_HPP_INCLUDED
@@ -47,11 +47,18 @@
 #include "io/async_stream_writer_multipart.hpp"
 #include "io/async_multi_stream_reader.hpp"
 #include "io/async_multi_stream_writer.hpp"
+#include "io/async_bit_packed_stream_writer.hpp"
 
 #include "em_induce_minus_star_substrings.hpp"
 #include "em_induce_minus_and_plus_suffixes.hpp"
+#include "em_compute_lcp.hpp"
+#include "em_compact_alphabet.hpp"
+#include "sampled_sa_writer.hpp"
 #include "naive_compute_sa.hpp"
 #include "utils.hpp"
+#include "phase_stats.hpp"
+#include "progress_reporter.hpp"
+#include "hardware_profile.hpp"
 #include "../uint24.hpp"
 #include "../uint40.hpp"
 #include "../uint48.hpp"
@@ -74,6 +81,7 @@ std::uint64_t create_recursive_text(
 
   fprintf(stderr, "  Create recursive text: ");
   long double start = utils::wclock();
+  phase_stats::begin_phase("Create recursive text");
 
   // Allocate array with names and `used' bitvector.
   std::uint64_t used_bv_size = (max_permute_block_size + 63) / 64;
@@ -82,6 +90,16 @@ std::uint64_t create_recursive_text(
   text_offset_type *names = utils::allocate_array<text_offset_type>(max_permute_block_size);
   std::fill(names, names + max_permute_block_size, (text_offset_type)0);
 
+  // Streams are read and written in chunks
+  // of bufsize (an even number of) items.
+#ifdef SAIS_DEBUG
+  std::uint64_t bufsize = 2 * utils::random_int64(1L, 10L);
+#else
+  static const std::uint64_t bufsize = (1UL << 15);
+#endif
+  std::uint64_t *pos_buf = utils::allocate_array<std::uint64_t>(bufsize);
+  std::uint64_t *name_buf = utils::allocate_array<std::uint64_t>(bufsize);
+
   // Initialize the writer of text.
   typedef async_stream_writer<name_type> text_writer_type;
   text_writer_type *text_writer = new text_writer_type(recursive_text_output_filename, (2UL << 20), 4UL);
@@ -99,11 +117,17 @@ std::uint64_t create_recursive_text(
       typedef async_stream_reader<text_offset_type> reader_type;
       reader_type *reader = new reader_type(
           lex_sorted_minus_star_substrings_for_normal_string_input_filenames[permute_block_id], (2UL << 20), 4UL);
-      while (!reader->empty()) {
-        std::uint64_t pos = (std::uint64_t)reader->read() - permute_block_beg;
-        text_offset_type name = reader->read();
-        names[pos] = name;
-        used_bv[pos >> 6] |= (1UL << (pos & 63));
+      std::uint64_t items_left = utils::file_size(
+          lex_sorted_minus_star_substrings_for_normal_string_input_filenames[permute_block_id]) / sizeof(text_offset_type);
+      while (items_left > 0) {
+        std::uint64_t filled = std::min(items_left, bufsize);
+        reader->read_unpacked(pos_buf, filled);
+        for (std::uint64_t i = 0; i < filled; i += 2) {
+          std::uint64_t pos = pos_buf[i] - permute_block_beg;
+          names[pos] = pos_buf[i + 1];
+          used_bv[pos >> 6] |= (1UL << (pos & 63));
+        }
+        items_left -= filled;
       }
 
       // Stop the I/O thread.
@@ -122,13 +146,21 @@ std::uint64_t create_recursive_text(
       typedef async_stream_writer<text_offset_type> pos_writer_type;
       pos_writer_type *pos_writer = new pos_writer_type(
           text_sorted_minus_star_substrings_for_normal_string_output_filenames[permute_block_id], (2UL << 20), 4UL);
+      std::uint64_t filled = 0;
       for (std::uint64_t i = 0; i < permute_block_size; ++i) {
         if (used_bv[i >> 6] & (1UL << (i & 63))) {
-          pos_writer->write(i);
-          text_writer->write((std::uint64_t)names[i]);
+          pos_buf[filled] = i;
+          name_buf[filled] = names[i];
+          if (++filled == bufsize) {
+            pos_writer->write_packed(pos_buf, filled);
+            text_writer->write_packed(name_buf, filled);
+            filled = 0;
+          }
           ++new_text_length;
         }
       }
+      pos_writer->write_packed(pos_buf, filled);
+      text_writer->write_packed(name_buf, filled);
 
       // Update I/O volume.
       io_volume += pos_writer->bytes_written();
@@ -145,6 +177,8 @@ std::uint64_t create_recursive_text(
 
   // Clean up.
   delete text_writer;
+  utils::deallocate(name_buf);
+  utils::deallocate(pos_buf);
   utils::deallocate(names);
   utils::deallocate(used_bv);
 
@@ -154,6 +188,7 @@ std::uint64_t create_recursive_text(
       "total I/O vol = %.1Lf bytes/symbol (of initial text)\n\n",
       total_time, (1.l * io_volume / (1l << 20)) / total_time,
       (1.L *total_io_volume) / initial_text_length);
+  phase_stats::end_phase();
 
   // Return result.
   return new_text_length;
@@ -182,6 +217,7 @@ std::uint64_t permute_minus_star_suffixes_for_normal_string_from_text_to_lex_ord
 
   fprintf(stderr, "  Permute minus star suffixes from text to lex order:\n");
   long double start = utils::wclock();
+  phase_stats::begin_phase("Permute minus star suffixes from text to lex order");
 
   std::vector<std::string> temp_filenames(n_permute_blocks);
   for (std::uint64_t permute_block_id = 0; permute_block_id < n_permute_blocks; ++permute_block_id)
@@ -225,8 +261,7 @@ std::uint64_t permute_minus_star_suffixes_for_normal_string_from_text_to_lex_ord
     std::uint64_t items_left = utils::file_size(lex_sorted_suffixes_for_recursive_string_filenames[permute_block_id]) / sizeof(text_offset_type);
     while (items_left > 0) {
       std::uint64_t filled = std::min(items_left, bufsize);
-      for (std::uint64_t i = 0; i < filled; ++i)
-        inbuf[i] = lex_sorted_suffixes_for_recursive_string_reader->read();
+      lex_sorted_suffixes_for_recursive_string_reader->read_unpacked(inbuf, filled);
       for (std::uint64_t i = 0; i < filled; ++i) {
         std::uint64_t pos = inbuf[i];
         outbuf[i] = text_sorted_suffixes_for_normal_string[pos];
@@ -343,6 +378,7 @@ std::uint64_t permute_minus_star_suffixes_for_normal_string_from_text_to_lex_ord
 
   // Print summary.
   long double total_time = utils::wclock() - start;
+  phase_stats::end_phase();
   fprintf(stderr, "    Time = %.2Lfs, I/O = %.2LfMiB/s, "
       "total I/O vol = %.1Lf bytes/symbol (of initial text)\n",
       total_time, (1.l * io_volume / (1l << 20)) / total_time,
@@ -453,6 +489,8 @@ void compute_sa(
 #endif
 
   fprintf(stderr, "Enter recursion level %lu\n", recursion_level);
+  phase_stats::begin_phase("Recursion level " +
+      utils::intToStr(recursion_level), recursion_level);
   fprintf(stderr, "  Text length = %lu\n", text_length);
   fprintf(stderr, "  Text alphabet size = %lu\n", text_alphabet_size);
   fprintf(stderr, "  sizeof(char_type) = %lu\n", sizeof(char_type));
@@ -656,6 +694,7 @@ void compute_sa(
       input_block_count, input_lex_sorted_suffixes_block_ids_filename,
       input_lex_sorted_suffixes_filenames, total_io_volume, is_small_alphabet);
 
+  phase_stats::end_phase();
   fprintf(stderr, "Exit recursion level %lu\n", recursion_level);
 }
 
@@ -665,11 +704,117 @@ void em_compute_sa(
     std::uint64_t ram_use,
     std::uint64_t text_alphabet_size,
     std::string text_filename,
-    std::string output_filename) {
+    std::string output_filename,
+    std::string stats_json_filename = std::string(""),
+    std::string progress_filename = std::string(""),
+    std::string bwt_filename = std::string(""),
+    std::string lcp_filename = std::string(""),
+    std::uint64_t lcp_width = 5,
+    std::uint64_t sa_sample_rate = 1,
+    bool write_sa = true,
+    std::string isa_filename = std::string(""),
+    bool pack_output = false,
+    std::string da_filename = std::string(""),
+    const std::vector<std::uint64_t> *doc_starts = NULL,
+    bool compact_alphabet = false,
+    const std::uint64_t *sa_positions = NULL) {
 
   std::uint64_t total_io_volume = 0;
   std::uint64_t text_length = utils::file_size(text_filename) / sizeof(char_type);
 
+  // Turn paths absolute.
+  text_filename = utils::absolute_path(text_filename);
+  output_filename = utils::absolute_path(output_filename);
+  if (!stats_json_filename.empty())
+    stats_json_filename = utils::absolute_path(stats_json_filename);
+  if (!progress_filename.empty())
+    progress_filename = utils::absolute_path(progress_filename);
+  if (!bwt_filename.empty())
+    bwt_filename = utils::absolute_path(bwt_filename);
+  if (!lcp_filename.empty())
+    lcp_filename = utils::absolute_path(lcp_filename);
+  if (!isa_filename.empty())
+    isa_filename = utils::absolute_path(isa_filename);
+  if (!da_filename.empty())
+    da_filename = utils::absolute_path(da_filename);
+
+  if (sa_sample_rate == 0) {
+    fprintf(stderr, "\nError: sa_sample_rate = 0\n");
+    std::exit(EXIT_FAILURE);
+  }
+  if (!lcp_filename.empty() && (sa_sample_rate > 1 || !write_sa || pack_output)) {
+    fprintf(stderr, "\nError: computing the LCP array requires the full (not packed) suffix array\n");
+    std::exit(EXIT_FAILURE);
+  }
+  if (!da_filename.empty() && (doc_starts == NULL || doc_starts->empty())) {
+    fprintf(stderr, "\nError: computing the document array requires document starting positions\n");
+    std::exit(EXIT_FAILURE);
+  }
+  if (sa_positions != NULL && (sa_sample_rate > 1 || !write_sa ||
+        !isa_filename.empty() || !da_filename.empty() || !lcp_filename.empty())) {
+    fprintf(stderr, "\nError: the sparse suffix array excludes other sampled arrays and LCP\n");
+    std::exit(EXIT_FAILURE);
+  }
+
+  // Print initial messages.
+  fprintf(stderr, "Running fSAIS v0.1.0\n");
+  fprintf(stderr, "Timestamp = %s", utils::get_timestamp().c_str());
+  fprintf(stderr, "Text filename = %s\n", text_filename.c_str());
+  if (write_sa)
+    fprintf(stderr, "Output filename = %s\n", output_filename.c_str());
+  if (!isa_filename.empty())
+    fprintf(stderr, "ISA filename = %s\n", isa_filename.c_str());
+  if (!da_filename.empty())
+    fprintf(stderr, "Document array filename = %s\n", da_filename.c_str());
+  if (doc_starts != NULL)
+    fprintf(stderr, "Number of documents = %lu\n", (std::uint64_t)doc_starts->size());
+  if (sa_sample_rate > 1)
+    fprintf(stderr, "SA/ISA sample rate = %lu\n", sa_sample_rate);
+  if (sa_positions != NULL)
+    fprintf(stderr, "Sparse SA, selected positions = %lu\n",
+        sampled_sa_writer<text_offset_type>::n_selected(text_length, sa_positions));
+  if (pack_output)
+    fprintf(stderr, "Bit-packed output, bits per entry = %lu\n",
+        async_bit_packed_stream_writer::bits_for(text_length));
+  if (!bwt_filename.empty())
+    fprintf(stderr, "BWT filename = %s\n", bwt_filename.c_str());
+  if (!lcp_filename.empty())
+    fprintf(stderr, "LCP filename = %s\n", lcp_filename.c_str());
+  fprintf(stderr, "Text length = %lu\n", text_length);
+  fprintf(stderr, "RAM use = %lu (%.2LfMiB)\n", ram_use, (1.L * ram_use) / (1L << 20));
+  if (utils::get_ram_limit() > 0)
+    fprintf(stderr, "Hard RAM limit = %lu (%.2LfMiB)\n", utils::get_ram_limit(),
+        (1.L * utils::get_ram_limit()) / (1L << 20));
+  if (text_alphabet_size > 0)
+    fprintf(stderr, "Text alphabet size = %lu\n", text_alphabet_size);
+  else fprintf(stderr, "Text alphabet size = detected by a scan\n");
+  fprintf(stderr, "sizeof(char_type) = %lu\n", sizeof(char_type));
+  fprintf(stderr, "sizeof(text_offset_type) = %lu\n", sizeof(text_offset_type));
+  hardware_profile::print_summary();
+  fprintf(stderr, "\n\n");
+
+  // Start the timer.
+  long double start = utils::wclock();
+
+  // Zero alphabet size means that it should be detected.
+  if (text_alphabet_size == 0) {
+    text_alphabet_size = em_detect_alphabet_size<char_type>(text_filename, total_io_volume);
+    if (!compact_alphabet)
+      fprintf(stderr, "\n");
+  }
+
+  // Remap the text to the alphabet of symbols occurring in it.
+  std::string compact_text_filename("");
+  std::vector<char_type> compact_alphabet_symbols;
+  if (compact_alphabet) {
+    compact_text_filename = output_filename + "tmp." + utils::random_string_hash();
+    text_alphabet_size = em_compact_alphabet<char_type>(text_alphabet_size,
+        text_filename, compact_text_filename, compact_alphabet_symbols, total_io_volume);
+    fprintf(stderr, "\n");
+  }
+  std::string sa_text_filename = compact_text_filename.empty() ?
+    text_filename : compact_text_filename;
+
 #ifdef SAIS_DEBUG
   std::uint64_t max_permute_block_size = 0;
   std::uint64_t n_permute_blocks = 0;
@@ -700,25 +845,14 @@ void em_compute_sa(
   std::uint64_t n_blocks = (text_length + max_block_size - 1) / max_block_size;
 #endif
 
-  // Turn paths absolute.
-  text_filename = utils::absolute_path(text_filename);
-  output_filename = utils::absolute_path(output_filename);
-
-  // Print initial messages.
-  fprintf(stderr, "Running fSAIS v0.1.0\n");
-  fprintf(stderr, "Timestamp = %s", utils::get_timestamp().c_str());
-  fprintf(stderr, "Text filename = %s\n", text_filename.c_str());
-  fprintf(stderr, "Output filename = %s\n", output_filename.c_str());
-  fprintf(stderr, "Text length = %lu\n", text_length);
-  fprintf(stderr, "RAM use = %lu (%.2LfMiB)\n", ram_use, (1.L * ram_use) / (1L << 20));
-  fprintf(stderr, "Text alphabet size = %lu\n", text_alphabet_size);
-  fprintf(stderr, "sizeof(char_type) = %lu\n", sizeof(char_type));
-  fprintf(stderr, "sizeof(text_offset_type) = %lu\n", sizeof(text_offset_type));
-  fprintf(stderr, "\n\n");
-
-  // Start the timer.
-  long double start = utils::wclock();
+#ifdef SAIS_DEBUG
+  std::uint64_t initial_disk_allocation = utils::get_current_disk_allocation();
+#endif
+  if (!progress_filename.empty())
+    progress_reporter::start(progress_filename);
   fprintf(stderr, "Enter recursion level 0\n");
+  phase_stats::reset();
+  phase_stats::begin_phase("Recursion level 0", 0);
 
   // Induce minus star substrings of the normal text.
   std::vector<std::string> lex_sorted_minus_star_substrings_for_normal_string_filenames(n_permute_blocks);
@@ -726,7 +860,7 @@ void em_compute_sa(
     lex_sorted_minus_star_substrings_for_normal_string_filenames[permute_block_id] = output_filename + "tmp." + utils::random_string_hash();
   std::string minus_star_suffixes_count_filename = output_filename + "tmp." + utils::random_string_hash();
   std::uint64_t n_names = em_induce_minus_star_substrings<char_type, text_offset_type>(text_length, text_length,
-      text_alphabet_size, ram_use, max_permute_block_size, text_filename, output_filename,
+      text_alphabet_size, ram_use, max_permute_block_size, sa_text_filename, output_filename,
       minus_star_suffixes_count_filename, lex_sorted_minus_star_substrings_for_normal_string_filenames, total_io_volume);
 
   std::vector<std::uint64_t> block_count(n_permute_blocks);
@@ -905,13 +1039,49 @@ void em_compute_sa(
       lex_sorted_minus_star_suffixes_for_normal_string_block_ids_filename,
       total_io_volume);
 
+  // The LCP array is computed from the SA and BWT.
+  std::string sa_bwt_filename = bwt_filename;
+  if (sa_bwt_filename.empty() && !lcp_filename.empty())
+    sa_bwt_filename = output_filename + "tmp." + utils::random_string_hash();
+
   // Compute the write the final SA to disk.
-  em_induce_minus_and_plus_suffixes<char_type, text_offset_type>(text_alphabet_size,
+  std::uint64_t bwt_primary_index =
+    em_induce_minus_and_plus_suffixes<char_type, text_offset_type>(text_alphabet_size,
       text_length, text_length, max_block_size, ram_use, minus_pos_n_parts, next_block_leftmost_minus_star_plus_rank,
-      text_filename, lex_sorted_minus_star_suffixes_for_normal_string_block_ids_filename,
+      sa_text_filename, lex_sorted_minus_star_suffixes_for_normal_string_block_ids_filename,
       minus_star_suffixes_count_filename, output_filename,
       lex_sorted_minus_star_suffixes_for_normal_string_filenames,
-      total_io_volume, is_small_alphabet);
+      total_io_volume, is_small_alphabet, sa_bwt_filename,
+      sa_sample_rate, write_sa, isa_filename, pack_output,
+      da_filename, doc_starts, sa_positions);
+  phase_stats::end_phase();
+
+  // Write the position of $ in the BWT.
+  if (!bwt_filename.empty()) {
+    fprintf(stderr, "BWT primary index = %lu\n\n", bwt_primary_index);
+    std::FILE *f = utils::file_open(bwt_filename + ".pidx", "w");
+    fprintf(f, "%lu\n", bwt_primary_index);
+    std::fclose(f);
+  }
+
+  // Compute the LCP array.
+  if (!lcp_filename.empty()) {
+    em_compute_lcp<char_type, text_offset_type>(text_length, ram_use, lcp_width,
+        sa_text_filename, output_filename, sa_bwt_filename, lcp_filename, total_io_volume);
+    if (bwt_filename.empty())
+      utils::file_delete(sa_bwt_filename);
+  }
+
+  // Map the BWT back to the original alphabet.
+  if (!compact_text_filename.empty()) {
+    if (!bwt_filename.empty())
+      restore_symbols<char_type>(bwt_filename, compact_alphabet_symbols, total_io_volume);
+    utils::file_delete(compact_text_filename);
+#ifdef SAIS_DEBUG
+    initial_disk_allocation -= text_length * sizeof(char_type);
+#endif
+  }
+  progress_reporter::stop();
 
   // Print summary.
   long double total_time = utils::wclock() - start;
@@ -922,7 +1092,7 @@ void em_compute_sa(
   fprintf(stderr, "  I/O volume = %lu bytes (%.2Lf bytes/symbol)\n",
       total_io_volume, (1.L * total_io_volume) / text_length);
 
-#ifdef MONITOR_DISK_USAGE
+#ifdef MONITOR_IO_VOLUME
   fprintf(stderr, "  Internal I/O volume counter = %lu\n",
       utils::get_current_io_volume());
 #ifdef SAIS_DEBUG
@@ -937,11 +1107,66 @@ void em_compute_sa(
       utils::get_current_ram_allocation(),
       (1.L * utils::get_peak_ram_allocation()) / (1UL << 20));
 
-#ifdef MONITOR_DISK_USAGE
   fprintf(stderr, "  Disk allocation: cur = %.2LfGiB, peak = %.2LfGiB\n",
       (1.L * utils::get_current_disk_allocation()) / (1UL << 30),
       (1.L * utils::get_peak_disk_allocation()) / (1UL << 30));
+  phase_stats::print_io_wait_summary();
+
+#ifdef SAIS_DEBUG
+  // Only the output (sampled) SA/ISA/DA and BWT/LCP should remain on disk.
+  std::uint64_t samples_file_size = sampled_sa_writer<text_offset_type>::output_file_size(
+      text_length, sa_sample_rate, pack_output, sa_positions);
+  std::uint64_t expected_disk_allocation = initial_disk_allocation;
+  if (write_sa)
+    expected_disk_allocation += samples_file_size;
+  if (!isa_filename.empty())
+    expected_disk_allocation += samples_file_size;
+  if (!da_filename.empty())
+    expected_disk_allocation += sampled_sa_writer<text_offset_type>::document_array_file_size(
+        text_length, sa_sample_rate, doc_starts->size(), pack_output);
+  if (!bwt_filename.empty())
+    expected_disk_allocation += text_length * sizeof(char_type);
+  if (!lcp_filename.empty())
+    expected_disk_allocation += text_length * lcp_width;
+  if (utils::get_current_disk_allocation() != expected_disk_allocation) {
+    fprintf(stderr, "\nError: disk allocation = %lu, expected = %lu\n",
+        utils::get_current_disk_allocation(), expected_disk_allocation);
+  }
 #endif
+
+  // Write per-phase statistics.
+  if (!stats_json_filename.empty()) {
+    std::vector<std::pair<std::string, std::string> > header;
+    header.push_back(std::make_pair(std::string("text_filename"),
+          phase_stats::json_string(text_filename)));
+    header.push_back(std::make_pair(std::string("output_filename"),
+          phase_stats::json_string(output_filename)));
+    header.push_back(std::make_pair(std::string("text_length"),
+          utils::intToStr(text_length)));
+    header.push_back(std::make_pair(std::string("text_alphabet_size"),
+          utils::intToStr(text_alphabet_size)));
+    header.push_back(std::make_pair(std::string("sizeof_char_type"),
+          utils::intToStr(sizeof(char_type))));
+    header.push_back(std::make_pair(std::string("sizeof_text_offset_type"),
+          utils::intToStr(sizeof(text_offset_type))));
+    header.push_back(std::make_pair(std::string("ram_use"),
+          utils::intToStr(ram_use)));
+    header.push_back(std::make_pair(std::string("total_time_sec"),
+          phase_stats::json_time(total_time)));
+    header.push_back(std::make_pair(std::string("total_io_volume"),
+          utils::intToStr(total_io_volume)));
+    header.push_back(std::make_pair(std::string("total_bytes_read"),
+          utils::intToStr(utils::get_total_bytes_read())));
+    header.push_back(std::make_pair(std::string("total_bytes_written"),
+          utils::intToStr(utils::get_total_bytes_written())));
+    header.push_back(std::make_pair(std::string("peak_ram_bytes"),
+          utils::intToStr(utils::get_peak_ram_allocation())));
+    header.push_back(std::make_pair(std::string("peak_disk_bytes"),
+          utils::intToStr(utils::get_peak_disk_allocation())));
+    phase_stats::write_json(stats_json_filename, header);
+    fprintf(stderr, "  Phase statistics written to %s\n",
+        stats_json_filename.c_str());
+  }
 }
 
 }  // namespace fsais_private
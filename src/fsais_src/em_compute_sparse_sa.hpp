@@ -0,0 +1,296 @@
+/**
+ * @file    fsais_src/em_compute_sparse_sa.hpp
+ * @section LICENCE
+ *
+ * This file is part of fSAIS v0.1.0
+ * See: https://github.com/dominikkempa/fsais
+ *
+ * Copyright (C) 2016-2020
+ *   Dominik Kempa <dominik.kempa (at) gmail.com>
+ *   Juha Karkkainen <juha.karkkainen (at) cs.helsinki.fi>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ **/
+
+#ifndef __FSAIS_SRC_EM_COMPUTE_SPARSE_SA_HPP_INCLUDED
+#define __FSAIS_SRC_EM_COMPUTE_SPARSE_SA_HPP_INCLUDED
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <string>
+#include <algorithm>
+
+#include "io/async_stream_reader.hpp"
+#include "io/async_stream_writer.hpp"
+#include "io/async_bit_packed_stream_writer.hpp"
+#include "em_compact_alphabet.hpp"
+#include "em_compute_sa.hpp"
+#include "utils.hpp"
+
+
+namespace fsais_private {
+
+// Write the text of digits for the sparse suffix array. Every
+// k-symbol substring text[ik..ik+k) is encoded using n_digits
+// consecutive digits, each encoding (in base text_alphabet_size)
+// up to digit_length symbols. The last substring is padded
+// with zeros. Since the substrings encoded by all groups of digits
+// have equal lengths, the lexicographical order of the suffixes of
+// the text of digits starting at positions divisible by n_digits
+// is the same as the order of the corresponding suffixes of text
+// (the padding is resolved by the shorter suffix of digits).
+template<typename char_type, typename digit_type>
+void create_sparse_text(
+    std::string text_filename,
+    std::string digits_filename,
+    std::uint64_t text_alphabet_size,
+    std::uint64_t sparse_rate,
+    std::uint64_t digit_length,
+    std::uint64_t &total_io_volume) {
+  std::uint64_t text_length = utils::file_size(text_filename) / sizeof(char_type);
+  std::uint64_t n_substrings = (text_length + sparse_rate - 1) / sparse_rate;
+
+  typedef async_stream_reader<char_type> text_reader_type;
+  typedef async_stream_writer<digit_type> digits_writer_type;
+  text_reader_type *text_reader = new text_reader_type(text_filename, (4UL << 20), 4UL);
+  digits_writer_type *digits_writer = new digits_writer_type(digits_filename, (4UL << 20), 4UL);
+  std::uint64_t pos = 0;
+  for (std::uint64_t i = 0; i < n_substrings; ++i) {
+    for (std::uint64_t beg = 0; beg < sparse_rate; beg += digit_length) {
+      std::uint64_t end = std::min(sparse_rate, beg + digit_length);
+      std::uint64_t digit = 0;
+      for (std::uint64_t j = beg; j < end; ++j) {
+        std::uint64_t c = (pos < text_length) ? (std::uint64_t)text_reader->read() : 0;
+        digit = digit * text_alphabet_size + c;
+        ++pos;
+      }
+      digits_writer->write(digit);
+    }
+  }
+
+  // Stop I/O thread.
+  text_reader->stop_reading();
+
+  // Update I/O volume.
+  total_io_volume += text_reader->bytes_read() + digits_writer->bytes_written();
+
+  // Clean up.
+  delete digits_writer;
+  delete text_reader;
+}
+
+// Compute the sparse suffix array of the text, i.e., the sorted
+// suffixes starting at positions 0, k, 2k, ..., where k is the
+// sparse_rate. Every k-symbol substring of the text starting at
+// these positions is encoded using the smallest number of digits
+// (see create_sparse_text) and the suffix array of the resulting
+// text of n / k * ceil(k / d) digits is computed using em_compute_sa.
+// The number d of symbols per digit is the largest such that the
+// digits alphabet has at most 2^24 symbols (d = 3 for bytes), which
+// keeps the radix heaps and per-symbol arrays of em_compute_sa small.
+// The SA entries divisible by the number of digits per substring
+// are then mapped to the text positions.
+template<typename char_type,
+  typename text_offset_type,
+  typename digit_type>
+void em_compute_sparse_sa(
+    std::uint64_t ram_use,
+    std::uint64_t text_alphabet_size,
+    std::uint64_t digits_alphabet_size,
+    std::uint64_t sparse_rate,
+    std::uint64_t digit_length,
+    std::string text_filename,
+    std::string output_filename,
+    std::string stats_json_filename,
+    std::string progress_filename,
+    bool pack_output,
+    std::uint64_t &total_io_volume) {
+  std::uint64_t text_length = utils::file_size(text_filename) / sizeof(char_type);
+  std::uint64_t n_substrings = (text_length + sparse_rate - 1) / sparse_rate;
+  std::uint64_t n_digits = (sparse_rate + digit_length - 1) / digit_length;
+
+  // Create the text of digits.
+  fprintf(stderr, "Create the text of digits: ");
+  long double start = utils::wclock();
+  std::string digits_filename = output_filename + "tmp." + utils::random_string_hash();
+  create_sparse_text<char_type, digit_type>(text_filename, digits_filename,
+      text_alphabet_size, sparse_rate, digit_length, total_io_volume);
+  fprintf(stderr, "%.2Lfs\n\n", utils::wclock() - start);
+
+  // Compute the suffix array of digits.
+  std::string digits_sa_filename = output_filename + "tmp." + utils::random_string_hash();
+  std::uint64_t io_volume_before_sort =
+    utils::get_total_bytes_read() + utils::get_total_bytes_written();
+  em_compute_sa<digit_type, text_offset_type>(ram_use, digits_alphabet_size,
+      digits_filename, digits_sa_filename, stats_json_filename, progress_filename);
+  total_io_volume += (utils::get_total_bytes_read() +
+      utils::get_total_bytes_written()) - io_volume_before_sort;
+  utils::file_delete(digits_filename);
+
+  // Map the suffixes starting at the first digit
+  // of each substring to positions in the text.
+  fprintf(stderr, "Write the sparse suffix array: ");
+  start = utils::wclock();
+  {
+    typedef async_stream_reader<text_offset_type> sa_reader_type;
+    typedef async_stream_writer<text_offset_type> sa_writer_type;
+    typedef async_bit_packed_stream_writer packed_sa_writer_type;
+    sa_reader_type *sa_reader = new sa_reader_type(digits_sa_filename, (4UL << 20), 4UL);
+    sa_writer_type *sa_writer = NULL;
+    packed_sa_writer_type *packed_sa_writer = NULL;
+    if (pack_output)
+      packed_sa_writer = new packed_sa_writer_type(output_filename, n_substrings,
+          packed_sa_writer_type::bits_for(text_length), (4UL << 20), 4UL);
+    else sa_writer = new sa_writer_type(output_filename, (4UL << 20), 4UL);
+    for (std::uint64_t i = 0; i < n_substrings * n_digits; ++i) {
+      std::uint64_t pos = sa_reader->read();
+      if (pos % n_digits == 0) {
+        pos = (pos / n_digits) * sparse_rate;
+        if (pack_output)
+          packed_sa_writer->write(pos);
+        else sa_writer->write(pos);
+      }
+    }
+
+    // Stop I/O thread.
+    sa_reader->stop_reading();
+
+    // Update I/O volume.
+    total_io_volume += sa_reader->bytes_read() + (pack_output ?
+        packed_sa_writer->bytes_written() : sa_writer->bytes_written());
+
+    // Clean up.
+    delete sa_writer;
+    delete packed_sa_writer;
+    delete sa_reader;
+  }
+  utils::file_delete(digits_sa_filename);
+  fprintf(stderr, "%.2Lfs\n", utils::wclock() - start);
+}
+
+template<typename char_type,
+  typename text_offset_type>
+void em_compute_sparse_sa(
+    std::uint64_t ram_use,
+    std::uint64_t text_alphabet_size,
+    std::uint64_t sparse_rate,
+    std::string text_filename,
+    std::string output_filename,
+    std::string stats_json_filename = std::string(""),
+    std::string progress_filename = std::string(""),
+    bool pack_output = false) {
+  std::uint64_t total_io_volume = 0;
+  std::uint64_t text_length = utils::file_size(text_filename) / sizeof(char_type);
+  text_filename = utils::absolute_path(text_filename);
+  output_filename = utils::absolute_path(output_filename);
+  if (text_length == 0) {
+    fprintf(stderr, "\nError: text_length = 0\n");
+    std::exit(EXIT_FAILURE);
+  }
+  if (sparse_rate == 0) {
+    fprintf(stderr, "\nError: sparse_rate = 0\n");
+    std::exit(EXIT_FAILURE);
+  }
+
+  fprintf(stderr, "Running fSAIS v0.1.0 (sparse suffix array)\n");
+  fprintf(stderr, "Text filename = %s\n", text_filename.c_str());
+  fprintf(stderr, "Output filename = %s\n", output_filename.c_str());
+  fprintf(stderr, "Text length = %lu\n", text_length);
+  fprintf(stderr, "Sparse SA, selected positions = 0, %lu, %lu, ...\n",
+      sparse_rate, 2 * sparse_rate);
+  long double start = utils::wclock();
+
+  // Zero alphabet size means that it should be detected.
+  if (text_alphabet_size == 0)
+    text_alphabet_size = em_detect_alphabet_size<char_type>(text_filename, total_io_volume);
+
+  // Choose the number of symbols encoded by a digit.
+  std::uint64_t digit_length = 1;
+  std::uint64_t digits_alphabet_size = text_alphabet_size;
+  while (digit_length < sparse_rate &&
+      digits_alphabet_size <= (1UL << 24) / text_alphabet_size) {
+    digits_alphabet_size *= text_alphabet_size;
+    ++digit_length;
+  }
+  fprintf(stderr, "Symbols per digit = %lu\n", digit_length);
+  fprintf(stderr, "Digits alphabet size = %lu\n\n\n", digits_alphabet_size);
+
+  if (digits_alphabet_size <= (1UL << 8))
+    em_compute_sparse_sa<char_type, text_offset_type, std::uint8_t>(ram_use,
+        text_alphabet_size, digits_alphabet_size, sparse_rate, digit_length,
+        text_filename, output_filename, stats_json_filename, progress_filename,
+        pack_output, total_io_volume);
+  else if (digits_alphabet_size <= (1UL << 16))
+    em_compute_sparse_sa<char_type, text_offset_type, std::uint16_t>(ram_use,
+        text_alphabet_size, digits_alphabet_size, sparse_rate, digit_length,
+        text_filename, output_filename, stats_json_filename, progress_filename,
+        pack_output, total_io_volume);
+  else
+    em_compute_sparse_sa<char_type, text_offset_type, std::uint32_t>(ram_use,
+        text_alphabet_size, digits_alphabet_size, sparse_rate, digit_length,
+        text_filename, output_filename, stats_json_filename, progress_filename,
+        pack_output, total_io_volume);
+
+  // Print summary.
+  long double total_time = utils::wclock() - start;
+  fprintf(stderr, "\n\nSparse suffix array computed. Summary:\n");
+  fprintf(stderr, "  Absolute time = %.2Lfs\n", total_time);
+  fprintf(stderr, "  I/O volume = %lu bytes (%.2Lf bytes/symbol)\n",
+      total_io_volume, (1.L * total_io_volume) / text_length);
+}
+
+// Read the bit vector of selected positions of the sparse suffix
+// array (bit i % 8 of byte i / 8 of the file is set if position i is
+// selected) into words of 64 bits (as expected by sampled_sa_writer).
+inline std::uint64_t *read_sparse_positions(
+    std::string positions_filename,
+    std::uint64_t text_length) {
+  std::uint64_t n_bytes = (text_length + 7) / 8;
+  if (utils::file_size(positions_filename) != n_bytes) {
+    fprintf(stderr, "\nError: the bit vector of positions (%s) must have %lu bytes\n",
+        positions_filename.c_str(), n_bytes);
+    std::exit(EXIT_FAILURE);
+  }
+  std::uint64_t n_words = (text_length + 63) / 64;
+  std::uint64_t *sa_positions = utils::allocate_array<std::uint64_t>(n_words);
+  std::fill(sa_positions, sa_positions + n_words, 0UL);
+  std::uint8_t *bytes = utils::allocate_array<std::uint8_t>(std::min(n_bytes, (1UL << 20)));
+  std::FILE *f = utils::file_open_nobuf(positions_filename, "r");
+  for (std::uint64_t beg = 0; beg < n_bytes; beg += (1UL << 20)) {
+    std::uint64_t end = std::min(n_bytes, beg + (1UL << 20));
+    utils::read_from_file(bytes, end - beg, f);
+    for (std::uint64_t j = beg; j < end; ++j)
+      sa_positions[j >> 3] |= ((std::uint64_t)bytes[j - beg] << (8 * (j & 7)));
+  }
+  std::fclose(f);
+  utils::deallocate(bytes);
+
+  // Clear the bits beyond the end of text.
+  if (text_length & 63)
+    sa_positions[n_words - 1] &= (1UL << (text_length & 63)) - 1;
+  return sa_positions;
+}
+
+}  // namespace fsais_private
+
+#endif  // __FSAIS_SRC_EM_COMPUTE_SPARSE_SA_HPP_INCLUDED
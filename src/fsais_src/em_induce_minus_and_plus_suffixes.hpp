@@ -40,6 +40,7 @@
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <utility>
 
 #include "io/async_stream_writer.hpp"
 #include "io/async_multi_bit_stream_reader.hpp"
@@ -52,7 +53,12 @@
 #include "im_induce_suffixes.hpp"
 #include "em_induce_plus_suffixes.hpp"
 #include "em_radix_heap.hpp"
+#include "hardware_profile.hpp"
+#include "em_bucket_queue.hpp"
+#include "sampled_sa_writer.hpp"
 #include "utils.hpp"
+#include "phase_stats.hpp"
+#include "progress_reporter.hpp"
 #include "../uint24.hpp"
 #include "../uint40.hpp"
 #include "../uint48.hpp"
@@ -62,8 +68,9 @@ namespace fsais_private {
 
 template<typename char_type,
   typename text_offset_type,
-  typename block_id_type>
-void em_induce_minus_and_plus_suffixes(
+  typename block_id_type,
+  typename radix_heap_type>
+std::uint64_t em_induce_minus_and_plus_suffixes(
     std::uint64_t text_alphabet_size,
     std::uint64_t text_length,
     std::uint64_t initial_text_length,
@@ -78,8 +85,20 @@ void em_induce_minus_and_plus_suffixes(
     std::vector<std::string> &minus_type_filenames,
     std::vector<std::string> &minus_pos_filenames,
     std::vector<std::string> &symbols_filenames,
-    std::uint64_t &total_io_volume) {
+    std::uint64_t &total_io_volume,
+    std::string bwt_filename = std::string(""),
+    std::string plus_bwt_filename = std::string(""),
+    std::string minus_star_bwt_filename = std::string(""),
+    std::uint64_t sa_sample_rate = 1,
+    bool write_sa = true,
+    std::string isa_filename = std::string(""),
+    bool pack_output = false,
+    std::string da_filename = std::string(""),
+    const std::vector<std::uint64_t> *doc_starts = NULL,
+    const std::uint64_t *sa_positions = NULL) {
   std::uint64_t n_blocks = (text_length + max_block_size - 1) / max_block_size;
+  bool compute_bwt = !bwt_filename.empty();
+  bool compute_isa = !isa_filename.empty();
 
   if (text_length == 0) {
     fprintf(stderr, "\nError: text_length = 0\n");
@@ -116,9 +135,23 @@ void em_induce_minus_and_plus_suffixes(
   }
 
   // Decide on the RAM budget allocation.
-  std::uint64_t opt_buf_size = (1UL << 20);
+  std::uint64_t opt_buf_size = hardware_profile::opt_request_size();
   std::uint64_t computed_buf_size = 0;
-  std::uint64_t n_buffers = 3 * n_blocks + 16;
+  // The ISA samples are permuted in blocks using half of the RAM.
+#ifdef SAIS_DEBUG
+  std::uint64_t n_isa_samples = sampled_sa_writer<text_offset_type>::n_samples(text_length, sa_sample_rate);
+  std::uint64_t max_isa_block_size = utils::random_int64(1L, n_isa_samples);
+  while ((n_isa_samples + max_isa_block_size - 1) / max_isa_block_size > (1UL << 8))
+    max_isa_block_size = utils::random_int64(1L, n_isa_samples);
+#else
+  std::uint64_t max_isa_block_size = std::max(1UL, (ram_use / 2) / sizeof(text_offset_type));
+#endif
+  std::uint64_t n_isa_blocks = compute_isa ? (text_length + sa_sample_rate *
+      max_isa_block_size - 1) / (sa_sample_rate * max_isa_block_size) : 0;
+
+  // With BWT: bwt_writer, plus_bwt_reader and minus_star_bwt_reader
+  // (each using 4 buffers).
+  std::uint64_t n_buffers = 3 * n_blocks + 16 + (compute_bwt ? 12 : 0) + n_isa_blocks;
   std::uint64_t ram_for_radix_heap = 0;
   std::uint64_t ram_for_buffers = 0;
   if (opt_buf_size * n_buffers <= ram_use / 2) {
@@ -130,27 +163,22 @@ void em_induce_minus_and_plus_suffixes(
     ram_for_buffers = ram_use - ram_for_radix_heap;
     computed_buf_size = std::max(1UL, ram_for_buffers / n_buffers);
   }
+  std::vector<std::uint64_t> radix_logs =
+    utils::radix_logs_for_keys(text_alphabet_size, 10UL);
+  hardware_profile::tune_ram_split(n_buffers, radix_logs,
+      computed_buf_size, ram_for_buffers, ram_for_radix_heap);
 
   // Start the timer.
   long double start = utils::wclock();
+  phase_stats::begin_phase("EM induce minus and plus suffixes (final pass)");
   fprintf(stderr, "    EM induce minus and plus suffixes:\n");
   fprintf(stderr, "      Single buffer size = %lu (%.1LfMiB)\n", computed_buf_size, (1.L * computed_buf_size) / (1L << 20));
   fprintf(stderr, "      All buffers RAM budget = %lu (%.1LfMiB)\n", ram_for_buffers, (1.L * ram_for_buffers) / (1L << 20));
   fprintf(stderr, "      Radix heap RAM budget = %lu (%.1LfMiB)\n", ram_for_radix_heap, (1.L * ram_for_radix_heap) / (1L << 20));
 
   // Initialize radix heap.
-  std::vector<std::uint64_t> radix_logs;
-  {
-    std::uint64_t target_sum = 8UL * sizeof(char_type);
-    std::uint64_t cur_sum = 0;
-    while (cur_sum < target_sum) {
-      std::uint64_t radix_log = std::min(10UL, target_sum - cur_sum);
-      radix_logs.push_back(radix_log);
-      cur_sum += radix_log;
-    }
-  }
-  typedef em_radix_heap<char_type, block_id_type> radix_heap_type;
   radix_heap_type *radix_heap = new radix_heap_type(radix_logs, output_filename, ram_for_radix_heap);
+  radix_heap->set_phase_name("EM induce minus and plus suffixes");
 
   // Initialize the readers for plus suffixes.
   typedef async_backward_stream_reader_multipart<text_offset_type> plus_pos_reader_type;
@@ -188,12 +216,33 @@ void em_induce_minus_and_plus_suffixes(
     symbols_reader->add_file(symbols_filenames[block_id]);
 
   // Initialize output writer.
-  typedef async_stream_writer<text_offset_type> output_writer_type;
-  output_writer_type *output_writer = new output_writer_type(output_filename, 4UL * computed_buf_size, 4UL);
+  typedef sampled_sa_writer<text_offset_type> output_writer_type;
+  output_writer_type *output_writer = new output_writer_type(text_length, sa_sample_rate, max_isa_block_size,
+      write_sa ? output_filename : std::string(""), isa_filename, computed_buf_size, pack_output,
+      da_filename, doc_starts, sa_positions);
+
+  // Initialize the BWT writer and the readers of symbols preceding
+  // suffixes that are preceded by a plus suffix (computed in EM
+  // induce plus suffixes in the reverse order). The BWT is the BWT
+  // of text$ with $ removed, the position of $ is written separately.
+  typedef async_stream_writer<char_type> bwt_writer_type;
+  typedef async_backward_stream_reader<char_type> bwt_reader_type;
+  bwt_writer_type *bwt_writer = NULL;
+  bwt_reader_type *plus_bwt_reader = NULL;
+  bwt_reader_type *minus_star_bwt_reader = NULL;
+  std::uint64_t bwt_primary_index = 0;
+  std::uint64_t bwt_rows = 1;
+  if (compute_bwt) {
+    bwt_writer = new bwt_writer_type(bwt_filename, 4UL * computed_buf_size, 4UL);
+    plus_bwt_reader = new bwt_reader_type(plus_bwt_filename, 4UL * computed_buf_size, 4UL);
+    minus_star_bwt_reader = new bwt_reader_type(minus_star_bwt_filename, 4UL * computed_buf_size, 4UL);
+    bwt_writer->write(last_text_symbol);
+  }
 
   // Induce minus suffixes.
   radix_heap->push(last_text_symbol, (text_length - 1) / max_block_size);
   std::uint64_t cur_symbol = 0;
+  progress_counter progress(text_length);
   while (!plus_count_reader->empty() || !radix_heap->empty()) {
 
     // Process minus suffixes.
@@ -204,12 +253,19 @@ void em_induce_minus_and_plus_suffixes(
       std::uint64_t head_pos = head_pos_block_beg + minus_pos_reader->read_from_ith_file(head_pos_block_id);
       bool is_head_pos_star = minus_type_reader->read_from_ith_file(head_pos_block_id);
       output_writer->write(head_pos);
+      progress.increment();
 
       if (head_pos > 0 && !is_head_pos_star) {
         std::uint64_t prev_pos_char = symbols_reader->read_from_ith_file(head_pos_block_id);
         std::uint64_t prev_pos_block_id = (head_pos_block_id * max_block_size == head_pos) ? head_pos_block_id - 1 : head_pos_block_id;
         radix_heap->push(prev_pos_char, prev_pos_block_id);
+        if (compute_bwt)
+          bwt_writer->write(prev_pos_char);
+      } else if (compute_bwt) {
+        if (head_pos == 0) bwt_primary_index = bwt_rows;
+        else bwt_writer->write(minus_star_bwt_reader->read());
       }
+      bwt_rows += compute_bwt;
     }
 
     // Process plus suffixes.
@@ -219,13 +275,20 @@ void em_induce_minus_and_plus_suffixes(
         std::uint64_t head_pos = plus_pos_reader->read();
         std::uint64_t head_pos_uint64 = head_pos;
         output_writer->write(head_pos);
+        progress.increment();
         if (plus_type_reader->read()) {
           std::uint64_t head_pos_block_id = head_pos_uint64 / max_block_size;
           bool is_head_pos_at_block_boundary = (head_pos_block_id * max_block_size == head_pos);
           std::uint64_t prev_pos_block_id = head_pos_block_id - is_head_pos_at_block_boundary;
           std::uint64_t prev_pos_char = symbols_reader->read_from_ith_file(head_pos_block_id);
           radix_heap->push(prev_pos_char, prev_pos_block_id);
+          if (compute_bwt)
+            bwt_writer->write(prev_pos_char);
+        } else if (compute_bwt) {
+          if (head_pos_uint64 == 0) bwt_primary_index = bwt_rows;
+          else bwt_writer->write(plus_bwt_reader->read());
         }
+        bwt_rows += compute_bwt;
       }
     }
 
@@ -249,12 +312,21 @@ void em_induce_minus_and_plus_suffixes(
     plus_count_reader->bytes_read() +
     minus_pos_reader->bytes_read() +
     minus_type_reader->bytes_read() +
-    symbols_reader->bytes_read() +
-    output_writer->bytes_written();
-  total_io_volume += io_volume;
+    symbols_reader->bytes_read();
+
+  if (compute_bwt) {
+    plus_bwt_reader->stop_reading();
+    minus_star_bwt_reader->stop_reading();
+    io_volume +=
+      plus_bwt_reader->bytes_read() +
+      minus_star_bwt_reader->bytes_read() +
+      bwt_writer->bytes_written();
+    delete minus_star_bwt_reader;
+    delete plus_bwt_reader;
+    delete bwt_writer;
+  }
 
   // Clean up.
-  delete output_writer;
   delete symbols_reader;
   delete minus_type_reader;
   delete minus_pos_reader;
@@ -263,175 +335,28 @@ void em_induce_minus_and_plus_suffixes(
   delete plus_pos_reader;
   delete radix_heap;
 
+  // Write the ISA samples.
+  output_writer->finish();
+  io_volume += output_writer->io_volume();
+  total_io_volume += io_volume;
+  delete output_writer;
+
   // Print summary.
   long double total_time = utils::wclock() - start;
+  phase_stats::end_phase();
   fprintf(stderr, "      Time = %.2Lfs, I/O = %.2LfMiB/s, "
       "total I/O vol = %.1Lf bytes/symbol (of initial text)\n\n",
       total_time, (1.L * io_volume / (1L << 20)) / total_time,
       (1.L * total_io_volume) / initial_text_length);
-}
-
-template<typename char_type,
-  typename text_offset_type,
-  typename block_id_type>
-void em_induce_minus_and_plus_suffixes(
-    std::uint64_t text_alphabet_size,
-    std::uint64_t text_length,
-    std::uint64_t initial_text_length,
-    std::uint64_t max_block_size,
-    std::uint64_t ram_use,
-    std::uint64_t minus_pos_n_parts,
-    std::vector<std::uint64_t> &next_block_leftmost_minus_star_plus_rank,
-    std::string text_filename,
-    std::string minus_pos_filename,
-    std::string minus_count_filename,
-    std::string output_filename,
-    std::vector<std::string> &init_minus_pos_filenames,
-    std::uint64_t &total_io_volume,
-    bool is_small_alphabet) {
-  std::uint64_t n_blocks = (text_length + max_block_size - 1) / max_block_size;
-
-  fprintf(stderr, "  EM induce minus and plus suffixes:\n");
-  fprintf(stderr, "    sizeof(block_id_type) = %lu\n", sizeof(block_id_type));
-
-  char_type last_text_symbol;
-  std::uint64_t last_text_symbol_offset =
-    sizeof(char_type) * (text_length - 1);
-  utils::read_at_offset(&last_text_symbol,
-      last_text_symbol_offset, 1, text_filename);
-  total_io_volume += sizeof(char_type);
-
-  std::vector<std::string> plus_type_filenames(n_blocks);
-  std::vector<std::string> minus_type_filenames(n_blocks);
-  std::vector<std::string> plus_symbols_filenames(n_blocks);
-  std::vector<std::string> minus_symbols_filenames(n_blocks);
-  std::vector<std::string> plus_pos_filenames(n_blocks);
-  std::vector<std::string> minus_pos_filenames(n_blocks);
-  std::vector<std::uint64_t> block_count_target(n_blocks, std::numeric_limits<std::uint64_t>::max());
-  for (std::uint64_t block_id = 0; block_id < n_blocks; ++block_id) {
-    plus_pos_filenames[block_id] = output_filename + "tmp." + utils::random_string_hash();
-    plus_symbols_filenames[block_id] = output_filename + "tmp." + utils::random_string_hash();
-    plus_type_filenames[block_id] = output_filename + "tmp." + utils::random_string_hash();
-    minus_pos_filenames[block_id] = output_filename + "tmp." + utils::random_string_hash();
-    minus_type_filenames[block_id] = output_filename + "tmp." + utils::random_string_hash();
-    minus_symbols_filenames[block_id] = output_filename + "tmp." + utils::random_string_hash();
-  }
-
-  im_induce_suffixes<
-    char_type,
-    text_offset_type>(
-        text_alphabet_size,
-        text_length,
-        initial_text_length,
-        max_block_size,
-        next_block_leftmost_minus_star_plus_rank,
-        text_filename,
-        init_minus_pos_filenames,
-        plus_pos_filenames,
-        plus_symbols_filenames,
-        plus_type_filenames,
-        minus_pos_filenames,
-        minus_type_filenames,
-        minus_symbols_filenames,
-        block_count_target,
-        total_io_volume,
-        is_small_alphabet);
-
-  std::string plus_type_filename = output_filename + "tmp." + utils::random_string_hash();
-  std::string plus_count_filename = output_filename + "tmp." + utils::random_string_hash();
-  std::string plus_pos_filename = output_filename + "tmp." + utils::random_string_hash();
-
-  std::uint64_t n_parts = em_induce_plus_suffixes<
-    char_type,
-    text_offset_type,
-    block_id_type>(
-        text_alphabet_size,
-        text_length,
-        initial_text_length,
-        max_block_size,
-        ram_use,
-        minus_pos_n_parts,
-        block_count_target,
-        plus_pos_filename,
-        plus_type_filename,
-        plus_count_filename,
-        minus_pos_filename,
-        minus_count_filename,
-        plus_type_filenames,
-        plus_pos_filenames,
-        plus_symbols_filenames,
-        total_io_volume);
-
-  utils::file_delete(minus_count_filename);
-  for (std::uint64_t i = 0; i < n_blocks; ++i)
-    if (utils::file_exists(plus_type_filenames[i])) utils::file_delete(plus_type_filenames[i]);
 
-  em_induce_minus_and_plus_suffixes<
-    char_type,
-    text_offset_type,
-    block_id_type>(
-        text_alphabet_size,
-        text_length,
-        initial_text_length,
-        max_block_size,
-        ram_use,
-        n_parts,
-        last_text_symbol,
-        output_filename,
-        plus_pos_filename,
-        plus_type_filename,
-        plus_count_filename,
-        minus_type_filenames,
-        minus_pos_filenames,
-        minus_symbols_filenames,
-        total_io_volume);
-
-  utils::file_delete(plus_type_filename);
-  utils::file_delete(plus_count_filename);
-  for (std::uint64_t j = 0; j < n_blocks; ++j)
-    if (utils::file_exists(minus_type_filenames[j])) utils::file_delete(minus_type_filenames[j]);
-}
-
-template<typename char_type,
-  typename text_offset_type>
-void em_induce_minus_and_plus_suffixes(
-    std::uint64_t text_alphabet_size,
-    std::uint64_t text_length,
-    std::uint64_t initial_text_length,
-    std::uint64_t max_block_size,
-    std::uint64_t ram_use,
-    std::uint64_t minus_pos_n_parts,
-    std::vector<std::uint64_t> &next_block_leftmost_minus_star_plus_rank,
-    std::string text_filename,
-    std::string minus_pos_filename,
-    std::string minus_count_filename,
-    std::string output_filename,
-    std::vector<std::string> &init_minus_pos_filenames,
-    std::uint64_t &total_io_volume,
-    bool is_small_alphabet) {
-  std::uint64_t n_blocks = (text_length + max_block_size - 1) / max_block_size;
-  if (n_blocks < (1UL << 8)) {
-    em_induce_minus_and_plus_suffixes<char_type, text_offset_type, std::uint8_t>(text_alphabet_size, text_length,
-        initial_text_length, max_block_size, ram_use, minus_pos_n_parts, next_block_leftmost_minus_star_plus_rank, text_filename, minus_pos_filename,
-        minus_count_filename, output_filename, init_minus_pos_filenames, total_io_volume, is_small_alphabet);
-  } else if (n_blocks < (1UL << 16)) {
-    em_induce_minus_and_plus_suffixes<char_type, text_offset_type, std::uint16_t>(text_alphabet_size, text_length,
-        initial_text_length, max_block_size, ram_use, minus_pos_n_parts, next_block_leftmost_minus_star_plus_rank, text_filename, minus_pos_filename,
-        minus_count_filename, output_filename, init_minus_pos_filenames, total_io_volume, is_small_alphabet);
-  } else if (n_blocks < (1UL << 24)) {
-    em_induce_minus_and_plus_suffixes<char_type, text_offset_type, uint24>(text_alphabet_size, text_length,
-        initial_text_length, max_block_size, ram_use, minus_pos_n_parts, next_block_leftmost_minus_star_plus_rank, text_filename, minus_pos_filename,
-        minus_count_filename, output_filename, init_minus_pos_filenames, total_io_volume, is_small_alphabet);
-  } else {
-    em_induce_minus_and_plus_suffixes<char_type, text_offset_type, std::uint64_t>(text_alphabet_size, text_length,
-        initial_text_length, max_block_size, ram_use, minus_pos_n_parts, next_block_leftmost_minus_star_plus_rank, text_filename, minus_pos_filename,
-        minus_count_filename, output_filename, init_minus_pos_filenames, total_io_volume, is_small_alphabet);
-  }
+  // Return the position of $ in the BWT.
+  return bwt_primary_index;
 }
 
 template<typename char_type,
   typename text_offset_type,
-  typename block_id_type>
+  typename block_id_type,
+  typename radix_heap_type>
 void em_induce_minus_and_plus_suffixes(
     std::uint64_t text_alphabet_size,
     std::uint64_t text_length,
@@ -488,7 +413,7 @@ void em_induce_minus_and_plus_suffixes(
   }
 
   // Decide on the RAM budget allocation.
-  std::uint64_t opt_buf_size = (1UL << 20);
+  std::uint64_t opt_buf_size = hardware_profile::opt_request_size();
   std::uint64_t computed_buf_size = 0;
   std::uint64_t n_buffers = 3 * n_blocks + block_count.size() + 20;
   std::uint64_t ram_for_radix_heap = 0;
@@ -502,27 +427,22 @@ void em_induce_minus_and_plus_suffixes(
     ram_for_buffers = ram_use - ram_for_radix_heap;
     computed_buf_size = std::max(1UL, ram_for_buffers / n_buffers);
   }
+  std::vector<std::uint64_t> radix_logs =
+    utils::radix_logs_for_keys(text_alphabet_size, 10UL);
+  hardware_profile::tune_ram_split(n_buffers, radix_logs,
+      computed_buf_size, ram_for_buffers, ram_for_radix_heap);
 
   // Start the timer.
   long double start = utils::wclock();
+  phase_stats::begin_phase("EM induce minus and plus suffixes (final pass)");
   fprintf(stderr, "    EM induce minus and plus suffixes:\n");
   fprintf(stderr, "      Single buffer size = %lu (%.1LfMiB)\n", computed_buf_size, (1.L * computed_buf_size) / (1L << 20));
   fprintf(stderr, "      All buffers RAM budget = %lu (%.1LfMiB)\n", ram_for_buffers, (1.L * ram_for_buffers) / (1L << 20));
   fprintf(stderr, "      Radix heap RAM budget = %lu (%.1LfMiB)\n", ram_for_radix_heap, (1.L * ram_for_radix_heap) / (1L << 20));
 
   // Initialize radix heap.
-  std::vector<std::uint64_t> radix_logs;
-  {
-    std::uint64_t target_sum = 8UL * sizeof(char_type);
-    std::uint64_t cur_sum = 0;
-    while (cur_sum < target_sum) {
-      std::uint64_t radix_log = std::min(10UL, target_sum - cur_sum);
-      radix_logs.push_back(radix_log);
-      cur_sum += radix_log;
-    }
-  }
-  typedef em_radix_heap<char_type, block_id_type> radix_heap_type;
   radix_heap_type *radix_heap = new radix_heap_type(radix_logs, tempfile_basename, ram_for_radix_heap);
+  radix_heap->set_phase_name("EM induce minus and plus suffixes");
 
   // Initialize the readers for plus suffixes.
   typedef async_backward_stream_reader_multipart<text_offset_type> plus_pos_reader_type;
@@ -601,6 +521,7 @@ void em_induce_minus_and_plus_suffixes(
   // Induce minus suffixes.
   radix_heap->push(last_text_symbol, (text_length - 1) / max_block_size);
   std::uint64_t cur_symbol = 0;
+  progress_counter progress(text_length);
   while (!plus_count_reader->empty() || !radix_heap->empty()) {
 
     // Process minus suffixes.
@@ -619,6 +540,7 @@ void em_induce_minus_and_plus_suffixes(
         std::uint64_t block_offset = head_pos - sum_of_prev_blocks[output_block_id];
         block_id_writer->write(output_block_id);
         pos_writer->write_to_ith_file(output_block_id, block_offset);
+        progress.increment();
       }
 
       if (head_pos > 0 && !is_head_pos_star) {
@@ -642,6 +564,7 @@ void em_induce_minus_and_plus_suffixes(
           std::uint64_t block_offset = head_pos - sum_of_prev_blocks[output_block_id];
           block_id_writer->write(output_block_id);
           pos_writer->write_to_ith_file(output_block_id, block_offset);
+          progress.increment();
         }
 
         if (plus_type_reader->read()) {
@@ -692,12 +615,253 @@ void em_induce_minus_and_plus_suffixes(
 
   // Print summary.
   long double total_time = utils::wclock() - start;
+  phase_stats::end_phase();
   fprintf(stderr, "      Time = %.2Lfs, I/O = %.2LfMiB/s, "
       "total I/O vol = %.1Lf bytes/symbol (of initial text)\n\n",
       total_time, (1.L * io_volume / (1L << 20)) / total_time,
       (1.L * total_io_volume) / initial_text_length);
 }
 
+// Run em_induce_minus_and_plus_suffixes with the bucket queue
+// (for small alphabets) or with the radix heap as the priority queue.
+template<typename char_type,
+  typename text_offset_type,
+  typename block_id_type,
+  typename... args_type>
+auto em_induce_minus_and_plus_suffixes_with_queue(
+    bool use_bucket_queue,
+    args_type&&... args)
+  -> decltype(em_induce_minus_and_plus_suffixes<char_type, text_offset_type,
+      block_id_type, em_radix_heap<char_type, block_id_type> >(
+        std::forward<args_type>(args)...)) {
+  typedef em_radix_heap<char_type, block_id_type> radix_heap_type;
+  typedef em_bucket_queue<char_type, block_id_type> bucket_queue_type;
+  if (use_bucket_queue)
+    return em_induce_minus_and_plus_suffixes<char_type, text_offset_type,
+      block_id_type, bucket_queue_type>(std::forward<args_type>(args)...);
+  else
+    return em_induce_minus_and_plus_suffixes<char_type, text_offset_type,
+      block_id_type, radix_heap_type>(std::forward<args_type>(args)...);
+}
+
+template<typename char_type,
+  typename text_offset_type,
+  typename block_id_type>
+std::uint64_t em_induce_minus_and_plus_suffixes(
+    std::uint64_t text_alphabet_size,
+    std::uint64_t text_length,
+    std::uint64_t initial_text_length,
+    std::uint64_t max_block_size,
+    std::uint64_t ram_use,
+    std::uint64_t minus_pos_n_parts,
+    std::vector<std::uint64_t> &next_block_leftmost_minus_star_plus_rank,
+    std::string text_filename,
+    std::string minus_pos_filename,
+    std::string minus_count_filename,
+    std::string output_filename,
+    std::vector<std::string> &init_minus_pos_filenames,
+    std::uint64_t &total_io_volume,
+    bool is_small_alphabet,
+    std::string bwt_filename = std::string(""),
+    std::uint64_t sa_sample_rate = 1,
+    bool write_sa = true,
+    std::string isa_filename = std::string(""),
+    bool pack_output = false,
+    std::string da_filename = std::string(""),
+    const std::vector<std::uint64_t> *doc_starts = NULL,
+    const std::uint64_t *sa_positions = NULL) {
+  std::uint64_t n_blocks = (text_length + max_block_size - 1) / max_block_size;
+
+  fprintf(stderr, "  EM induce minus and plus suffixes:\n");
+  phase_stats::begin_phase("EM induce minus and plus suffixes");
+  fprintf(stderr, "    sizeof(block_id_type) = %lu\n", sizeof(block_id_type));
+
+  // For small alphabets, replace the radix heap with a bucket
+  // queue (one EM queue per symbol) in both EM inducing sweeps.
+  bool use_bucket_queue = (text_alphabet_size <=
+      em_bucket_queue<char_type, block_id_type>::k_max_bucket_count);
+  fprintf(stderr, "    Priority queue = %s\n",
+      use_bucket_queue ? "bucket queue" : "radix heap");
+
+  char_type last_text_symbol;
+  std::uint64_t last_text_symbol_offset =
+    sizeof(char_type) * (text_length - 1);
+  utils::read_at_offset(&last_text_symbol,
+      last_text_symbol_offset, 1, text_filename);
+  total_io_volume += sizeof(char_type);
+
+  std::vector<std::string> plus_type_filenames(n_blocks);
+  std::vector<std::string> minus_type_filenames(n_blocks);
+  std::vector<std::string> plus_symbols_filenames(n_blocks);
+  std::vector<std::string> minus_symbols_filenames(n_blocks);
+  std::vector<std::string> plus_pos_filenames(n_blocks);
+  std::vector<std::string> minus_pos_filenames(n_blocks);
+  std::vector<std::uint64_t> block_count_target(n_blocks, std::numeric_limits<std::uint64_t>::max());
+  for (std::uint64_t block_id = 0; block_id < n_blocks; ++block_id) {
+    plus_pos_filenames[block_id] = output_filename + "tmp." + utils::random_string_hash();
+    plus_symbols_filenames[block_id] = output_filename + "tmp." + utils::random_string_hash();
+    plus_type_filenames[block_id] = output_filename + "tmp." + utils::random_string_hash();
+    minus_pos_filenames[block_id] = output_filename + "tmp." + utils::random_string_hash();
+    minus_type_filenames[block_id] = output_filename + "tmp." + utils::random_string_hash();
+    minus_symbols_filenames[block_id] = output_filename + "tmp." + utils::random_string_hash();
+  }
+
+  im_induce_suffixes<
+    char_type,
+    text_offset_type>(
+        text_alphabet_size,
+        text_length,
+        initial_text_length,
+        max_block_size,
+        next_block_leftmost_minus_star_plus_rank,
+        text_filename,
+        init_minus_pos_filenames,
+        plus_pos_filenames,
+        plus_symbols_filenames,
+        plus_type_filenames,
+        minus_pos_filenames,
+        minus_type_filenames,
+        minus_symbols_filenames,
+        block_count_target,
+        total_io_volume,
+        is_small_alphabet);
+
+  std::string plus_type_filename = output_filename + "tmp." + utils::random_string_hash();
+  std::string plus_count_filename = output_filename + "tmp." + utils::random_string_hash();
+  std::string plus_pos_filename = output_filename + "tmp." + utils::random_string_hash();
+
+  std::string plus_bwt_filename;
+  std::string minus_star_bwt_filename;
+  if (!bwt_filename.empty()) {
+    plus_bwt_filename = output_filename + "tmp." + utils::random_string_hash();
+    minus_star_bwt_filename = output_filename + "tmp." + utils::random_string_hash();
+  }
+
+  std::uint64_t n_parts = em_induce_plus_suffixes_with_queue<
+    char_type,
+    text_offset_type,
+    block_id_type>(
+        use_bucket_queue,
+        text_alphabet_size,
+        text_length,
+        initial_text_length,
+        max_block_size,
+        ram_use,
+        minus_pos_n_parts,
+        block_count_target,
+        plus_pos_filename,
+        plus_type_filename,
+        plus_count_filename,
+        minus_pos_filename,
+        minus_count_filename,
+        plus_type_filenames,
+        plus_pos_filenames,
+        plus_symbols_filenames,
+        total_io_volume,
+        plus_bwt_filename,
+        minus_star_bwt_filename);
+
+  utils::file_delete(minus_count_filename);
+  for (std::uint64_t i = 0; i < n_blocks; ++i)
+    if (utils::file_exists(plus_type_filenames[i])) utils::file_delete(plus_type_filenames[i]);
+
+  std::uint64_t bwt_primary_index = em_induce_minus_and_plus_suffixes_with_queue<
+    char_type,
+    text_offset_type,
+    block_id_type>(
+        use_bucket_queue,
+        text_alphabet_size,
+        text_length,
+        initial_text_length,
+        max_block_size,
+        ram_use,
+        n_parts,
+        last_text_symbol,
+        output_filename,
+        plus_pos_filename,
+        plus_type_filename,
+        plus_count_filename,
+        minus_type_filenames,
+        minus_pos_filenames,
+        minus_symbols_filenames,
+        total_io_volume,
+        bwt_filename,
+        plus_bwt_filename,
+        minus_star_bwt_filename,
+        sa_sample_rate,
+        write_sa,
+        isa_filename,
+        pack_output,
+        da_filename,
+        doc_starts,
+        sa_positions);
+
+  utils::file_delete(plus_type_filename);
+  utils::file_delete(plus_count_filename);
+  for (std::uint64_t j = 0; j < n_blocks; ++j)
+    if (utils::file_exists(minus_type_filenames[j])) utils::file_delete(minus_type_filenames[j]);
+  if (!bwt_filename.empty()) {
+    utils::file_delete(plus_bwt_filename);
+    utils::file_delete(minus_star_bwt_filename);
+  }
+  phase_stats::end_phase();
+
+  return bwt_primary_index;
+}
+
+template<typename char_type,
+  typename text_offset_type>
+std::uint64_t em_induce_minus_and_plus_suffixes(
+    std::uint64_t text_alphabet_size,
+    std::uint64_t text_length,
+    std::uint64_t initial_text_length,
+    std::uint64_t max_block_size,
+    std::uint64_t ram_use,
+    std::uint64_t minus_pos_n_parts,
+    std::vector<std::uint64_t> &next_block_leftmost_minus_star_plus_rank,
+    std::string text_filename,
+    std::string minus_pos_filename,
+    std::string minus_count_filename,
+    std::string output_filename,
+    std::vector<std::string> &init_minus_pos_filenames,
+    std::uint64_t &total_io_volume,
+    bool is_small_alphabet,
+    std::string bwt_filename = std::string(""),
+    std::uint64_t sa_sample_rate = 1,
+    bool write_sa = true,
+    std::string isa_filename = std::string(""),
+    bool pack_output = false,
+    std::string da_filename = std::string(""),
+    const std::vector<std::uint64_t> *doc_starts = NULL,
+    const std::uint64_t *sa_positions = NULL) {
+  std::uint64_t n_blocks = (text_length + max_block_size - 1) / max_block_size;
+  if (n_blocks < (1UL << 8)) {
+    return em_induce_minus_and_plus_suffixes<char_type, text_offset_type, std::uint8_t>(text_alphabet_size, text_length,
+        initial_text_length, max_block_size, ram_use, minus_pos_n_parts, next_block_leftmost_minus_star_plus_rank, text_filename, minus_pos_filename,
+        minus_count_filename, output_filename, init_minus_pos_filenames, total_io_volume, is_small_alphabet, bwt_filename,
+        sa_sample_rate, write_sa, isa_filename, pack_output,
+        da_filename, doc_starts, sa_positions);
+  } else if (n_blocks < (1UL << 16)) {
+    return em_induce_minus_and_plus_suffixes<char_type, text_offset_type, std::uint16_t>(text_alphabet_size, text_length,
+        initial_text_length, max_block_size, ram_use, minus_pos_n_parts, next_block_leftmost_minus_star_plus_rank, text_filename, minus_pos_filename,
+        minus_count_filename, output_filename, init_minus_pos_filenames, total_io_volume, is_small_alphabet, bwt_filename,
+        sa_sample_rate, write_sa, isa_filename, pack_output,
+        da_filename, doc_starts, sa_positions);
+  } else if (n_blocks < (1UL << 24)) {
+    return em_induce_minus_and_plus_suffixes<char_type, text_offset_type, uint24>(text_alphabet_size, text_length,
+        initial_text_length, max_block_size, ram_use, minus_pos_n_parts, next_block_leftmost_minus_star_plus_rank, text_filename, minus_pos_filename,
+        minus_count_filename, output_filename, init_minus_pos_filenames, total_io_volume, is_small_alphabet, bwt_filename,
+        sa_sample_rate, write_sa, isa_filename, pack_output,
+        da_filename, doc_starts, sa_positions);
+  } else {
+    return em_induce_minus_and_plus_suffixes<char_type, text_offset_type, std::uint64_t>(text_alphabet_size, text_length,
+        initial_text_length, max_block_size, ram_use, minus_pos_n_parts, next_block_leftmost_minus_star_plus_rank, text_filename, minus_pos_filename,
+        minus_count_filename, output_filename, init_minus_pos_filenames, total_io_volume, is_small_alphabet, bwt_filename,
+        sa_sample_rate, write_sa, isa_filename, pack_output,
+        da_filename, doc_starts, sa_positions);
+  }
+}
+
 template<typename char_type,
   typename text_offset_type,
   typename block_id_type>
@@ -722,8 +886,16 @@ void em_induce_minus_and_plus_suffixes(
   std::uint64_t n_blocks = (text_length + max_block_size - 1) / max_block_size;
 
   fprintf(stderr, "  EM induce minus and plus suffixes:\n");
+  phase_stats::begin_phase("EM induce minus and plus suffixes");
   fprintf(stderr, "    sizeof(block_id_type) = %lu\n", sizeof(block_id_type));
 
+  // For small alphabets, replace the radix heap with a bucket
+  // queue (one EM queue per symbol) in both EM inducing sweeps.
+  bool use_bucket_queue = (text_alphabet_size <=
+      em_bucket_queue<char_type, block_id_type>::k_max_bucket_count);
+  fprintf(stderr, "    Priority queue = %s\n",
+      use_bucket_queue ? "bucket queue" : "radix heap");
+
   char_type last_text_symbol;
   std::uint64_t last_text_symbol_offset =
     sizeof(char_type) * (text_length - 1);
@@ -773,10 +945,11 @@ void em_induce_minus_and_plus_suffixes(
   std::string plus_count_filename = tempfile_basename + "tmp." + utils::random_string_hash();
   std::string plus_pos_filename = tempfile_basename + "tmp." + utils::random_string_hash();
 
-  std::uint64_t n_parts = em_induce_plus_suffixes<
+  std::uint64_t n_parts = em_induce_plus_suffixes_with_queue<
     char_type,
     text_offset_type,
     block_id_type>(
+        use_bucket_queue,
         text_alphabet_size,
         text_length,
         initial_text_length,
@@ -799,10 +972,11 @@ void em_induce_minus_and_plus_suffixes(
     if (utils::file_exists(plus_type_filenames[i]))
       utils::file_delete(plus_type_filenames[i]);
 
-  em_induce_minus_and_plus_suffixes<
+  em_induce_minus_and_plus_suffixes_with_queue<
     char_type,
     text_offset_type,
     block_id_type>(
+        use_bucket_queue,
         text_alphabet_size,
         text_length,
         initial_text_length,
@@ -827,6 +1001,7 @@ void em_induce_minus_and_plus_suffixes(
   for (std::uint64_t j = 0; j < n_blocks; ++j)
     if (utils::file_exists(minus_type_filenames[j]))
       utils::file_delete(minus_type_filenames[j]);
+  phase_stats::end_phase();
 }
 
 template<typename char_type,
@@ -52,7 +52,10 @@
 #include "im_induce_substrings.hpp"
 #include "em_induce_plus_star_substrings.hpp"
 #include "em_radix_heap.hpp"
+#include "hardware_profile.hpp"
 #include "utils.hpp"
+#include "phase_stats.hpp"
+#include "progress_reporter.hpp"
 #include "packed_pair.hpp"
 #include "../uint24.hpp"
 #include "../uint40.hpp"
@@ -71,6 +74,7 @@ em_induce_minus_star_substrings_large_alphabet(
     std::uint64_t text_length,
     std::uint64_t initial_text_length,
     std::uint64_t max_block_size,
+    std::uint64_t text_alphabet_size,
     std::uint64_t ram_use,
     std::uint64_t max_permute_block_size,
     std::uint64_t n_parts,
@@ -125,7 +129,7 @@ em_induce_minus_star_substrings_large_alphabet(
   }
 
   // Decide on the RAM budget allocation.
-  std::uint64_t opt_buf_size = (1UL << 20);
+  std::uint64_t opt_buf_size = hardware_profile::opt_request_size();
   std::uint64_t computed_buf_size = 0;
   std::uint64_t n_buffers = 3UL * n_blocks + n_permute_blocks + 20;
   std::uint64_t ram_for_radix_heap = 0;
@@ -139,9 +143,14 @@ em_induce_minus_star_substrings_large_alphabet(
     ram_for_buffers = ram_use - ram_for_radix_heap;
     computed_buf_size = std::max(1UL, ram_for_buffers / n_buffers);
   }
+  std::vector<std::uint64_t> radix_logs =
+    utils::radix_logs_for_keys(text_alphabet_size, 10UL);
+  hardware_profile::tune_ram_split(n_buffers, radix_logs,
+      computed_buf_size, ram_for_buffers, ram_for_radix_heap);
 
   // Start the timer.
   long double start = utils::wclock();
+  phase_stats::begin_phase("EM induce minus substrings (large alphabet)");
   fprintf(stderr, "    EM induce minus substrings (large alphabet):\n");
   fprintf(stderr, "      sizeof(ext_block_id_type) = %lu\n", sizeof(ext_block_id_type));
   fprintf(stderr, "      Single buffer size = %lu (%.1LfMiB)\n", computed_buf_size, (1.L * computed_buf_size) / (1L << 20));
@@ -149,19 +158,10 @@ em_induce_minus_star_substrings_large_alphabet(
   fprintf(stderr, "      Radix heap RAM budget = %lu (%.1LfMiB)\n", ram_for_radix_heap, (1.L * ram_for_radix_heap) / (1L << 20));
 
   // Initialize radix heap.
-  std::vector<std::uint64_t> radix_logs;
-  {
-    std::uint64_t target_sum = 8UL * sizeof(char_type);
-    std::uint64_t cur_sum = 0;
-    while (cur_sum < target_sum) {
-      std::uint64_t radix_log = std::min(10UL, target_sum - cur_sum);
-      radix_logs.push_back(radix_log);
-      cur_sum += radix_log;
-    }
-  }
   typedef packed_pair<ext_block_id_type, text_offset_type> ext_pair_type;
   typedef em_radix_heap<char_type, ext_pair_type> radix_heap_type;
   radix_heap_type *radix_heap = new radix_heap_type(radix_logs, tempfile_basename, ram_for_radix_heap);
+  radix_heap->set_phase_name("EM induce minus substrings (large alphabet)");
 
   // Initialize the readers of data associated with plus suffixes.
   typedef async_backward_stream_reader_multipart<block_id_type> plus_pos_reader_type;
@@ -211,6 +211,7 @@ em_induce_minus_star_substrings_large_alphabet(
   std::uint64_t cur_plus_name = 0;
   std::uint64_t cur_bucket_size = 0;
   std::vector<std::uint64_t> block_count(n_blocks, 0UL);
+  progress_counter progress(text_length);
 
   while (cur_symbol <= (std::uint64_t)last_text_symbol || !plus_count_reader->empty() || !radix_heap->empty()) {
 
@@ -230,6 +231,7 @@ em_induce_minus_star_substrings_large_alphabet(
       was_extract_min = true;
 
       ++block_count[block_id];
+      progress.increment();
       bool head_pos_at_block_beg = (block_count[block_id] == block_count_target[block_id]);
 
       // Watch for the order of minus-substrings with the same name!!!
@@ -297,6 +299,7 @@ em_induce_minus_star_substrings_large_alphabet(
       was_extract_min = true;
 
       ++block_count[block_id];
+      progress.increment();
       bool head_pos_at_block_beg = (block_count[block_id] == block_count_target[block_id]);
 
       // Watch for the order of minus-substrings with the same name!!!
@@ -354,6 +357,7 @@ em_induce_minus_star_substrings_large_alphabet(
       // Compute pos_block_id and prev_pos_block_id.
       std::uint64_t pos_block_id = plus_pos_reader->read();
       ++block_count[pos_block_id];
+      progress.increment();
       bool head_pos_at_block_beg = (block_count[pos_block_id] == block_count_target[pos_block_id]);
       std::uint64_t prev_pos_block_id = pos_block_id - head_pos_at_block_beg;
 
@@ -405,6 +409,7 @@ em_induce_minus_star_substrings_large_alphabet(
   delete radix_heap;
 
   long double total_time = utils::wclock() - start;
+  phase_stats::end_phase();
   fprintf(stderr, "      Time = %.2Lfs, I/O = %.2LfMiB/s, "
       "total I/O vol = %.1Lf bytes/symbol (of initial text)\n",
       total_time, (1.L * io_volume / (1L << 20)) / total_time,
@@ -422,6 +427,7 @@ em_induce_minus_star_substrings_large_alphabet(
     std::uint64_t text_length,
     std::uint64_t initial_text_length,
     std::uint64_t max_block_size,
+    std::uint64_t text_alphabet_size,
     std::uint64_t ram_use,
     std::uint64_t max_permute_block_size,
     std::uint64_t n_parts,
@@ -440,17 +446,17 @@ em_induce_minus_star_substrings_large_alphabet(
   std::uint64_t n_blocks = (text_length + max_block_size - 1) / max_block_size;
   if (n_blocks < (1UL << 7))
     return em_induce_minus_star_substrings_large_alphabet<char_type, text_offset_type, block_offset_type, block_id_type, std::uint8_t>
-      (text_length, initial_text_length, max_block_size, ram_use, max_permute_block_size, n_parts, last_text_symbol, block_count_target, plus_pos_filename,
+      (text_length, initial_text_length, max_block_size, text_alphabet_size, ram_use, max_permute_block_size, n_parts, last_text_symbol, block_count_target, plus_pos_filename,
        plus_count_filename, plus_diff_filename, minus_type_filenames, minus_pos_filenames, symbols_filenames, tempfile_basename,
        output_count_filename, output_pos_filenames, total_io_volume);
   else if (n_blocks < (1UL << 15))
     return em_induce_minus_star_substrings_large_alphabet<char_type, text_offset_type, block_offset_type, block_id_type, std::uint16_t>
-      (text_length, initial_text_length, max_block_size, ram_use, max_permute_block_size, n_parts, last_text_symbol, block_count_target, plus_pos_filename,
+      (text_length, initial_text_length, max_block_size, text_alphabet_size, ram_use, max_permute_block_size, n_parts, last_text_symbol, block_count_target, plus_pos_filename,
        plus_count_filename, plus_diff_filename, minus_type_filenames, minus_pos_filenames, symbols_filenames, tempfile_basename,
        output_count_filename, output_pos_filenames, total_io_volume);
   else
     return em_induce_minus_star_substrings_large_alphabet<char_type, text_offset_type, block_offset_type, block_id_type, std::uint64_t>
-      (text_length, initial_text_length, max_block_size, ram_use, max_permute_block_size, n_parts, last_text_symbol, block_count_target, plus_pos_filename,
+      (text_length, initial_text_length, max_block_size, text_alphabet_size, ram_use, max_permute_block_size, n_parts, last_text_symbol, block_count_target, plus_pos_filename,
        plus_count_filename, plus_diff_filename, minus_type_filenames, minus_pos_filenames, symbols_filenames, tempfile_basename,
        output_count_filename, output_pos_filenames, total_io_volume);
 }
@@ -532,7 +538,7 @@ em_induce_minus_star_substrings_small_alphabet(
   // Decide on the RAM budget allocation.
   std::uint64_t ram_for_timestamps = text_alphabet_size * sizeof(text_offset_type);
   std::uint64_t ram_for_buffers_and_radix_heap = std::max((std::int64_t)1, (std::int64_t)ram_use - (std::int64_t)ram_for_timestamps);
-  std::uint64_t opt_buf_size = (1UL << 20);
+  std::uint64_t opt_buf_size = hardware_profile::opt_request_size();
   std::uint64_t computed_buf_size = 0;
   std::uint64_t n_buffers = 3UL * n_blocks + n_permute_blocks + 20;
   std::uint64_t ram_for_radix_heap = 0;
@@ -546,9 +552,14 @@ em_induce_minus_star_substrings_small_alphabet(
     ram_for_buffers = std::max((std::int64_t)1, (std::int64_t)ram_for_buffers_and_radix_heap - (std::int64_t)ram_for_radix_heap);
     computed_buf_size = std::max(1UL, ram_for_buffers / n_buffers);
   }
+  std::vector<std::uint64_t> radix_logs =
+    utils::radix_logs_for_keys(text_alphabet_size, 10UL);
+  hardware_profile::tune_ram_split(n_buffers, radix_logs,
+      computed_buf_size, ram_for_buffers, ram_for_radix_heap);
 
   // Start the timer.
   long double start = utils::wclock();
+  phase_stats::begin_phase("EM induce minus substrings (small alphabet)");
   fprintf(stderr, "    EM induce minus substrings (small alphabet):\n");
   fprintf(stderr, "      sizeof(ext_block_id_type) = %lu\n", sizeof(ext_block_id_type));
   fprintf(stderr, "      Single buffer size = %lu (%.1LfMiB)\n", computed_buf_size, (1.L * computed_buf_size) / (1L << 20));
@@ -557,18 +568,9 @@ em_induce_minus_star_substrings_small_alphabet(
   fprintf(stderr, "      Timestamps RAM budget = %lu (%.1LfMiB)\n", ram_for_timestamps, (1.L * ram_for_timestamps) / (1L << 20));
 
   // Initialize radix heap.
-  std::vector<std::uint64_t> radix_logs;
-  {
-    std::uint64_t target_sum = 8UL * sizeof(char_type);
-    std::uint64_t cur_sum = 0;
-    while (cur_sum < target_sum) {
-      std::uint64_t radix_log = std::min(10UL, target_sum - cur_sum);
-      radix_logs.push_back(radix_log);
-      cur_sum += radix_log;
-    }
-  }
   typedef em_radix_heap<char_type, ext_block_id_type> radix_heap_type;
   radix_heap_type *radix_heap = new radix_heap_type(radix_logs, tempfile_basename, ram_for_radix_heap);
+  radix_heap->set_phase_name("EM induce minus substrings (small alphabet)");
 
   // Initialize the readers of data associated with plus suffixes.
   typedef async_backward_stream_reader_multipart<block_id_type> plus_pos_reader_type;
@@ -615,6 +617,7 @@ em_induce_minus_star_substrings_small_alphabet(
   std::uint64_t cur_substring_name = 0;
   std::uint64_t cur_bucket_size = 0;
   std::vector<std::uint64_t> block_count(n_blocks, 0UL);
+  progress_counter progress(text_length);
   text_offset_type *symbol_timestamps = utils::allocate_array<text_offset_type>(text_alphabet_size);
   std::fill(symbol_timestamps, symbol_timestamps + text_alphabet_size, (text_offset_type)0);
   while (cur_symbol <= (std::uint64_t)last_text_symbol || !plus_count_reader->empty() || !radix_heap->empty()) {
@@ -630,6 +633,7 @@ em_induce_minus_star_substrings_small_alphabet(
         ++current_timestamp;
         was_extract_min = true;
         ++block_count[block_id];
+        progress.increment();
         bool head_pos_at_block_beg = (block_count[block_id] == block_count_target[block_id]);
 
         // Watch for the order of minus-substrings with the same name!!!
@@ -695,6 +699,7 @@ em_induce_minus_star_substrings_small_alphabet(
           ++current_timestamp;
         was_extract_min = true;
         ++block_count[block_id];
+        progress.increment();
         bool head_pos_at_block_beg = (block_count[block_id] == block_count_target[block_id]);
 
         // Watch for the order of minus-substrings with the same name!!!
@@ -754,6 +759,7 @@ em_induce_minus_star_substrings_small_alphabet(
       // Compute pos_block_id and prev_pos_block_id.
       std::uint64_t pos_block_id = plus_pos_reader->read();
       ++block_count[pos_block_id];
+      progress.increment();
       bool head_pos_at_block_beg = (block_count[pos_block_id] == block_count_target[pos_block_id]);
       std::uint64_t prev_pos_block_id = pos_block_id - head_pos_at_block_beg;
       std::uint64_t heap_value = prev_pos_block_id;
@@ -814,6 +820,7 @@ em_induce_minus_star_substrings_small_alphabet(
   delete radix_heap;
 
   long double total_time = utils::wclock() - start;
+  phase_stats::end_phase();
   fprintf(stderr, "      Time = %.2Lfs, I/O = %.2LfMiB/s, "
       "total I/O vol = %.1Lf bytes/symbol (of initial text)\n",
       total_time, (1.L * io_volume / (1L << 20)) / total_time,
@@ -898,7 +905,7 @@ em_induce_minus_star_substrings(
         tempfile_basename, output_count_filename, output_pos_filenames, total_io_volume);
   else
     return em_induce_minus_star_substrings_large_alphabet<char_type, text_offset_type, block_offset_type, block_id_type>(
-        text_length, initial_text_length, max_block_size, ram_use, max_permute_block_size, n_parts, last_text_symbol, block_count_target, plus_pos_filename,
+        text_length, initial_text_length, max_block_size, text_alphabet_size, ram_use, max_permute_block_size, n_parts, last_text_symbol, block_count_target, plus_pos_filename,
         plus_count_filename, plus_diff_filename, minus_type_filenames, minus_pos_filenames, symbols_filenames, tempfile_basename,
         output_count_filename, output_pos_filenames, total_io_volume);
 }
@@ -924,6 +931,7 @@ em_induce_minus_star_substrings(
   std::uint64_t n_blocks = (text_length + max_block_size - 1) / max_block_size;
 
   fprintf(stderr, "  EM induce substrings:\n");
+  phase_stats::begin_phase("EM induce substrings");
   fprintf(stderr, "    sizeof(block_offset_type) = %lu\n", sizeof(block_offset_type));
   fprintf(stderr, "    sizeof(block_id_type) = %lu\n", sizeof(block_id_type));
   fprintf(stderr, "    Max block size = %lu\n", max_block_size);
@@ -1030,6 +1038,7 @@ em_induce_minus_star_substrings(
   for (std::uint64_t j = 0; j < n_blocks; ++j)
     if (utils::file_exists(minus_type_filenames[j])) utils::file_delete(minus_type_filenames[j]);
 
+  phase_stats::end_phase();
   return n_names;
 }
 
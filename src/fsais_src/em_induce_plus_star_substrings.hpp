@@ -50,8 +50,11 @@
 #include "io/async_multi_bit_stream_reader.hpp"
 
 #include "em_radix_heap.hpp"
+#include "hardware_profile.hpp"
 #include "packed_pair.hpp"
 #include "utils.hpp"
+#include "phase_stats.hpp"
+#include "progress_reporter.hpp"
 
 
 namespace fsais_private {
@@ -64,6 +67,7 @@ std::uint64_t em_induce_plus_star_substrings_large_alphabet(
     std::uint64_t text_length,
     std::uint64_t initial_text_length,
     std::uint64_t max_block_size,
+    std::uint64_t text_alphabet_size,
     std::uint64_t ram_use,
     std::vector<std::uint64_t> &block_count_target,
     std::string text_filename,
@@ -108,7 +112,7 @@ std::uint64_t em_induce_plus_star_substrings_large_alphabet(
   }
 
   // Decide on the RAM budget allocation.
-  std::uint64_t opt_buf_size = (1UL << 20);
+  std::uint64_t opt_buf_size = hardware_profile::opt_request_size();
   std::uint64_t computed_buf_size = 0;
   std::uint64_t n_buffers = 2 * n_blocks + 12;
   std::uint64_t ram_for_radix_heap = 0;
@@ -122,6 +126,10 @@ std::uint64_t em_induce_plus_star_substrings_large_alphabet(
     ram_for_buffers = ram_use - ram_for_radix_heap;
     computed_buf_size = std::max(1UL, ram_for_buffers / n_buffers);
   }
+  std::vector<std::uint64_t> radix_logs =
+    utils::radix_logs_for_keys(text_alphabet_size, 10UL);
+  hardware_profile::tune_ram_split(n_buffers, radix_logs,
+      computed_buf_size, ram_for_buffers, ram_for_radix_heap);
 
 #ifdef SAIS_DEBUG
   std::uint64_t max_part_size = utils::random_int64(1L, 50L);
@@ -131,6 +139,7 @@ std::uint64_t em_induce_plus_star_substrings_large_alphabet(
 
   // Start the timer.
   long double start = utils::wclock();
+  phase_stats::begin_phase("EM induce plus substrings (large alphabet)");
   fprintf(stderr, "    EM induce plus substrings (large alphabet):\n");
   fprintf(stderr, "      sizeof(extext_block_id_type) = %lu\n", sizeof(extext_block_id_type));
   fprintf(stderr, "      Single buffer size = %lu (%.1LfMiB)\n", computed_buf_size, (1.L * computed_buf_size) / (1L << 20));
@@ -139,19 +148,11 @@ std::uint64_t em_induce_plus_star_substrings_large_alphabet(
   fprintf(stderr, "      Max part size = %lu (%.1LfMiB)\n", max_part_size, (1.L * max_part_size) / (1UL << 20));
 
   // Initialize radix heap.
-  std::vector<std::uint64_t> radix_logs;
-  {
-    std::uint64_t target_sum = 8UL * sizeof(char_type);
-    std::uint64_t cur_sum = 0;
-    while (cur_sum < target_sum) {
-      std::uint64_t radix_log = std::min(10UL, target_sum - cur_sum);
-      radix_logs.push_back(radix_log);
-      cur_sum += radix_log;
-    }
-  }
+  std::uint64_t max_char = text_alphabet_size - 1;
   typedef packed_pair<extext_block_id_type, text_offset_type> ext_pair_type;
   typedef em_radix_heap<char_type, ext_pair_type> heap_type;
   heap_type *radix_heap = new heap_type(radix_logs, output_pos_filename, ram_for_radix_heap);
+  radix_heap->set_phase_name("EM induce plus substrings (large alphabet)");
 
   // Sort start positions of all minus star substrings by
   // the first symbol by adding them to the heap.
@@ -172,7 +173,7 @@ std::uint64_t em_induce_plus_star_substrings_large_alphabet(
         ((std::uint64_t)cur_char == (std::uint64_t)next_char && is_next_minus);
 
       if (iplus < text_length && !is_minus && is_next_minus)
-        radix_heap->push(std::numeric_limits<char_type>::max() - next_char, ext_pair_type(next_pos_block_id, 0));
+        radix_heap->push(max_char - next_char, ext_pair_type(next_pos_block_id, 0));
 
       is_next_minus = is_minus;
       next_char = cur_char;
@@ -224,9 +225,10 @@ std::uint64_t em_induce_plus_star_substrings_large_alphabet(
   char_type prev_written_head_char = 0;
 
   std::vector<std::uint64_t> block_count(n_blocks, 0UL);
+  progress_counter progress(text_length);
   while (!radix_heap->empty()) {
     std::pair<char_type, ext_pair_type> p = radix_heap->extract_min();
-    char_type head_char = std::numeric_limits<char_type>::max() - p.first;
+    char_type head_char = max_char - p.first;
     std::uint64_t block_id = p.second.first;
     std::uint64_t tail_name = p.second.second;
 
@@ -244,6 +246,7 @@ std::uint64_t em_induce_plus_star_substrings_large_alphabet(
 
     // Update block count.
     ++block_count[block_id];
+    progress.increment();
     bool head_pos_at_block_beg = (block_count[block_id] ==
         block_count_target[block_id]);
 
@@ -295,13 +298,13 @@ std::uint64_t em_induce_plus_star_substrings_large_alphabet(
         char_type prev_char = symbols_reader->read_from_ith_file(block_id);
         std::uint64_t prev_pos_block_idx = block_id - head_pos_at_block_beg;
         std::uint64_t new_block_id = (prev_pos_block_idx | is_head_plus_bit | is_tail_plus_bit);
-        radix_heap->push(std::numeric_limits<char_type>::max() - (prev_char + 1), ext_pair_type(new_block_id, diff_items - 1));
+        radix_heap->push(max_char - (prev_char + 1), ext_pair_type(new_block_id, diff_items - 1));
       }
     } else {
       char_type prev_char = symbols_reader->read_from_ith_file(block_id);
       std::uint64_t prev_pos_block_idx = block_id - head_pos_at_block_beg;
       std::uint64_t new_block_id = (prev_pos_block_idx | is_head_plus_bit);
-      radix_heap->push(std::numeric_limits<char_type>::max() - (prev_char + 1), ext_pair_type(new_block_id, (std::uint64_t)head_char));
+      radix_heap->push(max_char - (prev_char + 1), ext_pair_type(new_block_id, (std::uint64_t)head_char));
     }
 
     is_prev_head_plus = is_head_plus;
@@ -346,6 +349,7 @@ std::uint64_t em_induce_plus_star_substrings_large_alphabet(
 
   // Print summary.
   long double total_time = utils::wclock() - start;
+  phase_stats::end_phase();
   fprintf(stderr, "      Time = %.2Lfs, I/O = %.2LfMiB/s, "
       "total I/O vol = %.1Lf bytes/symbol (of initial text)\n",
       total_time, (1.L * io_volume / (1L << 20)) / total_time,
@@ -362,6 +366,7 @@ std::uint64_t em_induce_plus_star_substrings_large_alphabet(
     std::uint64_t text_length,
     std::uint64_t initial_text_length,
     std::uint64_t max_block_size,
+    std::uint64_t text_alphabet_size,
     std::uint64_t ram_use,
     std::vector<std::uint64_t> &block_count_target,
     std::string text_filename,
@@ -374,15 +379,15 @@ std::uint64_t em_induce_plus_star_substrings_large_alphabet(
   std::uint64_t n_blocks = (text_length + max_block_size - 1) / max_block_size;
   if (n_blocks < (1UL << 6))
     return em_induce_plus_star_substrings_large_alphabet<char_type, text_offset_type, block_id_type, std::uint8_t>(text_length,
-        initial_text_length, max_block_size, ram_use, block_count_target, text_filename, output_pos_filename,
+        initial_text_length, max_block_size, text_alphabet_size, ram_use, block_count_target, text_filename, output_pos_filename,
         output_diff_filename, output_count_filename, plus_type_filenames, symbols_filenames, total_io_volume);
   else if (n_blocks < (1UL << 14))
     return em_induce_plus_star_substrings_large_alphabet<char_type, text_offset_type, block_id_type, std::uint16_t>(text_length,
-        initial_text_length, max_block_size, ram_use, block_count_target, text_filename, output_pos_filename,
+        initial_text_length, max_block_size, text_alphabet_size, ram_use, block_count_target, text_filename, output_pos_filename,
         output_diff_filename, output_count_filename, plus_type_filenames, symbols_filenames, total_io_volume);
   else
     return em_induce_plus_star_substrings_large_alphabet<char_type, text_offset_type, block_id_type, std::uint64_t>(text_length,
-        initial_text_length, max_block_size, ram_use, block_count_target, text_filename, output_pos_filename,
+        initial_text_length, max_block_size, text_alphabet_size, ram_use, block_count_target, text_filename, output_pos_filename,
         output_diff_filename, output_count_filename, plus_type_filenames, symbols_filenames, total_io_volume);
 }
 
@@ -450,7 +455,7 @@ std::uint64_t em_induce_plus_star_substrings_small_alphabet(
   // Decide on the RAM budget allocation.
   std::uint64_t ram_for_timestamps = text_alphabet_size * sizeof(text_offset_type);
   std::uint64_t ram_for_buffers_and_radix_heap = std::max((std::int64_t)1, (std::int64_t)ram_use - (std::int64_t)ram_for_timestamps);
-  std::uint64_t opt_buf_size = (1UL << 20);
+  std::uint64_t opt_buf_size = hardware_profile::opt_request_size();
   std::uint64_t computed_buf_size = 0;
   std::uint64_t n_buffers = 2 * n_blocks + 12;
   std::uint64_t ram_for_radix_heap = 0;
@@ -464,6 +469,10 @@ std::uint64_t em_induce_plus_star_substrings_small_alphabet(
     ram_for_buffers = std::max((std::int64_t)1, (std::int64_t)ram_for_buffers_and_radix_heap - (std::int64_t)ram_for_radix_heap);
     computed_buf_size = std::max(1UL, ram_for_buffers / n_buffers);
   }
+  std::vector<std::uint64_t> radix_logs =
+    utils::radix_logs_for_keys(text_alphabet_size, 10UL);
+  hardware_profile::tune_ram_split(n_buffers, radix_logs,
+      computed_buf_size, ram_for_buffers, ram_for_radix_heap);
 
 #ifdef SAIS_DEBUG
   std::uint64_t max_part_size = utils::random_int64(1L, 50L);
@@ -473,6 +482,7 @@ std::uint64_t em_induce_plus_star_substrings_small_alphabet(
 
   // Start the timer.
   long double start = utils::wclock();
+  phase_stats::begin_phase("EM induce plus substrings (small alphabet)");
   fprintf(stderr, "    EM induce plus substrings (small alphabet):\n");
   fprintf(stderr, "      sizeof(extext_block_id_type) = %lu\n", sizeof(extext_block_id_type));
   fprintf(stderr, "      Single buffer size = %lu (%.1LfMiB)\n", computed_buf_size, (1.L * computed_buf_size) / (1L << 20));
@@ -482,18 +492,10 @@ std::uint64_t em_induce_plus_star_substrings_small_alphabet(
   fprintf(stderr, "      Max part size = %lu (%.1LfMiB)\n", max_part_size, (1.L * max_part_size) / (1UL << 20));
 
   // Initialize radix heap.
-  std::vector<std::uint64_t> radix_logs;
-  {
-    std::uint64_t target_sum = 8UL * sizeof(char_type);
-    std::uint64_t cur_sum = 0;
-    while (cur_sum < target_sum) {
-      std::uint64_t radix_log = std::min(10UL, target_sum - cur_sum);
-      radix_logs.push_back(radix_log);
-      cur_sum += radix_log;
-    }
-  }
+  std::uint64_t max_char = text_alphabet_size - 1;
   typedef em_radix_heap<char_type, extext_block_id_type> heap_type;
   heap_type *radix_heap = new heap_type(radix_logs, output_pos_filename, ram_for_radix_heap);
+  radix_heap->set_phase_name("EM induce plus substrings (small alphabet)");
 
   // Sort start positions of all minus star substrings by
   // the first symbol by adding them to the heap.
@@ -514,7 +516,7 @@ std::uint64_t em_induce_plus_star_substrings_small_alphabet(
         ((std::uint64_t)cur_char == (std::uint64_t)next_char && is_next_minus);
 
       if (iplus < text_length && !is_minus && is_next_minus)
-        radix_heap->push(std::numeric_limits<char_type>::max() - next_char, next_pos_block_id);
+        radix_heap->push(max_char - next_char, next_pos_block_id);
 
       is_next_minus = is_minus;
       next_char = cur_char;
@@ -564,9 +566,9 @@ std::uint64_t em_induce_plus_star_substrings_small_alphabet(
   std::uint64_t cur_substring_name = 0;
   std::uint64_t cur_bucket_size = 0;
   std::vector<std::uint64_t> block_count(n_blocks, 0UL);
+  progress_counter progress(text_length);
   text_offset_type *symbol_timestamps = utils::allocate_array<text_offset_type>(text_alphabet_size);
   std::fill(symbol_timestamps, symbol_timestamps + text_alphabet_size, (text_offset_type)0);
-  std::uint64_t max_char = (std::uint64_t)std::numeric_limits<char_type>::max();
 
   while (!radix_heap->empty()) {
     std::pair<char_type, extext_block_id_type> p = radix_heap->extract_min();
@@ -602,6 +604,7 @@ std::uint64_t em_induce_plus_star_substrings_small_alphabet(
 
     // Update block count.
     ++block_count[block_id];
+    progress.increment();
     bool head_pos_at_block_beg = (block_count[block_id] == block_count_target[block_id]);
 
     if (is_head_plus) {
@@ -696,6 +699,7 @@ std::uint64_t em_induce_plus_star_substrings_small_alphabet(
   delete radix_heap;
 
   long double total_time = utils::wclock() - start;
+  phase_stats::end_phase();
   fprintf(stderr, "      Time = %.2Lfs, I/O = %.2LfMiB/s, "
       "total I/O vol = %.1Lf bytes/symbol (of initial text)\n",
       total_time, (1.L * io_volume / (1L << 20)) / total_time,
@@ -763,7 +767,7 @@ std::uint64_t em_induce_plus_star_substrings(
         total_io_volume);
   else
     return em_induce_plus_star_substrings_large_alphabet<char_type, text_offset_type, block_id_type>(text_length, 
-        initial_text_length, max_block_size, ram_use, block_count_target, text_filename, output_pos_filename,
+        initial_text_length, max_block_size, text_alphabet_size, ram_use, block_count_target, text_filename, output_pos_filename,
         output_diff_filename, output_count_filename, plus_type_filenames, symbols_filenames, total_io_volume);
 
 #else
@@ -774,7 +778,7 @@ std::uint64_t em_induce_plus_star_substrings(
         total_io_volume);
   else
     return em_induce_plus_star_substrings_large_alphabet<char_type, text_offset_type, block_id_type>(text_length,
-        initial_text_length, max_block_size, ram_use, block_count_target, text_filename, output_pos_filename,
+        initial_text_length, max_block_size, text_alphabet_size, ram_use, block_count_target, text_filename, output_pos_filename,
         output_diff_filename, output_count_filename, plus_type_filenames, symbols_filenames, total_io_volume);
 #endif
 }
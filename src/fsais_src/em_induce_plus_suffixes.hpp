@@ -40,6 +40,7 @@
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <utility>
 
 #include "io/async_stream_writer.hpp"
 #include "io/async_stream_writer_multipart.hpp"
@@ -50,14 +51,19 @@
 #include "io/async_bit_stream_writer.hpp"
 
 #include "utils.hpp"
+#include "phase_stats.hpp"
+#include "progress_reporter.hpp"
 #include "em_radix_heap.hpp"
+#include "hardware_profile.hpp"
+#include "em_bucket_queue.hpp"
 
 
 namespace fsais_private {
 
 template<typename char_type,
   typename text_offset_type,
-  typename block_id_type>
+  typename block_id_type,
+  typename radix_heap_type>
 std::uint64_t em_induce_plus_suffixes(
     std::uint64_t text_alphabet_size,
     std::uint64_t text_length,
@@ -74,8 +80,11 @@ std::uint64_t em_induce_plus_suffixes(
     std::vector<std::string> &plus_type_filenames,
     std::vector<std::string> &plus_pos_filenames,
     std::vector<std::string> &symbols_filenames,
-    std::uint64_t &total_io_volume) {
+    std::uint64_t &total_io_volume,
+    std::string output_plus_bwt_filename = std::string(""),
+    std::string output_minus_star_bwt_filename = std::string("")) {
   std::uint64_t n_blocks = (text_length + max_block_size - 1) / max_block_size;
+  bool compute_bwt = !output_plus_bwt_filename.empty();
 
   if (text_length == 0) {
     fprintf(stderr, "\nError: text_length = 0\n");
@@ -112,9 +121,11 @@ std::uint64_t em_induce_plus_suffixes(
   }
 
   // Decide on the RAM budget allocation.
-  std::uint64_t opt_buf_size = (1UL << 20);
+  std::uint64_t opt_buf_size = hardware_profile::opt_request_size();
   std::uint64_t computed_buf_size = 0;
-  std::uint64_t n_buffers = 3 * n_blocks + 20;
+  // With BWT: output_plus_bwt_writer and output_minus_star_bwt_writer
+  // (each using 4 buffers).
+  std::uint64_t n_buffers = 3 * n_blocks + 20 + (compute_bwt ? 8 : 0);
   std::uint64_t ram_for_radix_heap = 0;
   std::uint64_t ram_for_buffers = 0;
   if (opt_buf_size * n_buffers <= ram_use / 2) {
@@ -126,9 +137,14 @@ std::uint64_t em_induce_plus_suffixes(
     ram_for_buffers = ram_use - ram_for_radix_heap;
     computed_buf_size = std::max(1UL, ram_for_buffers / n_buffers);
   }
+  std::vector<std::uint64_t> radix_logs =
+    utils::radix_logs_for_keys(text_alphabet_size, 10UL);
+  hardware_profile::tune_ram_split(n_buffers, radix_logs,
+      computed_buf_size, ram_for_buffers, ram_for_radix_heap);
 
   // Start the timer.
   long double start = utils::wclock();
+  phase_stats::begin_phase("EM induce plus suffixes");
   fprintf(stderr, "    EM induce plus suffixes:\n");
   fprintf(stderr, "      Single buffer size = %lu (%.1LfMiB)\n", computed_buf_size, (1.L * computed_buf_size) / (1L << 20));
   fprintf(stderr, "      All buffers RAM budget = %lu (%.1LfMiB)\n", ram_for_buffers, (1.L * ram_for_buffers) / (1L << 20));
@@ -136,18 +152,8 @@ std::uint64_t em_induce_plus_suffixes(
 
 
   // Initialize radix heap.
-  std::vector<std::uint64_t> radix_logs;
-  {
-    std::uint64_t target_sum = 8UL * sizeof(char_type);
-    std::uint64_t cur_sum = 0;
-    while (cur_sum < target_sum) {
-      std::uint64_t radix_log = std::min(10UL, target_sum - cur_sum);
-      radix_logs.push_back(radix_log);
-      cur_sum += radix_log;
-    }
-  }
-  typedef em_radix_heap<char_type, block_id_type> radix_heap_type;
   radix_heap_type *radix_heap = new radix_heap_type(radix_logs, output_pos_filename, ram_for_radix_heap);
+  radix_heap->set_phase_name("EM induce plus suffixes");
 
   // Initialize readers of data associated with minus suffixes.
   typedef async_backward_stream_reader<text_offset_type> minus_count_reader_type;
@@ -196,8 +202,19 @@ std::uint64_t em_induce_plus_suffixes(
   output_type_writer_type *output_type_writer = new output_type_writer_type(output_type_filename, 4UL * computed_buf_size, 4UL);
   output_count_writer_type *output_count_writer = new output_count_writer_type(output_count_filename, 4UL * computed_buf_size, 4UL);
 
+  // Initialize the writers of symbols preceding the plus and minus
+  // star suffixes (if preceded by a plus suffix), used to compute
+  // the BWT in the final pass.
+  typedef async_stream_writer<char_type> bwt_writer_type;
+  bwt_writer_type *output_plus_bwt_writer = NULL;
+  bwt_writer_type *output_minus_star_bwt_writer = NULL;
+  if (compute_bwt) {
+    output_plus_bwt_writer = new bwt_writer_type(output_plus_bwt_filename, 4UL * computed_buf_size, 4UL);
+    output_minus_star_bwt_writer = new bwt_writer_type(output_minus_star_bwt_filename, 4UL * computed_buf_size, 4UL);
+  }
+
   bool empty_output = true;
-  std::uint64_t max_char = std::numeric_limits<char_type>::max();
+  std::uint64_t max_char = text_alphabet_size - 1;
   std::uint64_t head_char = 0;
   {
     std::uint64_t size = utils::file_size(minus_count_filename);
@@ -207,6 +224,7 @@ std::uint64_t em_induce_plus_suffixes(
   std::uint64_t prev_written_head_char = 0;
   std::uint64_t cur_bucket_size = 0;
   std::vector<std::uint64_t> block_count(n_blocks, 0UL);
+  progress_counter progress(text_length);
 
   // Induce plus suffixes.
   while (!radix_heap->empty() || !minus_count_reader->empty()) {
@@ -218,6 +236,7 @@ std::uint64_t em_induce_plus_suffixes(
       std::uint64_t head_pos_block_beg = head_pos_block_id * max_block_size;
       std::uint64_t head_pos = head_pos_block_beg + plus_pos_reader->read_from_ith_file(head_pos_block_id);
       output_pos_writer->write(head_pos);
+      progress.increment();
 
       bool is_head_pos_star = plus_type_reader->read_from_ith_file(head_pos_block_id);
       output_type_writer->write(is_head_pos_star);
@@ -241,6 +260,8 @@ std::uint64_t em_induce_plus_suffixes(
         std::uint64_t prev_pos_char = symbols_reader->read_from_ith_file(head_pos_block_id);
         std::uint64_t prev_pos_block_id = (head_pos_block_id * max_block_size == head_pos) ? head_pos_block_id - 1 : head_pos_block_id;
         radix_heap->push(max_char - prev_pos_char, prev_pos_block_id);
+        if (compute_bwt)
+          output_plus_bwt_writer->write(prev_pos_char);
       }
     }
 
@@ -249,10 +270,13 @@ std::uint64_t em_induce_plus_suffixes(
     for (std::uint64_t i = 0; i < minus_sufs_count; ++i) {
       std::uint64_t head_pos_block_id = minus_pos_reader->read();
       ++block_count[head_pos_block_id];
+      progress.increment();
       bool pos_starts_at_block_beg = (block_count[head_pos_block_id] == block_count_target[head_pos_block_id]);
       std::uint64_t prev_pos_block_id = head_pos_block_id - pos_starts_at_block_beg;
       std::uint64_t prev_pos_char = symbols_reader->read_from_ith_file(head_pos_block_id);
       radix_heap->push(max_char - prev_pos_char, prev_pos_block_id);
+      if (compute_bwt)
+        output_minus_star_bwt_writer->write(prev_pos_char);
     }
 
     // Update current symbol.
@@ -283,12 +307,20 @@ std::uint64_t em_induce_plus_suffixes(
     output_pos_writer->bytes_written() +
     output_type_writer->bytes_written() +
     output_count_writer->bytes_written();
+  if (compute_bwt)
+    io_volume +=
+      output_plus_bwt_writer->bytes_written() +
+      output_minus_star_bwt_writer->bytes_written();
   total_io_volume += io_volume;
 
   // Compute return value.
   std::uint64_t n_parts = output_pos_writer->get_parts_count();
 
   // Clean up.
+  if (compute_bwt) {
+    delete output_minus_star_bwt_writer;
+    delete output_plus_bwt_writer;
+  }
   delete output_count_writer;
   delete output_type_writer;
   delete output_pos_writer;
@@ -301,6 +333,7 @@ std::uint64_t em_induce_plus_suffixes(
 
   // Print summary.
   long double total_time = utils::wclock() - start;
+  phase_stats::end_phase();
   fprintf(stderr, "      Time = %.2Lfs, I/O = %.2LfMiB/s, "
       "total I/O vol = %.1Lf bytes/symbol (of initial text)\n",
       total_time, (1.L * io_volume / (1L << 20)) / total_time,
@@ -310,6 +343,25 @@ std::uint64_t em_induce_plus_suffixes(
   return n_parts;
 }
 
+// Run em_induce_plus_suffixes with the bucket queue (for
+// small alphabets) or with the radix heap as the priority queue.
+template<typename char_type,
+  typename text_offset_type,
+  typename block_id_type,
+  typename... args_type>
+std::uint64_t em_induce_plus_suffixes_with_queue(
+    bool use_bucket_queue,
+    args_type&&... args) {
+  typedef em_radix_heap<char_type, block_id_type> radix_heap_type;
+  typedef em_bucket_queue<char_type, block_id_type> bucket_queue_type;
+  if (use_bucket_queue)
+    return em_induce_plus_suffixes<char_type, text_offset_type,
+      block_id_type, bucket_queue_type>(std::forward<args_type>(args)...);
+  else
+    return em_induce_plus_suffixes<char_type, text_offset_type,
+      block_id_type, radix_heap_type>(std::forward<args_type>(args)...);
+}
+
 }  // namespace fsais_private
 
 #endif  // __FSAIS_SRC_EM_INDUCE_PLUS_SUFFIXES_HPP_INCLUDED
@@ -47,7 +47,10 @@
 #include <thread>
 #include <condition_variable>
 
+#include "packed_pair.hpp"
 #include "utils.hpp"
+#include "heap_stats.hpp"
+#include "hardware_profile.hpp"
 
 
 namespace fsais_private {
@@ -166,78 +169,303 @@ class ram_queue {
     }
 };
 
-template<typename ValueType, typename RadixHeapType>
-class em_queue {
+template<typename T>
+struct circular_queue {
+  private:
+    std::uint64_t m_size;
+    std::uint64_t m_filled;
+    std::uint64_t m_head;
+    std::uint64_t m_tail;
+    T *m_data;
+
+  public:
+    circular_queue()
+      : m_size(1),
+        m_filled(0),
+        m_head(0),
+        m_tail(0),
+        m_data(new T[m_size]) {}
+
+    inline void push(T x) {
+      m_data[m_head++] = x;
+      if (m_head == m_size)
+        m_head = 0;
+      ++m_filled;
+      if (m_filled == m_size)
+        enlarge();
+    }
+
+    inline T &front() const {
+      return m_data[m_tail];
+    }
+
+    inline void pop() {
+      ++m_tail;
+      if (m_tail == m_size)
+        m_tail = 0;
+      --m_filled;
+    }
+
+    inline bool empty() const { return (m_filled == 0); }
+    inline std::uint64_t size() const { return m_filled; }
+
+    ~circular_queue() {
+      delete[] m_data;
+    }
+
+  private:
+    void enlarge() {
+      T *new_data = new T[2 * m_size];
+      std::uint64_t left = m_filled;
+      m_filled = 0;
+      while (left > 0) {
+        std::uint64_t tocopy = std::min(left, m_size - m_tail);
+        std::copy(m_data + m_tail,
+            m_data + m_tail + tocopy, new_data + m_filled);
+        m_tail += tocopy;
+        if (m_tail == m_size)
+          m_tail = 0;
+        left -= tocopy;
+        m_filled += tocopy;
+      }
+      m_head = m_filled;
+      m_tail = 0;
+      m_size <<= 1;
+      std::swap(m_data, new_data);
+      delete[] new_data;
+    }
+};
+
+enum em_io_request_type {
+  em_write_request,
+  em_read_request
+};
+
+template<typename queue_type>
+struct io_request {
+  io_request() {}
+  io_request(queue_type *queue, std::FILE *file,
+      em_io_request_type type, std::uint64_t pos = 0) {
+    m_queue = queue;
+    m_file = file;
+    m_type = type;
+    m_pos = pos;
+  }
+
+  queue_type *m_queue;
+  std::FILE *m_file;
+  em_io_request_type m_type;
+  std::uint64_t m_pos;
+};
+
+template<typename req_type>
+struct request_queue {
+  request_queue()
+    : m_no_more_requests(false) {}
+
+  req_type get() {
+    req_type ret = m_requests.front();
+    m_requests.pop();
+    return ret;
+  }
+
+  void add(req_type &request) {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_requests.push(request);
+  }
+
+  inline bool empty() const {
+    return m_requests.empty();
+  }
+
+  circular_queue<req_type> m_requests;
+  std::condition_variable m_cv;
+  std::mutex m_mutex;
+  bool m_no_more_requests;
+};
+
+template<typename T>
+struct ram_queue_collection {
+  typedef ram_queue<T> queue_type;
+  ram_queue_collection(std::uint64_t n_queues,
+      std::uint64_t items_per_queue, T *mem) {
+    for (std::uint64_t i = 0; i < n_queues; ++i) {
+      m_queues.push_back(new queue_type(items_per_queue, mem));
+      mem += items_per_queue;
+    }
+  }
+
+  ~ram_queue_collection() {
+    for (std::uint64_t i = 0; i < m_queues.size(); ++i)
+      delete m_queues[i];
+  }
+
+  queue_type* get() {
+    queue_type *ret = m_queues.back();
+    m_queues.pop_back();
+    return ret;
+  }
+
+  void add(queue_type *q) {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_queues.push_back(q);
+  }
+
+  inline bool empty() const {
+    return m_queues.empty();
+  }
+
+  std::vector<queue_type*> m_queues;
+  std::condition_variable m_cv;
+  std::mutex m_mutex;
+};
+
+// The I/O thread (and the RAM queues it uses) shared by the
+// external-memory priority queues built from em_queues
+// (em_radix_heap and em_bucket_queue). The memory for the
+// k_io_queues I/O queues is provided by the caller.
+template<typename ValueType>
+class em_queue_io {
   public:
     typedef ValueType value_type;
+    typedef ram_queue<value_type> ram_queue_type;
+
+    static const std::uint64_t k_io_queues = 8;
 
   private:
-    template<typename T>
-    struct circular_queue {
-      private:
-        std::uint64_t m_size;
-        std::uint64_t m_filled;
-        std::uint64_t m_head;
-        std::uint64_t m_tail;
-        T *m_data;
-
-      public:
-        circular_queue()
-          : m_size(1),
-            m_filled(0),
-            m_head(0),
-            m_tail(0),
-            m_data(new T[m_size]) {}
-
-        inline void push(T x) {
-          m_data[m_head++] = x;
-          if (m_head == m_size)
-            m_head = 0;
-          ++m_filled;
-          if (m_filled == m_size)
-            enlarge();
-        }
+    typedef ram_queue_collection<value_type> ram_queue_collection_type;
+    typedef io_request<ram_queue_type> request_type;
+    typedef request_queue<request_type> request_queue_type;
 
-        inline T &front() const {
-          return m_data[m_tail];
-        }
+    ram_queue_collection_type *m_empty_io_queues;
+    request_queue_type m_io_request_queue;
+    std::condition_variable m_read_request_cv;
+    std::mutex m_read_request_mutex;
+    bool m_read_io_request_complete;
+    std::thread *m_io_thread;
 
-        inline void pop() {
-          ++m_tail;
-          if (m_tail == m_size)
-            m_tail = 0;
-          --m_filled;
-        }
+  private:
+    static void async_io_thread_code(em_queue_io<value_type> *caller) {
+      while (true) {
 
-        inline bool empty() const { return (m_filled == 0); }
-        inline std::uint64_t size() const { return m_filled; }
+        // Wait for request or until 'no more requests' flag is set.
+        std::unique_lock<std::mutex> lk(caller->m_io_request_queue.m_mutex);
+        while (caller->m_io_request_queue.empty() &&
+            !(caller->m_io_request_queue.m_no_more_requests))
+          caller->m_io_request_queue.m_cv.wait(lk);
 
-        ~circular_queue() {
-          delete[] m_data;
+        if (caller->m_io_request_queue.empty() &&
+            caller->m_io_request_queue.m_no_more_requests) {
+
+          // No more requests -- exit.
+          lk.unlock();
+          break;
         }
 
-      private:
-        void enlarge() {
-          T *new_data = new T[2 * m_size];
-          std::uint64_t left = m_filled;
-          m_filled = 0;
-          while (left > 0) {
-            std::uint64_t tocopy = std::min(left, m_size - m_tail);
-            std::copy(m_data + m_tail,
-                m_data + m_tail + tocopy, new_data + m_filled);
-            m_tail += tocopy;
-            if (m_tail == m_size)
-              m_tail = 0;
-            left -= tocopy;
-            m_filled += tocopy;
-          }
-          m_head = m_filled;
-          m_tail = 0;
-          m_size <<= 1;
-          std::swap(m_data, new_data);
-          delete[] new_data;
+        // Extract the request from the collection.
+        request_type request = caller->m_io_request_queue.get();
+        lk.unlock();
+
+        // Process the request.
+        if (request.m_type == em_write_request) {
+          request.m_queue->write_to_file(request.m_file);
+          request.m_queue->set_empty();
+
+          // Add the (now empty) queue to the collection
+          // of empty queues and notify the waiting thread.
+          caller->m_empty_io_queues->add(request.m_queue);
+          caller->m_empty_io_queues->m_cv.notify_one();
+        } else {
+          std::fseek(request.m_file, request.m_pos, SEEK_SET);
+          request.m_queue->read_from_file(request.m_file);
+
+          // Let the waiting main thread know that
+          // the read request is now completed.
+          std::unique_lock<std::mutex> lk2(caller->m_read_request_mutex);
+          caller->m_read_io_request_complete = true;
+          lk2.unlock();
+          caller->m_read_request_cv.notify_one();
         }
-    };
+      }
+    }
+
+  public:
+    em_queue_io(std::uint64_t items_per_ram_queue, value_type *mem) {
+      m_read_io_request_complete = false;
+
+      // Allocate collection of empty I/O queue.
+      m_empty_io_queues = new ram_queue_collection_type(k_io_queues,
+          items_per_ram_queue, mem);
+
+      // Start I/O thread.
+      m_io_thread = new std::thread(async_io_thread_code, this);
+    }
+
+    // Note: the read request is blocking!
+    void issue_read_request(
+        ram_queue_type *q,
+        std::uint64_t pos,
+        std::FILE *f) {
+
+      // Creare read request.
+      request_type req(q, f, em_read_request, pos);
+      m_read_io_request_complete = false;
+
+      // Add to requests queue.
+      m_io_request_queue.add(req);
+      m_io_request_queue.m_cv.notify_one();
+
+      // Wait for completion.
+      std::unique_lock<std::mutex> lk(m_read_request_mutex);
+      while (!m_read_io_request_complete)
+        m_read_request_cv.wait(lk);
+      lk.unlock();
+    }
+
+    // Note: the write request is non-blocking!
+    // Returns the new, empty ram queue.
+    ram_queue_type* issue_write_request(ram_queue_type *q, std::FILE *f) {
+
+      // Creat write request.
+      request_type req(q, f, em_write_request);
+
+      // Add to requests queue and exit
+      // (unlike in the case of read req,
+      // we don't wait for completion).
+      m_io_request_queue.add(req);
+      m_io_request_queue.m_cv.notify_one();
+
+      // Extract and return an empty ram queue.
+      std::unique_lock<std::mutex> lk(m_empty_io_queues->m_mutex);
+      while (m_empty_io_queues->empty())
+        m_empty_io_queues->m_cv.wait(lk);
+      ram_queue_type *ret = m_empty_io_queues->get();
+      lk.unlock();
+
+      return ret;
+    }
+
+    ~em_queue_io() {
+
+      // Let the I/O thread know it should finish.
+      std::unique_lock<std::mutex> lk(m_io_request_queue.m_mutex);
+      m_io_request_queue.m_no_more_requests = true;
+      lk.unlock();
+      m_io_request_queue.m_cv.notify_one();
+
+      // Wait for the I/O thread to finish.
+      m_io_thread->join();
+      delete m_io_thread;
+
+      // Clean up.
+      delete m_empty_io_queues;
+    }
+};
+
+template<typename ValueType, typename RadixHeapType>
+class em_queue {
+  public:
+    typedef ValueType value_type;
 
   private:
     typedef ram_queue<value_type> ram_queue_type;
@@ -267,6 +495,11 @@ class em_queue {
       m_full_ram_queues.pop();
       m_io_volume += q->size_in_bytes();
       m_file_size += q->size();
+
+      // The file is only created on the first flush, so that
+      // queues that never spill do not hold a file descriptor.
+      if (m_file == NULL)
+        m_file = utils::file_open_nobuf(m_filename, "a+");
       ram_queue_type *ret = m_radix_heap->issue_write_request(q, m_file);
       return ret;
     }
@@ -282,9 +515,9 @@ class em_queue {
       m_io_volume = 0;
       m_items_per_ram_queue = items_per_ram_queue;
 
-      // Initialize file.
+      // Initialize file (created on the first flush).
       m_filename = filename;
-      m_file = utils::file_open_nobuf(m_filename, "a+");
+      m_file = NULL;
       m_file_size = 0;
       m_file_head = 0;
 
@@ -418,7 +651,7 @@ class em_queue {
       if (m_file_size > 0) {
         std::fclose(m_file);
         utils::file_delete(m_filename);
-        m_file = utils::file_open_nobuf(m_filename, "a+");
+        m_file = NULL;
         m_file_size = 0;
         m_file_head = 0;
       }
@@ -448,9 +681,10 @@ class em_queue {
     ~em_queue() {
 
       // Close and delete the file.
-      std::fclose(m_file);
-      if (utils::file_exists(m_filename))
+      if (m_file != NULL) {
+        std::fclose(m_file);
         utils::file_delete(m_filename);
+      }
       reset_buffers();
     }
 };
@@ -462,242 +696,22 @@ class em_radix_heap {
   static_assert(std::is_unsigned<KeyType>::value,
       "em_radix_heap: KeyType not unsigned!");
 
-  private:
-    template<typename T>
-    struct circular_queue {
-      private:
-        std::uint64_t m_size;
-        std::uint64_t m_filled;
-        std::uint64_t m_head;
-        std::uint64_t m_tail;
-        T *m_data;
-
-      public:
-        circular_queue()
-          : m_size(1),
-            m_filled(0),
-            m_head(0),
-            m_tail(0),
-            m_data(new T[m_size]) {}
-
-        inline void push(T x) {
-          m_data[m_head++] = x;
-          if (m_head == m_size)
-            m_head = 0;
-          ++m_filled;
-          if (m_filled == m_size)
-            enlarge();
-        }
-
-        inline T &front() const {
-          return m_data[m_tail];
-        }
-
-        inline void pop() {
-          ++m_tail;
-          if (m_tail == m_size)
-            m_tail = 0;
-          --m_filled;
-        }
-
-        inline bool empty() const { return (m_filled == 0); }
-        inline std::uint64_t size() const { return m_filled; }
-
-        ~circular_queue() {
-          delete[] m_data;
-        }
-
-      private:
-        void enlarge() {
-          T *new_data = new T[2 * m_size];
-          std::uint64_t left = m_filled;
-          m_filled = 0;
-          while (left > 0) {
-            std::uint64_t tocopy = std::min(left, m_size - m_tail);
-            std::copy(m_data + m_tail,
-                m_data + m_tail + tocopy, new_data + m_filled);
-            m_tail += tocopy;
-            if (m_tail == m_size)
-              m_tail = 0;
-            left -= tocopy;
-            m_filled += tocopy;
-          }
-          m_head = m_filled;
-          m_tail = 0;
-          m_size <<= 1;
-          std::swap(m_data, new_data);
-          delete[] new_data;
-        }
-    };
-
   public:
     typedef KeyType key_type;
     typedef ValueType value_type;
     typedef em_radix_heap<key_type, value_type> radix_heap_type;
 
-  private:
-    template<typename S, typename T>
-    struct packed_pair {
-      packed_pair() {}
-      packed_pair(S &f, T &s) {
-        first = f;
-        second = s;
-      }
-
-      S first;
-      T second;
-    } __attribute__((packed));
-
   private:
     typedef packed_pair<key_type, value_type> pair_type;
     typedef ram_queue<pair_type> ram_queue_type;
     typedef em_queue<pair_type, radix_heap_type> em_queue_type;
+    typedef em_queue_io<pair_type> em_queue_io_type;
     friend em_queue_type;
 
-  private:
-    static const std::uint64_t k_opt_single_queue_size_bytes = (1L << 20);
-    static const std::uint64_t k_io_queues = 8;
-    enum e_request_type { write_request, read_request };
-
-    template<typename queue_type>
-    struct io_request {
-      io_request() {}
-      io_request(queue_type *queue, std::FILE *file,
-          e_request_type type, std::uint64_t pos = 0) {
-        m_queue = queue;
-        m_file = file;
-        m_type = type;
-        m_pos = pos;
-      }
-
-      queue_type *m_queue;
-      std::FILE *m_file;
-      e_request_type m_type;
-      std::uint64_t m_pos;
-    };
-
-    template<typename req_type>
-    struct request_queue {
-      request_queue()
-        : m_no_more_requests(false) {}
-
-      req_type get() {
-        req_type ret = m_requests.front();
-        m_requests.pop();
-        return ret;
-      }
-
-      void add(req_type &request) {
-        std::lock_guard<std::mutex> lk(m_mutex);
-        m_requests.push(request);
-      }
-
-      inline bool empty() const {
-        return m_requests.empty();
-      }
-
-      circular_queue<req_type> m_requests;
-      std::condition_variable m_cv;
-      std::mutex m_mutex;
-      bool m_no_more_requests;
-    };
-
-    template<typename T>
-    struct ram_queue_collection {
-      typedef ram_queue<T> queue_type;
-      ram_queue_collection(std::uint64_t n_queues,
-          std::uint64_t items_per_queue, T *mem) {
-        for (std::uint64_t i = 0; i < n_queues; ++i) {
-          m_queues.push_back(new queue_type(items_per_queue, mem));
-          mem += items_per_queue;
-        }
-      }
-
-      ~ram_queue_collection() {
-        for (std::uint64_t i = 0; i < m_queues.size(); ++i)
-          delete m_queues[i];
-      }
-
-      queue_type* get() {
-        queue_type *ret = m_queues.back();
-        m_queues.pop_back();
-        return ret;
-      }
-
-      void add(queue_type *q) {
-        std::lock_guard<std::mutex> lk(m_mutex);
-        m_queues.push_back(q);
-      }
-
-      inline bool empty() const {
-        return m_queues.empty();
-      }
-
-      std::vector<queue_type*> m_queues;
-      std::condition_variable m_cv;
-      std::mutex m_mutex;
-    };
+    static const std::uint64_t k_io_queues = em_queue_io_type::k_io_queues;
 
   private:
-    template<typename S, typename T>
-    static void async_io_thread_code(em_radix_heap<S, T> *caller) {
-      typedef packed_pair<S, T> pair_type;
-      typedef ram_queue<pair_type> ram_queue_type;
-      typedef io_request<ram_queue_type> req_type;
-      while (true) {
-
-        // Wait for request or until 'no more requests' flag is set.
-        std::unique_lock<std::mutex> lk(caller->m_io_request_queue.m_mutex);
-        while (caller->m_io_request_queue.empty() &&
-            !(caller->m_io_request_queue.m_no_more_requests))
-          caller->m_io_request_queue.m_cv.wait(lk);
-
-        if (caller->m_io_request_queue.empty() &&
-            caller->m_io_request_queue.m_no_more_requests) {
-
-          // No more requests -- exit.
-          lk.unlock();
-          break;
-        }
-
-        // Extract the request from the collection.
-        req_type request = caller->m_io_request_queue.get();
-        lk.unlock();
-
-        // Process the request.
-        if (request.m_type == write_request) {
-          request.m_queue->write_to_file(request.m_file);
-          request.m_queue->set_empty();
-
-          // Add the (now empty) queue to the collection
-          // of empty queues and notify the waiting thread.
-          caller->m_empty_io_queues->add(request.m_queue);
-          caller->m_empty_io_queues->m_cv.notify_one();
-        } else {
-          std::fseek(request.m_file, request.m_pos, SEEK_SET);
-          request.m_queue->read_from_file(request.m_file);
-
-          // Let the waiting main thread know that
-          // the read request is now completed.
-          std::unique_lock<std::mutex> lk2(caller->m_read_request_mutex);
-          caller->m_read_io_request_complete = true;
-          lk2.unlock();
-          caller->m_read_request_cv.notify_one();
-        }
-      }
-    }
-
-  private:
-    typedef ram_queue_collection<pair_type> ram_queue_collection_type;
-    typedef io_request<ram_queue_type> request_type;
-    typedef request_queue<request_type> request_queue_type;
-
-    ram_queue_collection_type *m_empty_io_queues;
-    request_queue_type m_io_request_queue;
-    std::condition_variable m_read_request_cv;
-    std::mutex m_read_request_mutex;
-    bool m_read_io_request_complete;
-    std::thread *m_io_thread;
+    em_queue_io_type *m_io;
 
     std::uint64_t m_size;
     std::uint64_t m_key_lower_bound;
@@ -725,6 +739,10 @@ class em_radix_heap {
     em_queue_type **m_queues;
     std::vector<ram_queue_type*> m_empty_ram_queues;
 
+#ifdef MONITOR_HEAP_STATS
+    heap_stats m_stats;
+#endif
+
   private:
     void init(
         std::vector<std::uint64_t> radix_logs,
@@ -793,6 +811,15 @@ class em_radix_heap {
       m_queue_min = std::vector<std::uint64_t>(m_em_queue_count,
           std::numeric_limits<std::uint64_t>::max());
 
+#ifdef MONITOR_HEAP_STATS
+      std::vector<std::uint64_t> queue_level(m_em_queue_count, 0UL);
+      for (std::uint64_t level = 1; level < radix_logs.size(); ++level)
+        for (std::uint64_t id = m_sum_of_radixes[level] + 1;
+            id < m_sum_of_radixes[level + 1] + 1; ++id)
+          queue_level[id] = level;
+      m_stats.init("em_radix_heap", queue_level);
+#endif
+
       // Request RAM for queues.
       n_ram_queues = std::max(n_ram_queues, m_em_queue_count + 1);
       std::uint64_t n_all_queues = n_ram_queues + k_io_queues;
@@ -807,14 +834,9 @@ class em_radix_heap {
         m_mem_ptr += items_per_ram_queue;
       }
 
-      // Allocate collection of empty I/O queue.
-      m_empty_io_queues = new ram_queue_collection_type(k_io_queues,
-          items_per_ram_queue, m_mem_ptr);
-      m_mem_ptr += k_io_queues * items_per_ram_queue;
-
       // Start I/O thread.
-      m_io_thread =
-        new std::thread(async_io_thread_code<key_type, value_type>, this);
+      m_io = new em_queue_io_type(items_per_ram_queue, m_mem_ptr);
+      m_mem_ptr += k_io_queues * items_per_ram_queue;
     }
 
     // Note: the read request is blocking!
@@ -822,43 +844,22 @@ class em_radix_heap {
         ram_queue_type *q,
         std::uint64_t pos,
         std::FILE *f) {
+      m_io->issue_read_request(q, pos, f);
 
-      // Creare read request.
-      request_type req(q, f, read_request, pos);
-      m_read_io_request_complete = false;
-
-      // Add to requests queue.
-      m_io_request_queue.add(req);
-      m_io_request_queue.m_cv.notify_one();
-
-      // Wait for completion.
-      std::unique_lock<std::mutex> lk(m_read_request_mutex);
-      while (!m_read_io_request_complete)
-        m_read_request_cv.wait(lk);
-      lk.unlock();
+#ifdef MONITOR_HEAP_STATS
+      m_stats.reload(q->size_in_bytes());
+#endif
     }
 
     // Note: the write request is non-blocking!
     // Returns the new, empty ram queue.
     ram_queue_type* issue_write_request(ram_queue_type *q, std::FILE *f) {
 
-      // Creat write request.
-      request_type req(q, f, write_request);
-
-      // Add to requests queue and exit
-      // (unlike in the case of read req,
-      // we don't wait for completion).
-      m_io_request_queue.add(req);
-      m_io_request_queue.m_cv.notify_one();
-
-      // Extract and return an empty ram queue.
-      std::unique_lock<std::mutex> lk(m_empty_io_queues->m_mutex);
-      while (m_empty_io_queues->empty())
-        m_empty_io_queues->m_cv.wait(lk);
-      ram_queue_type *ret = m_empty_io_queues->get();
-      lk.unlock();
+#ifdef MONITOR_HEAP_STATS
+      m_stats.spill(q->size_in_bytes());
+#endif
 
-      return ret;
+      return m_io->issue_write_request(q, f);
     }
 
     inline std::uint64_t get_queue_id(key_type key) const {
@@ -948,7 +949,14 @@ class em_radix_heap {
               std::max(m_get_empty_ram_queue_ptr, newid);
           m_queue_min[newid] =
             std::min(m_queue_min[newid], (std::uint64_t)p.first);
+#ifdef MONITOR_HEAP_STATS
+          m_stats.remove_from_queue(id);
+          m_stats.add_to_queue(newid);
+#endif
         }
+#ifdef MONITOR_HEAP_STATS
+        m_stats.redistribute(queue_size);
+#endif
         m_bottom_level_queue_ptr = get_queue_id(m_key_lower_bound);
         m_queues[id]->reset_file();
         m_queues[id]->reset_buffers();
@@ -969,17 +977,19 @@ class em_radix_heap {
       std::uint64_t required_ram_queues_count = em_queue_count + 1;
 
       // Decide on the size of a single ram queue and their number.
+      std::uint64_t opt_single_queue_size_bytes =
+        hardware_profile::opt_request_size();
       if ((required_ram_queues_count + k_io_queues) *
-          k_opt_single_queue_size_bytes <= ram_use) {
+          opt_single_queue_size_bytes <= ram_use) {
 
         // Best case, we can allocate at least the required
         // number of ram queues of optimal size.
         std::uint64_t ram_for_nonio_ram_queues =
-          ram_use - k_io_queues * k_opt_single_queue_size_bytes;
+          ram_use - k_io_queues * opt_single_queue_size_bytes;
         std::uint64_t n_ram_queues =
-          ram_for_nonio_ram_queues / k_opt_single_queue_size_bytes;
+          ram_for_nonio_ram_queues / opt_single_queue_size_bytes;
         std::uint64_t items_per_ram_queue =
-          utils::disk_block_size<pair_type>(k_opt_single_queue_size_bytes);
+          utils::disk_block_size<pair_type>(opt_single_queue_size_bytes);
         init(radix_logs, filename, n_ram_queues, items_per_ram_queue);
       } else {
 
@@ -1006,10 +1016,13 @@ class em_radix_heap {
     inline void push(key_type key, value_type value) {
       ++m_size;
       std::uint64_t id = get_queue_id(key);
-      if (m_queues[id]->push(pair_type(key, value)))
+      if (m_queues[id]->push(pair_type((key_type)key, (value_type)value)))
         m_get_empty_ram_queue_ptr = std::max(m_get_empty_ram_queue_ptr, id);
       m_queue_min[id] = std::min(m_queue_min[id], (std::uint64_t)key);
       m_min_compare_ptr = std::min(m_min_compare_ptr, id);
+#ifdef MONITOR_HEAP_STATS
+      m_stats.push(id);
+#endif
     }
 
     // Return true iff x <= key, where x is the
@@ -1032,6 +1045,9 @@ class em_radix_heap {
       key_type key = m_queues[m_bottom_level_queue_ptr]->front().first;
       value_type value = m_queues[m_bottom_level_queue_ptr]->front().second;
       m_queues[m_bottom_level_queue_ptr]->pop();
+#ifdef MONITOR_HEAP_STATS
+      m_stats.pop(m_bottom_level_queue_ptr);
+#endif
       if (m_queues[m_bottom_level_queue_ptr]->empty()) {
         m_queues[m_bottom_level_queue_ptr]->reset_buffers();
         m_queues[m_bottom_level_queue_ptr]->reset_file();
@@ -1055,20 +1071,25 @@ class em_radix_heap {
       return result;
     }
 
-    ~em_radix_heap() {
+    // Name of the phase using the heap, reported
+    // together with the MONITOR_HEAP_STATS counters.
+    void set_phase_name(std::string phase_name) {
+#ifdef MONITOR_HEAP_STATS
+      m_stats.set_phase_name(phase_name);
+#else
+      (void) phase_name;
+#endif
+    }
 
-      // Let the I/O thread know it should finish.
-      std::unique_lock<std::mutex> lk(m_io_request_queue.m_mutex);
-      m_io_request_queue.m_no_more_requests = true;
-      lk.unlock();
-      m_io_request_queue.m_cv.notify_one();
+    ~em_radix_heap() {
+#ifdef MONITOR_HEAP_STATS
+      m_stats.print();
+#endif
 
-      // Wait for the I/O thread to finish.
-      m_io_thread->join();
-      delete m_io_thread;
+      // Stop the I/O thread.
+      delete m_io;
 
       // Clean up.
-      delete m_empty_io_queues;
       for (std::uint64_t i = 0; i < m_em_queue_count; ++i)
         delete m_queues[i];
       delete[] m_queues;
@@ -0,0 +1,484 @@
+/**
+ * @file    fsais_src/em_update_sa.hpp
+ * @section LICENCE
+ *
+ * This file is part of fSAIS v0.1.0
+ * See: https://github.com/dominikkempa/fsais
+ *
+ * Copyright (C) 2016-2020
+ *   Dominik Kempa <dominik.kempa (at) gmail.com>
+ *   Juha Karkkainen <juha.karkkainen (at) cs.helsinki.fi>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ **/
+
+#ifndef __FSAIS_SRC_EM_UPDATE_SA_HPP_INCLUDED
+#define __FSAIS_SRC_EM_UPDATE_SA_HPP_INCLUDED
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include "io/async_stream_reader.hpp"
+#include "io/async_stream_writer.hpp"
+#include "io/async_backward_stream_reader.hpp"
+#include "em_compact_alphabet.hpp"
+#include "em_compute_sa.hpp"
+#include "utils.hpp"
+
+
+namespace fsais_private {
+
+// Rank queries over the BWT stored in RAM, using the wavelet
+// matrix of the BWT: ceil(log2 sigma) bit vectors of the length
+// of the BWT, one per bit of symbols (from the most significant).
+// The bit vector of level l stores the l-th bit of symbols sorted
+// stably by their l preceding bits. Every bit vector stores, for
+// every 256 bits, the number of ones preceding them. A rank query
+// thus takes O(log sigma) time (at most 4 popcounts per level).
+template<typename char_type>
+class bwt_rank_support {
+  private:
+    static const std::uint64_t k_block_size_log = 8;
+    static const std::uint64_t k_block_words = (1UL << k_block_size_log) / 64;
+
+    std::uint64_t m_n_levels;
+    std::uint64_t m_n_words;
+    std::uint64_t m_n_blocks;
+    std::uint64_t *m_bits;
+    std::uint64_t *m_block_counts;
+    std::vector<std::uint64_t> m_zeros;
+
+    // Return the number of ones in bits[0..i) of the given level.
+    inline std::uint64_t rank1(std::uint64_t level, std::uint64_t i) const {
+      const std::uint64_t * const bits = m_bits + level * m_n_words;
+      std::uint64_t block_id = (i >> k_block_size_log);
+      std::uint64_t result = m_block_counts[level * m_n_blocks + block_id];
+      for (std::uint64_t j = block_id * k_block_words; j < (i >> 6); ++j)
+        result += __builtin_popcountll(bits[j]);
+      if (i & 63)
+        result += __builtin_popcountll(bits[i >> 6] & ((1UL << (i & 63)) - 1));
+      return result;
+    }
+
+    static std::uint64_t n_levels(std::uint64_t alphabet_size) {
+      return std::max(1UL, utils::log2ceil(alphabet_size));
+    }
+
+  public:
+
+    // The BWT is overwritten (it is used as a buffer during the
+    // construction) and is not accessed after the construction.
+    bwt_rank_support(char_type * const bwt,
+        std::uint64_t length, std::uint64_t alphabet_size) {
+      m_n_levels = n_levels(alphabet_size);
+      m_n_words = (length >> 6) + 1;
+      m_n_blocks = (length >> k_block_size_log) + 1;
+      m_bits = utils::allocate_array<std::uint64_t>(m_n_levels * m_n_words);
+      m_block_counts = utils::allocate_array<std::uint64_t>(m_n_levels * m_n_blocks);
+      m_zeros.resize(m_n_levels);
+      std::fill(m_bits, m_bits + m_n_levels * m_n_words, 0UL);
+
+      char_type *cur = bwt;
+      char_type *next = utils::allocate_array<char_type>(std::max(1UL, length));
+      for (std::uint64_t level = 0; level < m_n_levels; ++level) {
+        std::uint64_t shift = m_n_levels - 1 - level;
+        std::uint64_t *bits = m_bits + level * m_n_words;
+        std::uint64_t *block_counts = m_block_counts + level * m_n_blocks;
+
+        // Store the bits and count the ones.
+        std::uint64_t n_ones = 0;
+        for (std::uint64_t j = 0; j < length; ++j) {
+          std::uint64_t bit = (((std::uint64_t)cur[j] >> shift) & 1);
+          bits[j >> 6] |= (bit << (j & 63));
+          n_ones += bit;
+        }
+        m_zeros[level] = length - n_ones;
+
+        // Compute the block counts.
+        std::uint64_t count = 0;
+        for (std::uint64_t block_id = 0; block_id < m_n_blocks; ++block_id) {
+          block_counts[block_id] = count;
+          std::uint64_t words_end = std::min(m_n_words, (block_id + 1) * k_block_words);
+          for (std::uint64_t j = block_id * k_block_words; j < words_end; ++j)
+            count += __builtin_popcountll(bits[j]);
+        }
+
+        // Sort the symbols stably by the current bit.
+        if (level + 1 < m_n_levels) {
+          std::uint64_t zeros_ptr = 0;
+          std::uint64_t ones_ptr = m_zeros[level];
+          for (std::uint64_t j = 0; j < length; ++j) {
+            if (((std::uint64_t)cur[j] >> shift) & 1)
+              next[ones_ptr++] = cur[j];
+            else next[zeros_ptr++] = cur[j];
+          }
+          std::swap(cur, next);
+        }
+      }
+
+      // Deallocate the buffer (which may be cur or next).
+      utils::deallocate((cur == bwt) ? next : cur);
+    }
+
+    // Return the number of occurrences of c in bwt[0..i).
+    inline std::uint64_t rank(std::uint64_t c, std::uint64_t i) const {
+      std::uint64_t beg = 0;
+      std::uint64_t end = i;
+      for (std::uint64_t level = 0; level < m_n_levels; ++level) {
+        if ((c >> (m_n_levels - 1 - level)) & 1) {
+          beg = m_zeros[level] + rank1(level, beg);
+          end = m_zeros[level] + rank1(level, end);
+        } else {
+          beg -= rank1(level, beg);
+          end -= rank1(level, end);
+        }
+      }
+      return end - beg;
+    }
+
+    // Return the peak RAM usage (in bytes, including the BWT and
+    // the buffer used during the construction) per symbol. Compared
+    // to storing the counts of all symbols for every block of the
+    // BWT, the RAM usage grows only with log sigma (a 64-bit count
+    // for every 256 bits adds 25%) at the cost of a rank query
+    // taking O(log sigma) instead of O(1) popcounts.
+    static long double ram_per_symbol(std::uint64_t alphabet_size) {
+      return 2.L * sizeof(char_type) + n_levels(alphabet_size) *
+        (1.L + (64.L / (1UL << k_block_size_log))) / 8.L;
+    }
+
+    ~bwt_rank_support() {
+      utils::deallocate(m_block_counts);
+      utils::deallocate(m_bits);
+    }
+};
+
+// Return the length of the longest suffix of text[0..length) that
+// also occurs in text[0..length) at a different position, or any
+// value larger than max_length if it exceeds max_length. This is
+// the largest value of the prefix function (the failure function
+// of the Knuth-Morris-Pratt algorithm) of the reversed text, which
+// is computed in a single backward scan of the text keeping in RAM
+// only the first max_length + 1 values and symbols.
+template<typename char_type, typename text_offset_type>
+std::uint64_t em_longest_repeated_suffix(
+    std::string text_filename,
+    std::uint64_t length,
+    std::uint64_t max_length,
+    std::uint64_t &total_io_volume) {
+  std::uint64_t text_length = utils::file_size(text_filename) / sizeof(char_type);
+  typedef async_backward_stream_reader<char_type> text_reader_type;
+  text_reader_type *text_reader = new text_reader_type(text_filename,
+      (4UL << 20), 4UL, (text_length - length) * sizeof(char_type));
+
+  std::vector<char_type> reversed_prefix;
+  std::vector<text_offset_type> prefix_function;
+  std::uint64_t border_length = 0;
+  std::uint64_t result = 0;
+  for (std::uint64_t i = 0; i < length; ++i) {
+    char_type c = text_reader->read();
+    if (i > 0) {
+      while (border_length > 0 && reversed_prefix[border_length] != c)
+        border_length = prefix_function[border_length - 1];
+      if (reversed_prefix[border_length] == c)
+        ++border_length;
+      result = std::max(result, border_length);
+      if (result > max_length)
+        break;
+    }
+    if (i <= max_length) {
+      reversed_prefix.push_back(c);
+      prefix_function.push_back(border_length);
+    }
+  }
+
+  // Stop I/O thread and update I/O volume.
+  text_reader->stop_reading();
+  total_io_volume += text_reader->bytes_read();
+
+  // Clean up.
+  delete text_reader;
+
+  return result;
+}
+
+// Compute the suffix array of the text stored in text_filename
+// given the suffix array (stored in old_sa_filename) of the prefix
+// of the text (old text) of length equal to the number of entries
+// in old_sa_filename, i.e., the text obtained by appending symbols
+// to the old text. Only suffixes starting in the last K symbols of
+// the old text (where K is the length of the longest suffix of
+// the old text occurring in it at a different position) can change
+// their relative order in the suffix array after appending, so
+// the suffixes starting in the last K symbols of old text and in the
+// appended symbols (the tail) are sorted with em_compute_sa, and the
+// remaining suffixes (with the order given by the old suffix array)
+// are merged into them. The merging uses the gap array, storing
+// for every suffix of the tail the number of remaining suffixes
+// preceding it, computed by backward search over the BWT of the
+// tail (in RAM) in a single backward scan of the old text. If the
+// tail does not fit in RAM, the suffix array is computed from
+// scratch.
+template<typename char_type, typename text_offset_type>
+void em_update_sa(
+    std::uint64_t ram_use,
+    std::uint64_t text_alphabet_size,
+    std::string text_filename,
+    std::string old_sa_filename,
+    std::string output_filename) {
+  std::uint64_t total_io_volume = 0;
+  std::uint64_t text_length = utils::file_size(text_filename) / sizeof(char_type);
+  std::uint64_t old_text_length = utils::file_size(old_sa_filename) / sizeof(text_offset_type);
+
+  // Turn paths absolute.
+  text_filename = utils::absolute_path(text_filename);
+  old_sa_filename = utils::absolute_path(old_sa_filename);
+  output_filename = utils::absolute_path(output_filename);
+
+  if (old_text_length > text_length) {
+    fprintf(stderr, "\nError: the old suffix array is longer than the text\n");
+    std::exit(EXIT_FAILURE);
+  }
+  if (old_sa_filename == output_filename) {
+    fprintf(stderr, "\nError: the old suffix array cannot be overwritten\n");
+    std::exit(EXIT_FAILURE);
+  }
+
+  // Print initial messages.
+  fprintf(stderr, "Running fSAIS v0.1.0 (update of the suffix array)\n");
+  fprintf(stderr, "Timestamp = %s", utils::get_timestamp().c_str());
+  fprintf(stderr, "Text filename = %s\n", text_filename.c_str());
+  fprintf(stderr, "Old SA filename = %s\n", old_sa_filename.c_str());
+  fprintf(stderr, "Output filename = %s\n", output_filename.c_str());
+  fprintf(stderr, "Text length = %lu\n", text_length);
+  fprintf(stderr, "Old text length = %lu\n", old_text_length);
+  fprintf(stderr, "RAM use = %lu (%.2LfMiB)\n", ram_use, (1.L * ram_use) / (1L << 20));
+  fprintf(stderr, "sizeof(char_type) = %lu\n", sizeof(char_type));
+  fprintf(stderr, "sizeof(text_offset_type) = %lu\n", sizeof(text_offset_type));
+  fprintf(stderr, "\n\n");
+
+  // Start the timer.
+  long double start = utils::wclock();
+
+  // Zero alphabet size means that it should be detected.
+  if (text_alphabet_size == 0) {
+    text_alphabet_size = em_detect_alphabet_size<char_type>(text_filename, total_io_volume);
+    fprintf(stderr, "\n");
+  }
+
+#ifdef SAIS_DEBUG
+  std::uint64_t max_tail_length = utils::random_int64(1L, 2L * text_length + 1);
+  std::uint64_t max_repeat_length = max_tail_length;
+#else
+  std::uint64_t max_tail_length = ram_use /
+    (bwt_rank_support<char_type>::ram_per_symbol(text_alphabet_size) + 1.L);
+  std::uint64_t max_repeat_length = ram_use /
+    (sizeof(char_type) + sizeof(text_offset_type));
+#endif
+
+  // Find the starting position of the tail.
+  std::uint64_t appended_length = text_length - old_text_length;
+  std::uint64_t tail_beg = 0;
+  if (old_text_length > 0 && appended_length < max_tail_length) {
+    max_repeat_length = std::min(max_repeat_length, max_tail_length - appended_length);
+    fprintf(stderr, "Compute the longest repeated suffix of old text: ");
+    long double step_start = utils::wclock();
+    std::uint64_t step_io_volume = total_io_volume;
+    std::uint64_t repeat_length = em_longest_repeated_suffix<char_type, text_offset_type>(
+        text_filename, old_text_length, max_repeat_length, total_io_volume);
+    step_io_volume = total_io_volume - step_io_volume;
+    long double step_time = utils::wclock() - step_start;
+    if (repeat_length <= max_repeat_length) {
+      fprintf(stderr, "time = %.2Lfs, I/O = %.2LfMiB/s, length = %lu\n", step_time,
+          (1.L * step_io_volume / (1L << 20)) / step_time, repeat_length);
+      tail_beg = std::min(old_text_length - repeat_length, text_length - 1);
+    } else fprintf(stderr, "time = %.2Lfs, length > %lu\n", step_time, max_repeat_length);
+  }
+  if (tail_beg == 0) {
+    if (old_text_length > 0)
+      fprintf(stderr, "The tail does not fit in RAM, computing from scratch\n");
+    fprintf(stderr, "\n");
+    em_compute_sa<char_type, text_offset_type>(ram_use,
+        text_alphabet_size, text_filename, output_filename);
+    return;
+  }
+  std::uint64_t tail_length = text_length - tail_beg;
+  fprintf(stderr, "Tail length = %lu\n\n", tail_length);
+
+  // Write the tail of the text to disk.
+  std::string tail_text_filename = output_filename + "tmp." + utils::random_string_hash();
+  {
+    typedef async_stream_reader<char_type> text_reader_type;
+    typedef async_stream_writer<char_type> text_writer_type;
+    text_reader_type *text_reader = new text_reader_type(text_filename, (4UL << 20), 4UL, tail_beg);
+    text_writer_type *text_writer = new text_writer_type(tail_text_filename, (4UL << 20), 4UL);
+    for (std::uint64_t i = 0; i < tail_length; ++i)
+      text_writer->write(text_reader->read());
+
+    // Stop I/O threads.
+    text_reader->stop_reading();
+
+    // Update I/O volume.
+    total_io_volume += text_reader->bytes_read() + text_writer->bytes_written();
+
+    // Clean up.
+    delete text_writer;
+    delete text_reader;
+  }
+
+  // Compute the SA and BWT of the tail.
+  std::string tail_sa_filename = output_filename + "tmp." + utils::random_string_hash();
+  std::string tail_bwt_filename = output_filename + "tmp." + utils::random_string_hash();
+  std::uint64_t io_volume_before_sort =
+    utils::get_total_bytes_read() + utils::get_total_bytes_written();
+  em_compute_sa<char_type, text_offset_type>(ram_use, text_alphabet_size,
+      tail_text_filename, tail_sa_filename, std::string(""), std::string(""),
+      tail_bwt_filename);
+  total_io_volume += (utils::get_total_bytes_read() +
+      utils::get_total_bytes_written()) - io_volume_before_sort;
+  utils::file_delete(tail_text_filename);
+  std::uint64_t tail_bwt_primary_index = 0;
+  {
+    std::FILE *f = utils::file_open(tail_bwt_filename + ".pidx", "r");
+    if (fscanf(f, "%lu", &tail_bwt_primary_index) != 1) {
+      fprintf(stderr, "\nError: reading the BWT primary index failed\n");
+      std::exit(EXIT_FAILURE);
+    }
+    std::fclose(f);
+    utils::file_delete_untracked(tail_bwt_filename + ".pidx");
+  }
+
+  // Compute the gap array. For the suffix i of the text starting
+  // before the tail, the number of suffixes of the tail smaller
+  // than suffix i is obtained from that for suffix i + 1 using the
+  // BWT of the tail (a rank query). The BWT of the tail stores
+  // every row of the BWT matrix of tail$ except the row of the
+  // whole tail, whose position is tail_bwt_primary_index. The gap
+  // array stores the counts modulo 256, the positions of counts that
+  // wrapped around are stored in gap_overflow.
+  fprintf(stderr, "Compute the gap array: ");
+  long double step_start = utils::wclock();
+  std::uint8_t *gap = utils::allocate_array<std::uint8_t>(tail_length + 1);
+  std::fill(gap, gap + tail_length + 1, 0);
+  std::vector<std::uint64_t> gap_overflow;
+  {
+    char_type *tail_bwt = utils::allocate_array<char_type>(tail_length);
+    utils::read_from_file(tail_bwt, tail_length, tail_bwt_filename);
+    utils::file_delete(tail_bwt_filename);
+    bwt_rank_support<char_type> *tail_bwt_rank =
+      new bwt_rank_support<char_type>(tail_bwt, tail_length, text_alphabet_size);
+    utils::deallocate(tail_bwt);
+    std::vector<std::uint64_t> smaller_symbols_count(text_alphabet_size, 0);
+    for (std::uint64_t c = 1; c < text_alphabet_size; ++c)
+      smaller_symbols_count[c] = smaller_symbols_count[c - 1] +
+        tail_bwt_rank->rank(c - 1, tail_length);
+
+    typedef async_backward_stream_reader<char_type> text_reader_type;
+    text_reader_type *text_reader = new text_reader_type(text_filename,
+        (4UL << 20), 4UL, tail_length * sizeof(char_type));
+    std::uint64_t rank = tail_bwt_primary_index - 1;
+    for (std::uint64_t i = tail_beg; i > 0; --i) {
+      std::uint64_t c = text_reader->read();
+      std::uint64_t rows = rank + 1;
+      std::uint64_t bwt_pos = rows - (rows > tail_bwt_primary_index);
+      rank = smaller_symbols_count[c] + tail_bwt_rank->rank(c, bwt_pos);
+      if (++gap[rank] == 0)
+        gap_overflow.push_back(rank);
+    }
+    std::sort(gap_overflow.begin(), gap_overflow.end());
+
+    // Stop I/O thread.
+    text_reader->stop_reading();
+
+    // Update I/O volume.
+    total_io_volume += text_reader->bytes_read() + tail_length * sizeof(char_type);
+
+    // Clean up.
+    delete text_reader;
+    delete tail_bwt_rank;
+  }
+  fprintf(stderr, "%.2Lfs\n", utils::wclock() - step_start);
+
+  // Merge the old suffix array (with the suffixes of
+  // the tail removed) with the suffix array of the tail.
+  fprintf(stderr, "Merge suffix arrays: ");
+  step_start = utils::wclock();
+  {
+    typedef async_stream_reader<text_offset_type> sa_reader_type;
+    typedef async_stream_writer<text_offset_type> sa_writer_type;
+    sa_reader_type *old_sa_reader = new sa_reader_type(old_sa_filename, (4UL << 20), 4UL);
+    sa_reader_type *tail_sa_reader = new sa_reader_type(tail_sa_filename, (4UL << 20), 4UL);
+    sa_writer_type *output_writer = new sa_writer_type(output_filename, (4UL << 20), 4UL);
+    std::uint64_t gap_overflow_ptr = 0;
+    for (std::uint64_t i = 0; i <= tail_length; ++i) {
+      std::uint64_t gap_size = gap[i];
+      while (gap_overflow_ptr < gap_overflow.size() && gap_overflow[gap_overflow_ptr] == i) {
+        gap_size += 256;
+        ++gap_overflow_ptr;
+      }
+      for (std::uint64_t j = 0; j < gap_size; ++j) {
+        std::uint64_t pos = old_sa_reader->read();
+        while (pos >= tail_beg)
+          pos = old_sa_reader->read();
+        output_writer->write(pos);
+      }
+      if (i < tail_length)
+        output_writer->write(tail_beg + (std::uint64_t)tail_sa_reader->read());
+    }
+
+    // Stop I/O threads.
+    old_sa_reader->stop_reading();
+    tail_sa_reader->stop_reading();
+
+    // Update I/O volume.
+    total_io_volume += old_sa_reader->bytes_read() +
+      tail_sa_reader->bytes_read() + output_writer->bytes_written();
+
+    // Clean up.
+    delete output_writer;
+    delete tail_sa_reader;
+    delete old_sa_reader;
+  }
+  utils::deallocate(gap);
+  utils::file_delete(tail_sa_filename);
+  fprintf(stderr, "%.2Lfs\n", utils::wclock() - step_start);
+
+  // Print summary.
+  long double total_time = utils::wclock() - start;
+  fprintf(stderr, "\n\nUpdate finished. Summary:\n");
+  fprintf(stderr, "  Absolute time = %.2Lfs\n", total_time);
+  fprintf(stderr, "  Relative time = %.2Lfus/appended symbol\n",
+      (1000000.L * total_time) / std::max(1UL, appended_length));
+  fprintf(stderr, "  I/O volume = %lu bytes (%.2Lf bytes/symbol)\n",
+      total_io_volume, (1.L * total_io_volume) / text_length);
+  fprintf(stderr, "  RAM allocation: cur = %lu bytes, peak = %.2LfMiB\n",
+      utils::get_current_ram_allocation(),
+      (1.L * utils::get_peak_ram_allocation()) / (1UL << 20));
+}
+
+}  // namespace fsais_private
+
+#endif  // __FSAIS_SRC_EM_UPDATE_SA_HPP_INCLUDED
@@ -0,0 +1,435 @@
+/**
+ * @file    fsais_src/em_verify_sa.hpp
+ * @section LICENCE
+ *
+ * This file is part of fSAIS v0.1.0
+ * See: https://github.com/dominikkempa/fsais
+ *
+ * Copyright (C) 2016-2020
+ *   Dominik Kempa <dominik.kempa (at) gmail.com>
+ *   Juha Karkkainen <juha.karkkainen (at) cs.helsinki.fi>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ **/
+
+#ifndef __FSAIS_SRC_EM_VERIFY_SA_HPP_INCLUDED
+#define __FSAIS_SRC_EM_VERIFY_SA_HPP_INCLUDED
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <limits>
+#include <algorithm>
+#include <thread>
+#include <functional>
+
+#include "io/async_stream_reader.hpp"
+#include "io/async_stream_writer.hpp"
+#include "io/async_multi_stream_reader.hpp"
+#include "io/async_multi_stream_writer.hpp"
+#include "utils.hpp"
+
+
+namespace fsais_private {
+
+// Process text blocks thread_id, thread_id + n_threads, ... For
+// each block, compute its ISA, check that no position occurs twice,
+// and write the keys of suffixes in the block (sorted by their
+// position in SA). The rank of the suffix starting at the beginning
+// of the next block is taken from block_first_isa.
+template<typename char_type,
+  typename text_offset_type>
+void verify_sa_compute_keys(
+    std::uint64_t thread_id,
+    std::uint64_t n_threads,
+    std::uint64_t text_length,
+    std::uint64_t max_block_size,
+    std::uint64_t buf_size,
+    std::string text_filename,
+    const std::vector<std::string> &pairs_filenames,
+    const std::vector<std::string> &key_symbols_filenames,
+    const std::vector<std::string> &key_ranks_filenames,
+    const std::vector<std::uint64_t> &block_first_isa,
+    std::uint64_t *first_violation,
+    bool *is_incomplete,
+    std::uint64_t *io_volume) {
+  std::uint64_t n_blocks = pairs_filenames.size();
+  text_offset_type *block_isa = utils::allocate_array<text_offset_type>(max_block_size);
+  char_type *block_text = utils::allocate_array<char_type>(max_block_size);
+  std::uint64_t used_bv_size = (max_block_size + 63) / 64;
+  std::uint64_t *used_bv = utils::allocate_array<std::uint64_t>(used_bv_size);
+
+  std::FILE *f_text = utils::file_open_nobuf(text_filename, "r");
+  for (std::uint64_t block_id = thread_id; block_id < n_blocks; block_id += n_threads) {
+    std::uint64_t block_beg = block_id * max_block_size;
+    std::uint64_t block_end = std::min(block_beg + max_block_size, text_length);
+    std::uint64_t block_size = block_end - block_beg;
+    std::string pairs_filename = pairs_filenames[block_id];
+    std::uint64_t n_pairs = utils::file_size(pairs_filename) / (2 * sizeof(text_offset_type));
+    bool has_repeat = false;
+
+    // Compute the ISA of the block.
+    std::fill(used_bv, used_bv + used_bv_size, 0UL);
+    {
+      typedef async_stream_reader<text_offset_type> pairs_reader_type;
+      pairs_reader_type *pairs_reader = new pairs_reader_type(pairs_filename, 4UL * buf_size, 4UL);
+      for (std::uint64_t j = 0; j < n_pairs; ++j) {
+        std::uint64_t block_offset = pairs_reader->read();
+        std::uint64_t sa_pos = pairs_reader->read();
+        if (used_bv[block_offset >> 6] & (1UL << (block_offset & 63))) {
+          *first_violation = std::min(*first_violation, sa_pos);
+          has_repeat = true;
+          break;
+        }
+        used_bv[block_offset >> 6] |= (1UL << (block_offset & 63));
+        block_isa[block_offset] = sa_pos;
+      }
+      pairs_reader->stop_reading();
+      *io_volume += pairs_reader->bytes_read();
+      delete pairs_reader;
+    }
+
+    // Positions occurring twice in SA are reported at their
+    // second occurrence. An incomplete block implies that
+    // some position (possibly in other block) occurs twice.
+    if (has_repeat || n_pairs != block_size) {
+      *is_incomplete |= (n_pairs != block_size);
+      utils::file_delete(pairs_filename);
+      continue;
+    }
+
+    // Read the text block.
+    utils::read_at_offset(block_text, block_beg * sizeof(char_type), block_size, f_text);
+    *io_volume += block_size * sizeof(char_type);
+
+    // Write the keys. The rank of the suffix following the
+    // last suffix of the text is 0, other ranks are shifted by one.
+    std::uint64_t next_block_first_rank = (block_id + 1 < n_blocks) ?
+      block_first_isa[block_id + 1] + 1 : 0;
+    {
+      typedef async_stream_reader<text_offset_type> pairs_reader_type;
+      typedef async_stream_writer<char_type> key_symbols_writer_type;
+      typedef async_stream_writer<text_offset_type> key_ranks_writer_type;
+      pairs_reader_type *pairs_reader = new pairs_reader_type(pairs_filename, 4UL * buf_size, 4UL);
+      key_symbols_writer_type *key_symbols_writer =
+        new key_symbols_writer_type(key_symbols_filenames[block_id], 4UL * buf_size, 4UL);
+      key_ranks_writer_type *key_ranks_writer =
+        new key_ranks_writer_type(key_ranks_filenames[block_id], 4UL * buf_size, 4UL);
+      for (std::uint64_t j = 0; j < n_pairs; ++j) {
+        std::uint64_t block_offset = pairs_reader->read();
+        pairs_reader->read();
+        std::uint64_t next_rank = (block_offset + 1 < block_size) ?
+          (std::uint64_t)block_isa[block_offset + 1] + 1 : next_block_first_rank;
+        key_symbols_writer->write(block_text[block_offset]);
+        key_ranks_writer->write(next_rank);
+      }
+      pairs_reader->stop_reading();
+      *io_volume +=
+        pairs_reader->bytes_read() +
+        key_symbols_writer->bytes_written() +
+        key_ranks_writer->bytes_written();
+      delete key_ranks_writer;
+      delete key_symbols_writer;
+      delete pairs_reader;
+    }
+
+    utils::file_delete(pairs_filename);
+  }
+  std::fclose(f_text);
+
+  // Clean up.
+  utils::deallocate(used_bv);
+  utils::deallocate(block_text);
+  utils::deallocate(block_isa);
+}
+
+// Check, in external memory, that the array stored in sa_filename
+// is the suffix array of the text stored in text_filename. The
+// check is the one of Burkhardt and Karkkainen: SA is correct iff
+// it is a permutation of [0..n) and for every i > 0, the pair
+// (text[SA[i - 1]], ISA[SA[i - 1] + 1]) is smaller than the pair
+// (text[SA[i]], ISA[SA[i] + 1]), where ISA[n] is smaller than
+// all other ranks. Positions are distributed into blocks of the
+// text that fit in RAM, so the whole check takes O(n) I/O. The
+// blocks are processed by up to n_threads threads in parallel.
+// Returns the first position of SA at which the above check fails
+// (a position repeated in SA is reported at its second occurrence)
+// or text_length if the SA is correct.
+template<typename char_type,
+  typename text_offset_type>
+std::uint64_t em_verify_sa(
+    std::uint64_t ram_use,
+    std::uint64_t n_threads,
+    std::string text_filename,
+    std::string sa_filename) {
+  std::uint64_t text_length = utils::file_size(text_filename) / sizeof(char_type);
+  std::uint64_t sa_length = utils::file_size(sa_filename) / sizeof(text_offset_type);
+  std::uint64_t io_volume = 0;
+
+  // Half of RAM is used for the arrays of blocks (one
+  // per thread) and the other half for the I/O buffers.
+  long double block_ram_per_symbol =
+    sizeof(char_type) + sizeof(text_offset_type) + 0.125L;
+  std::uint64_t ram_for_blocks = ram_use / 2;
+  std::uint64_t ram_for_buffers = ram_use - ram_for_blocks;
+
+#ifdef SAIS_DEBUG
+  std::uint64_t max_block_size = 0;
+  std::uint64_t n_blocks = 0;
+  do {
+    max_block_size = utils::random_int64(1L, std::max(1UL, text_length));
+    n_blocks = (text_length + max_block_size - 1) / max_block_size;
+  } while (n_blocks > (1UL << 8));
+  n_threads = std::max(1UL, std::min(n_threads, n_blocks));
+#else
+  std::uint64_t max_single_block_size = std::max(1UL,
+      (std::uint64_t)(ram_for_blocks / block_ram_per_symbol));
+  n_threads = std::max(1UL, std::min(n_threads,
+        (text_length + max_single_block_size - 1) / max_single_block_size));
+  std::uint64_t max_block_size = std::max(1UL, (std::uint64_t)(ram_for_blocks /
+        (n_threads * block_ram_per_symbol)));
+  std::uint64_t n_blocks = (text_length + max_block_size - 1) / max_block_size;
+#endif
+
+  // Buffers used at the same time: 8 + n_blocks when distributing
+  // SA, 12 per thread when computing keys, 4 + 2 * n_blocks when
+  // comparing keys. Readers and writers with 4 buffers of the given
+  // size are constructed with total buffer size 4 * buf_size.
+  std::uint64_t n_buffers = std::max(std::max(8 + n_blocks,
+        4 + 2 * n_blocks), 12 * n_threads);
+  std::uint64_t computed_buf_size = std::max(1UL, ram_for_buffers / n_buffers);
+
+  // Turn paths absolute.
+  text_filename = utils::absolute_path(text_filename);
+  sa_filename = utils::absolute_path(sa_filename);
+
+  // Print initial messages.
+  fprintf(stderr, "Text filename = %s\n", text_filename.c_str());
+  fprintf(stderr, "SA filename = %s\n", sa_filename.c_str());
+  fprintf(stderr, "Text length = %lu\n", text_length);
+  fprintf(stderr, "RAM use = %lu (%.2LfMiB)\n", ram_use, (1.L * ram_use) / (1L << 20));
+  fprintf(stderr, "sizeof(char_type) = %lu\n", sizeof(char_type));
+  fprintf(stderr, "sizeof(text_offset_type) = %lu\n", sizeof(text_offset_type));
+  fprintf(stderr, "Max block size = %lu\n", max_block_size);
+  fprintf(stderr, "Number of blocks = %lu\n", n_blocks);
+  fprintf(stderr, "Number of threads = %lu\n", n_threads);
+  fprintf(stderr, "Single buffer size = %lu (%.1LfMiB)\n\n", computed_buf_size,
+      (1.L * computed_buf_size) / (1L << 20));
+
+  if (sa_length != text_length) {
+    fprintf(stderr, "SA length (%lu) differs from the text length\n", sa_length);
+    return std::min(sa_length, text_length);
+  }
+  if (text_length == 0)
+    return 0;
+
+  long double start = utils::wclock();
+
+  std::vector<std::string> pairs_filenames(n_blocks);
+  std::vector<std::string> key_symbols_filenames(n_blocks);
+  std::vector<std::string> key_ranks_filenames(n_blocks);
+  for (std::uint64_t block_id = 0; block_id < n_blocks; ++block_id) {
+    pairs_filenames[block_id] = sa_filename + "tmp." + utils::random_string_hash();
+    key_symbols_filenames[block_id] = sa_filename + "tmp." + utils::random_string_hash();
+    key_ranks_filenames[block_id] = sa_filename + "tmp." + utils::random_string_hash();
+  }
+
+  // Distribute pairs (SA[i] - block_beg, i) into blocks of
+  // the text. In each block, the pairs are sorted by i. Also
+  // record ISA[block_beg] for every block, so that the blocks
+  // can be later processed independently of each other.
+  std::uint64_t first_violation = text_length;
+  std::vector<std::uint64_t> block_first_isa(n_blocks, 0UL);
+  {
+    fprintf(stderr, "  Distribute SA into text blocks: ");
+    long double distribute_start = utils::wclock();
+
+    typedef async_stream_reader<text_offset_type> sa_reader_type;
+    typedef async_multi_stream_writer<text_offset_type> pairs_writer_type;
+    sa_reader_type *sa_reader = new sa_reader_type(sa_filename, 4UL * computed_buf_size, 4UL);
+    pairs_writer_type *pairs_writer = new pairs_writer_type(n_blocks, computed_buf_size, 4UL);
+    for (std::uint64_t block_id = 0; block_id < n_blocks; ++block_id)
+      pairs_writer->add_file(pairs_filenames[block_id]);
+
+    for (std::uint64_t i = 0; i < text_length; ++i) {
+      std::uint64_t pos = sa_reader->read();
+      if (pos >= text_length) {
+        fprintf(stderr, "\n  SA[%lu] = %lu is not a text position", i, pos);
+        first_violation = i;
+        break;
+      }
+      std::uint64_t block_id = pos / max_block_size;
+      std::uint64_t block_offset = pos - block_id * max_block_size;
+      if (block_offset == 0)
+        block_first_isa[block_id] = i;
+      pairs_writer->write_to_ith_file(block_id, block_offset);
+      pairs_writer->write_to_ith_file(block_id, i);
+    }
+
+    // Stop the I/O thread.
+    sa_reader->stop_reading();
+
+    // Update I/O volume.
+    io_volume +=
+      sa_reader->bytes_read() +
+      pairs_writer->bytes_written();
+
+    // Clean up.
+    delete pairs_writer;
+    delete sa_reader;
+
+    long double distribute_time = utils::wclock() - distribute_start;
+    fprintf(stderr, "time = %.2Lfs, I/O = %.2LfMiB/s\n", distribute_time,
+        (1.L * io_volume / (1L << 20)) / distribute_time);
+  }
+
+  // Compute keys of suffixes in all blocks in parallel. Each
+  // thread reports the first violation found in its blocks.
+  if (first_violation == text_length) {
+    fprintf(stderr, "  Compute keys: ");
+    long double keys_start = utils::wclock();
+
+    std::vector<std::uint64_t> thread_first_violation(n_threads, text_length);
+    std::vector<std::uint64_t> thread_io_volume(n_threads, 0UL);
+    bool *thread_is_incomplete = new bool[n_threads];
+    std::thread **threads = new std::thread*[n_threads];
+    for (std::uint64_t t = 0; t < n_threads; ++t) {
+      thread_is_incomplete[t] = false;
+      threads[t] = new std::thread(verify_sa_compute_keys<char_type, text_offset_type>,
+          t, n_threads, text_length, max_block_size, computed_buf_size, text_filename,
+          std::ref(pairs_filenames), std::ref(key_symbols_filenames),
+          std::ref(key_ranks_filenames), std::ref(block_first_isa),
+          &thread_first_violation[t], &thread_is_incomplete[t], &thread_io_volume[t]);
+    }
+
+    std::uint64_t keys_io_volume = 0;
+    bool is_incomplete = false;
+    for (std::uint64_t t = 0; t < n_threads; ++t) {
+      threads[t]->join();
+      delete threads[t];
+      first_violation = std::min(first_violation, thread_first_violation[t]);
+      is_incomplete |= thread_is_incomplete[t];
+      keys_io_volume += thread_io_volume[t];
+    }
+    delete[] threads;
+    delete[] thread_is_incomplete;
+
+    if (is_incomplete && first_violation == text_length) {
+      fprintf(stderr, "\nError: incomplete text block but no repeated SA entry\n");
+      std::exit(EXIT_FAILURE);
+    }
+
+    io_volume += keys_io_volume;
+    long double keys_time = utils::wclock() - keys_start;
+    fprintf(stderr, "time = %.2Lfs, I/O = %.2LfMiB/s\n", keys_time,
+        (1.L * keys_io_volume / (1L << 20)) / keys_time);
+    if (first_violation != text_length)
+      fprintf(stderr, "  SA[%lu] occurs earlier in SA\n", first_violation);
+  } else {
+    for (std::uint64_t block_id = 0; block_id < n_blocks; ++block_id)
+      utils::file_delete(pairs_filenames[block_id]);
+  }
+
+  // Scan SA and compare keys of adjacent suffixes.
+  if (first_violation == text_length) {
+    fprintf(stderr, "  Compare keys: ");
+    long double compare_start = utils::wclock();
+
+    typedef async_stream_reader<text_offset_type> sa_reader_type;
+    typedef async_multi_stream_reader<char_type> key_symbols_reader_type;
+    typedef async_multi_stream_reader<text_offset_type> key_ranks_reader_type;
+    sa_reader_type *sa_reader = new sa_reader_type(sa_filename, 4UL * computed_buf_size, 4UL);
+    key_symbols_reader_type *key_symbols_reader = new key_symbols_reader_type(n_blocks, computed_buf_size);
+    key_ranks_reader_type *key_ranks_reader = new key_ranks_reader_type(n_blocks, computed_buf_size);
+    for (std::uint64_t block_id = 0; block_id < n_blocks; ++block_id) {
+      key_symbols_reader->add_file(key_symbols_filenames[block_id]);
+      key_ranks_reader->add_file(key_ranks_filenames[block_id]);
+    }
+
+    std::uint64_t prev_symbol = 0;
+    std::uint64_t prev_rank = 0;
+    for (std::uint64_t i = 0; i < text_length; ++i) {
+      std::uint64_t pos = sa_reader->read();
+      std::uint64_t block_id = pos / max_block_size;
+      std::uint64_t symbol = key_symbols_reader->read_from_ith_file(block_id);
+      std::uint64_t rank = key_ranks_reader->read_from_ith_file(block_id);
+      if (i > 0 && (symbol < prev_symbol ||
+            (symbol == prev_symbol && rank <= prev_rank))) {
+        first_violation = i;
+        break;
+      }
+      prev_symbol = symbol;
+      prev_rank = rank;
+    }
+
+    // Stop the I/O threads.
+    sa_reader->stop_reading();
+    key_symbols_reader->stop_reading();
+    key_ranks_reader->stop_reading();
+
+    // Update I/O volume.
+    std::uint64_t compare_io_volume =
+      sa_reader->bytes_read() +
+      key_symbols_reader->bytes_read() +
+      key_ranks_reader->bytes_read();
+    io_volume += compare_io_volume;
+
+    // Clean up.
+    delete key_ranks_reader;
+    delete key_symbols_reader;
+    delete sa_reader;
+
+    long double compare_time = utils::wclock() - compare_start;
+    fprintf(stderr, "time = %.2Lfs, I/O = %.2LfMiB/s\n", compare_time,
+        (1.L * compare_io_volume / (1L << 20)) / compare_time);
+    if (first_violation != text_length)
+      fprintf(stderr, "  Suffixes SA[%lu] and SA[%lu] are not in "
+          "lexicographic order\n", first_violation - 1, first_violation);
+  }
+
+  for (std::uint64_t block_id = 0; block_id < n_blocks; ++block_id) {
+    if (utils::file_exists(key_symbols_filenames[block_id]))
+      utils::file_delete(key_symbols_filenames[block_id]);
+    if (utils::file_exists(key_ranks_filenames[block_id]))
+      utils::file_delete(key_ranks_filenames[block_id]);
+  }
+
+  // Print summary.
+  long double total_time = utils::wclock() - start;
+  fprintf(stderr, "\nVerification finished. Summary:\n");
+  fprintf(stderr, "  Absolute time = %.2Lfs\n", total_time);
+  fprintf(stderr, "  Relative time = %.2Lfus/symbol\n",
+      (1000000.L * total_time) / text_length);
+  fprintf(stderr, "  I/O volume = %lu bytes (%.2Lf bytes/symbol)\n",
+      io_volume, (1.L * io_volume) / text_length);
+  fprintf(stderr, "  RAM allocation: cur = %lu bytes, peak = %.2LfMiB\n",
+      utils::get_current_ram_allocation(),
+      (1.L * utils::get_peak_ram_allocation()) / (1UL << 20));
+
+  return first_violation;
+}
+
+}  // namespace fsais_private
+
+#endif  // __FSAIS_SRC_EM_VERIFY_SA_HPP_INCLUDED
@@ -0,0 +1,369 @@
+/**
+ * @file    fsais_src/hardware_profile.hpp
+ * @section LICENCE
+ *
+ * This file is part of fSAIS v0.1.0
+ * See: https://github.com/dominikkempa/fsais
+ *
+ * Copyright (C) 2016-2020
+ *   Dominik Kempa <dominik.kempa (at) gmail.com>
+ *   Juha Karkkainen <juha.karkkainen (at) cs.helsinki.fi>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ **/
+
+#ifndef __FSAIS_SRC_HARDWARE_PROFILE_HPP_INCLUDED
+#define __FSAIS_SRC_HARDWARE_PROFILE_HPP_INCLUDED
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <unistd.h>
+
+#include "radix_heap.hpp"
+#include "utils.hpp"
+
+
+namespace fsais_private {
+
+// Measured performance of the disk and of the CPU, used to choose
+// the size of I/O requests (stream buffers and queues of the EM
+// radix heap) and the split of RAM between the buffers and the
+// radix heap. The profile is measured by calibrate() and stored
+// in a text file containing one "key value" line per measurement.
+// If no profile is loaded, the fixed choices are used.
+class hardware_profile {
+  private:
+    static const std::uint64_t k_default_request_size = (1UL << 20);
+    static const std::uint64_t k_min_request_size = (1UL << 12);
+    static const std::uint64_t k_max_request_size = (1UL << 24);
+    static const std::uint64_t k_io_queues = 8;
+#ifdef SAIS_DEBUG
+    static const std::uint64_t k_calibration_file_size = (1UL << 26);
+    static const std::uint64_t k_calibration_heap_items = (1UL << 16);
+#else
+    static const std::uint64_t k_calibration_file_size = (1UL << 30);
+    static const std::uint64_t k_calibration_heap_items = (1UL << 22);
+#endif
+
+    bool m_loaded;
+    std::uint64_t m_opt_request_size;
+
+    // Bandwidths and throughput in bytes per second. The core
+    // throughput is the rate of items passing through the in-RAM
+    // radix heap, the main CPU cost of inducing.
+    long double m_seq_read_bandwidth;
+    long double m_seq_write_bandwidth;
+    long double m_core_throughput;
+    std::vector<std::uint64_t> m_request_sizes;
+    std::vector<long double> m_random_read_bandwidth;
+
+    hardware_profile()
+      : m_loaded(false),
+        m_opt_request_size(k_default_request_size),
+        m_seq_read_bandwidth(0),
+        m_seq_write_bandwidth(0),
+        m_core_throughput(0) {}
+
+    static hardware_profile &instance() {
+      static hardware_profile profile;
+      return profile;
+    }
+
+    // The optimal request size is the smallest one reaching
+    // 90% of the best bandwidth of reads at random offsets.
+    void compute_opt_request_size() {
+      long double best_bandwidth = 0;
+      for (std::uint64_t i = 0; i < m_request_sizes.size(); ++i)
+        best_bandwidth = std::max(best_bandwidth, m_random_read_bandwidth[i]);
+      m_opt_request_size = m_request_sizes.back();
+      for (std::uint64_t i = m_request_sizes.size(); i > 0; --i)
+        if (m_random_read_bandwidth[i - 1] >= 0.9L * best_bandwidth)
+          m_opt_request_size = m_request_sizes[i - 1];
+    }
+
+    // Predicted time (in seconds per byte) of reading with requests
+    // of given size at random offsets, interpolated linearly in the
+    // logarithm of size between the measured sizes. Below the
+    // smallest measured size, the time per request is constant.
+    long double io_time_per_byte(std::uint64_t request_size) const {
+      request_size = std::max(1UL, request_size);
+      if (request_size <= m_request_sizes[0])
+        return (m_request_sizes[0] / (long double)request_size) /
+          m_random_read_bandwidth[0];
+      std::uint64_t i = 1;
+      while (i < m_request_sizes.size() && m_request_sizes[i] < request_size)
+        ++i;
+      if (i == m_request_sizes.size())
+        return 1.L / m_random_read_bandwidth.back();
+      long double t_lo = 1.L / m_random_read_bandwidth[i - 1];
+      long double t_hi = 1.L / m_random_read_bandwidth[i];
+      long double x = (std::log2((long double)request_size) -
+          std::log2((long double)m_request_sizes[i - 1])) /
+        (std::log2((long double)m_request_sizes[i]) -
+         std::log2((long double)m_request_sizes[i - 1]));
+      return t_lo + (t_hi - t_lo) * x;
+    }
+
+    // Predicted time (in seconds per byte) of the computation using
+    // stream buffers of size buf_size and the EM radix heap whose
+    // RAM queues have size heap_queue_size. The I/O is asynchronous,
+    // so the time of each is bounded from below by the CPU time.
+    long double predicted_time_per_byte(std::uint64_t buf_size,
+        std::uint64_t heap_queue_size) const {
+      long double cpu_time = 1.L / m_core_throughput;
+      return std::max(io_time_per_byte(buf_size), cpu_time) +
+        std::max(io_time_per_byte(heap_queue_size), cpu_time);
+    }
+
+    void print() const {
+      fprintf(stderr, "  Sequential read bandwidth = %.1LfMiB/s\n",
+          m_seq_read_bandwidth / (1L << 20));
+      fprintf(stderr, "  Sequential write bandwidth = %.1LfMiB/s\n",
+          m_seq_write_bandwidth / (1L << 20));
+      for (std::uint64_t i = 0; i < m_request_sizes.size(); ++i)
+        fprintf(stderr, "  Random read bandwidth (%lu-byte requests) = %.1LfMiB/s\n",
+            m_request_sizes[i], m_random_read_bandwidth[i] / (1L << 20));
+      fprintf(stderr, "  Core throughput = %.1LfMiB/s\n",
+          m_core_throughput / (1L << 20));
+      fprintf(stderr, "  Optimal I/O request size = %lu\n", m_opt_request_size);
+    }
+
+  public:
+
+    // Measure the performance of the disk containing the file
+    // profile_filename (using a temporary file) and of the CPU,
+    // and save the resulting profile to profile_filename.
+    static void calibrate(std::string profile_filename) {
+      hardware_profile &p = instance();
+      std::string filename = profile_filename + ".tmp." + utils::random_string_hash();
+      std::uint64_t file_size = k_calibration_file_size;
+      std::uint64_t buf_size = k_max_request_size;
+      std::uint8_t *buf = utils::allocate_array<std::uint8_t>(buf_size);
+      utils::fill_random_string(buf, buf_size, 256);
+      fprintf(stderr, "Calibration:\n");
+
+      // Sequential write. The page cache is flushed to
+      // the disk before stopping the timer.
+      {
+        long double start = utils::wclock();
+        std::FILE *f = utils::file_open_nobuf(filename, "w");
+        for (std::uint64_t i = 0; i < file_size; i += buf_size)
+          utils::write_to_file(buf, buf_size, f);
+        fsync(fileno(f));
+        std::fclose(f);
+        p.m_seq_write_bandwidth = file_size / (utils::wclock() - start);
+      }
+
+      // Sequential read.
+      {
+        utils::empty_page_cache(filename);
+        long double start = utils::wclock();
+        std::FILE *f = utils::file_open_nobuf(filename, "r");
+        for (std::uint64_t i = 0; i < file_size; i += buf_size)
+          utils::read_from_file(buf, buf_size, f);
+        std::fclose(f);
+        p.m_seq_read_bandwidth = file_size / (utils::wclock() - start);
+      }
+
+      // Reads at random offsets (aligned to the request size), as
+      // done when refilling buffers of many interleaved streams. For
+      // each request size, stop after a second (but at least 16
+      // requests) or after reading the volume of the file.
+      p.m_request_sizes.clear();
+      p.m_random_read_bandwidth.clear();
+      for (std::uint64_t request_size = k_min_request_size;
+          request_size <= k_max_request_size; request_size <<= 2) {
+        utils::empty_page_cache(filename);
+        std::uint64_t n_slots = file_size / request_size;
+        std::uint64_t bytes_read = 0;
+        long double start = utils::wclock();
+        long double elapsed = 0;
+        std::FILE *f = utils::file_open_nobuf(filename, "r");
+        for (std::uint64_t i = 0; i < n_slots; ++i) {
+          std::uint64_t offset = utils::random_int64(0L, n_slots - 1) * request_size;
+          utils::read_at_offset(buf, offset, request_size, f);
+          bytes_read += request_size;
+          elapsed = utils::wclock() - start;
+          if (i >= 16 && elapsed > 1.L)
+            break;
+        }
+        std::fclose(f);
+        p.m_request_sizes.push_back(request_size);
+        p.m_random_read_bandwidth.push_back(bytes_read / std::max(elapsed, 1e-9L));
+      }
+      utils::deallocate(buf);
+      utils::file_delete(filename);
+
+      // Core throughput.
+      {
+        typedef radix_heap<std::uint32_t, std::uint32_t> heap_type;
+        std::uint64_t n_items = k_calibration_heap_items;
+        std::vector<std::uint64_t> radix_logs =
+          utils::radix_logs_for_keys(1UL << 24, 10UL);
+        std::vector<std::uint32_t> keys(n_items);
+        for (std::uint64_t i = 0; i < n_items; ++i)
+          keys[i] = utils::random_int64(0L, (1L << 24) - 1);
+        heap_type *heap = new heap_type(radix_logs, n_items);
+        long double start = utils::wclock();
+        for (std::uint64_t i = 0; i < n_items; ++i)
+          heap->push(keys[i], i);
+        std::uint64_t checksum = 0;
+        while (!heap->empty()) {
+          checksum += heap->extract_min().second;
+        }
+        long double elapsed = std::max(utils::wclock() - start, 1e-9L);
+        delete heap;
+        if (checksum != n_items * (n_items - 1) / 2) {
+          fprintf(stderr, "\nError: radix heap check failed during calibration\n");
+          std::exit(EXIT_FAILURE);
+        }
+        p.m_core_throughput = (n_items * 2UL * sizeof(std::uint32_t)) / elapsed;
+      }
+
+      p.m_loaded = true;
+      p.compute_opt_request_size();
+      p.print();
+      save(profile_filename);
+    }
+
+    static void save(std::string filename) {
+      const hardware_profile &p = instance();
+      std::FILE *f = utils::file_open(filename, "w");
+      fprintf(f, "seq_read_bandwidth %.1Lf\n", p.m_seq_read_bandwidth);
+      fprintf(f, "seq_write_bandwidth %.1Lf\n", p.m_seq_write_bandwidth);
+      fprintf(f, "core_throughput %.1Lf\n", p.m_core_throughput);
+      for (std::uint64_t i = 0; i < p.m_request_sizes.size(); ++i)
+        fprintf(f, "random_read_bandwidth %lu %.1Lf\n",
+            p.m_request_sizes[i], p.m_random_read_bandwidth[i]);
+      std::fclose(f);
+    }
+
+    static void load(std::string filename) {
+      hardware_profile &p = instance();
+      p.m_request_sizes.clear();
+      p.m_random_read_bandwidth.clear();
+      p.m_seq_read_bandwidth = 0;
+      p.m_seq_write_bandwidth = 0;
+      p.m_core_throughput = 0;
+      std::FILE *f = utils::file_open(filename, "r");
+      char key[64];
+      bool ok = true;
+      while (ok && std::fscanf(f, "%63s", key) == 1) {
+        std::string k(key);
+        if (k == "seq_read_bandwidth")
+          ok = (std::fscanf(f, "%Lf", &p.m_seq_read_bandwidth) == 1);
+        else if (k == "seq_write_bandwidth")
+          ok = (std::fscanf(f, "%Lf", &p.m_seq_write_bandwidth) == 1);
+        else if (k == "core_throughput")
+          ok = (std::fscanf(f, "%Lf", &p.m_core_throughput) == 1);
+        else if (k == "random_read_bandwidth") {
+          std::uint64_t request_size = 0;
+          long double bandwidth = 0;
+          ok = (std::fscanf(f, "%lu %Lf", &request_size, &bandwidth) == 2) &&
+            request_size > 0 && bandwidth > 0 && (p.m_request_sizes.empty() ||
+                p.m_request_sizes.back() < request_size);
+          p.m_request_sizes.push_back(request_size);
+          p.m_random_read_bandwidth.push_back(bandwidth);
+        } else ok = false;
+      }
+      std::fclose(f);
+      if (!ok || p.m_request_sizes.empty() || p.m_core_throughput <= 0) {
+        fprintf(stderr, "\nError: invalid hardware profile (%s)\n", filename.c_str());
+        std::exit(EXIT_FAILURE);
+      }
+      p.m_loaded = true;
+      p.compute_opt_request_size();
+    }
+
+    // Size of stream buffers and RAM queues of EM priority
+    // queues above which the I/O throughput does not improve.
+    static std::uint64_t opt_request_size() {
+      return instance().m_opt_request_size;
+    }
+
+    // Reconsider the split (computed by the caller) of RAM between
+    // n_buffers stream buffers and the EM radix heap using levels
+    // with given radix_logs, if the buffers did not get the optimal
+    // size. The candidates are the split of the caller and buffers of
+    // size opt_request_size() / 2^i (the rest goes to the radix heap,
+    // but at least 1/8 of RAM, since the model does not account for
+    // the heap I/O volume increasing with fewer RAM queues). The split
+    // of the caller is kept unless the fastest candidate is predicted
+    // to be more than 2% faster.
+    static void tune_ram_split(
+        std::uint64_t n_buffers,
+        const std::vector<std::uint64_t> &radix_logs,
+        std::uint64_t &buf_size,
+        std::uint64_t &ram_for_buffers,
+        std::uint64_t &ram_for_radix_heap) {
+      const hardware_profile &p = instance();
+      if (!p.m_loaded || buf_size >= p.m_opt_request_size)
+        return;
+
+      // The number of RAM queues needed by em_radix_heap.
+      std::uint64_t n_heap_queues = radix_logs.size() + k_io_queues;
+      for (std::uint64_t i = 0; i < radix_logs.size(); ++i)
+        n_heap_queues += (1UL << radix_logs[i]);
+
+      std::uint64_t ram_total = ram_for_buffers + ram_for_radix_heap;
+      std::vector<std::pair<std::uint64_t, std::uint64_t> > candidates;
+      candidates.push_back(std::make_pair(buf_size, ram_for_radix_heap));
+      for (std::uint64_t b = p.m_opt_request_size; b >= k_min_request_size; b /= 2)
+        if (b * n_buffers <= ram_total - ram_total / 8)
+          candidates.push_back(std::make_pair(b, ram_total - b * n_buffers));
+
+      std::vector<long double> predicted_time(candidates.size());
+      for (std::uint64_t i = 0; i < candidates.size(); ++i) {
+        std::uint64_t heap_queue_size = std::min(p.m_opt_request_size,
+            candidates[i].second / n_heap_queues);
+        predicted_time[i] = p.predicted_time_per_byte(candidates[i].first, heap_queue_size);
+      }
+      std::uint64_t best = 0;
+      for (std::uint64_t i = 1; i < candidates.size(); ++i)
+        if (predicted_time[i] < predicted_time[best])
+          best = i;
+
+      if (best > 0 && 1.02L * predicted_time[best] < predicted_time[0]) {
+        buf_size = candidates[best].first;
+        ram_for_buffers = buf_size * n_buffers;
+        ram_for_radix_heap = candidates[best].second;
+      }
+    }
+
+    // Print the profile (if loaded).
+    static void print_summary() {
+      const hardware_profile &p = instance();
+      if (p.m_loaded) {
+        fprintf(stderr, "Hardware profile:\n");
+        p.print();
+      }
+    }
+};
+
+}  // namespace fsais_private
+
+#endif  // __FSAIS_SRC_HARDWARE_PROFILE_HPP_INCLUDED
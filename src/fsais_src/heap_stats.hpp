@@ -0,0 +1,153 @@
+/**
+ * @file    fsais_src/heap_stats.hpp
+ * @section LICENCE
+ *
+ * This file is part of fSAIS v0.1.0
+ * See: https://github.com/dominikkempa/fsais
+ *
+ * Copyright (C) 2016-2020
+ *   Dominik Kempa <dominik.kempa (at) gmail.com>
+ *   Juha Karkkainen <juha.karkkainen (at) cs.helsinki.fi>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ **/
+
+#ifndef __FSAIS_SRC_HEAP_STATS_HPP_INCLUDED
+#define __FSAIS_SRC_HEAP_STATS_HPP_INCLUDED
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+
+namespace fsais_private {
+
+// Counters describing the behaviour of a single (em_)radix_heap
+// instance. The heaps only maintain them when compiled with
+// -DMONITOR_HEAP_STATS, and print them to stderr on destruction.
+class heap_stats {
+  private:
+    std::string m_heap_name;
+    std::string m_phase_name;
+
+    std::uint64_t m_size;
+    std::uint64_t m_max_size;
+    std::uint64_t m_pushes;
+    std::uint64_t m_redistributions;
+    std::uint64_t m_redistributed_items;
+    std::uint64_t m_spilled_bytes;
+    std::uint64_t m_reloaded_bytes;
+
+    // Level of every internal queue.
+    std::vector<std::uint64_t> m_queue_level;
+
+    // Per-level counters.
+    std::vector<std::uint64_t> m_level_size;
+    std::vector<std::uint64_t> m_level_max_size;
+    std::vector<std::uint64_t> m_level_items_in;
+
+  public:
+    heap_stats()
+      : m_size(0),
+        m_max_size(0),
+        m_pushes(0),
+        m_redistributions(0),
+        m_redistributed_items(0),
+        m_spilled_bytes(0),
+        m_reloaded_bytes(0) {}
+
+    // Queue i of a heap belongs to level queue_level[i].
+    void init(std::string heap_name,
+        std::vector<std::uint64_t> &queue_level) {
+      m_heap_name = heap_name;
+      m_queue_level = queue_level;
+      std::uint64_t n_levels = 0;
+      for (std::uint64_t i = 0; i < queue_level.size(); ++i)
+        n_levels = std::max(n_levels, queue_level[i] + 1);
+      m_level_size = std::vector<std::uint64_t>(n_levels, 0UL);
+      m_level_max_size = std::vector<std::uint64_t>(n_levels, 0UL);
+      m_level_items_in = std::vector<std::uint64_t>(n_levels, 0UL);
+    }
+
+    void set_phase_name(std::string phase_name) {
+      m_phase_name = phase_name;
+    }
+
+    inline void add_to_queue(std::uint64_t queue_id) {
+      std::uint64_t level = m_queue_level[queue_id];
+      ++m_level_items_in[level];
+      ++m_level_size[level];
+      m_level_max_size[level] =
+        std::max(m_level_max_size[level], m_level_size[level]);
+    }
+
+    inline void remove_from_queue(std::uint64_t queue_id) {
+      --m_level_size[m_queue_level[queue_id]];
+    }
+
+    inline void push(std::uint64_t queue_id) {
+      ++m_pushes;
+      ++m_size;
+      m_max_size = std::max(m_max_size, m_size);
+      add_to_queue(queue_id);
+    }
+
+    inline void pop(std::uint64_t queue_id) {
+      --m_size;
+      remove_from_queue(queue_id);
+    }
+
+    // Items moved during redistribution are accounted
+    // separately with remove_from_queue and add_to_queue.
+    inline void redistribute(std::uint64_t n_items) {
+      ++m_redistributions;
+      m_redistributed_items += n_items;
+    }
+
+    inline void spill(std::uint64_t bytes) {
+      m_spilled_bytes += bytes;
+    }
+
+    inline void reload(std::uint64_t bytes) {
+      m_reloaded_bytes += bytes;
+    }
+
+    void print() const {
+      fprintf(stderr, "\n%s stats (%s):\n", m_heap_name.c_str(),
+          m_phase_name.empty() ? "unnamed phase" : m_phase_name.c_str());
+      fprintf(stderr, "  pushes = %lu, max size = %lu, "
+          "redistributions = %lu, redistributed items = %lu\n",
+          m_pushes, m_max_size, m_redistributions, m_redistributed_items);
+      if (m_spilled_bytes > 0 || m_reloaded_bytes > 0)
+        fprintf(stderr, "  spilled = %lu bytes, reloaded = %lu bytes\n",
+            m_spilled_bytes, m_reloaded_bytes);
+      for (std::uint64_t i = 0; i < m_level_size.size(); ++i)
+        fprintf(stderr, "  level %lu: items in = %lu, max occupancy = %lu\n",
+            i, m_level_items_in[i], m_level_max_size[i]);
+    }
+};
+
+}  // namespace fsais_private
+
+#endif  // __FSAIS_SRC_HEAP_STATS_HPP_INCLUDED
@@ -0,0 +1,206 @@
+/**
+ * @file    fsais_src/im_compute_types.hpp
+ * @section LICENCE
+ *
+ * This file is part of fSAIS v0.1.0
+ * See: https://github.com/dominikkempa/fsais
+ *
+ * Copyright (C) 2016-2020
+ *   Dominik Kempa <dominik.kempa (at) gmail.com>
+ *   Juha Karkkainen <juha.karkkainen (at) cs.helsinki.fi>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ **/
+
+#ifndef __FSAIS_SRC_IM_COMPUTE_TYPES_HPP_INCLUDED
+#define __FSAIS_SRC_IM_COMPUTE_TYPES_HPP_INCLUDED
+
+#include <cstdint>
+#include <algorithm>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+
+namespace fsais_private {
+
+// Compute masks eq and gt such that for j in [0..64), bit j of eq
+// (gt) is set iff c[j] == c[j + 1] (c[j] > c[j + 1]). Requires
+// c[0..64] to be accessible. Vectorized (AVX2) for 1, 2 and 4-byte
+// symbols, other symbol types are compared one pair at a time.
+template<typename char_type>
+struct type_compare_masks {
+  static inline void compute(const char_type *c,
+      std::uint64_t &eq, std::uint64_t &gt) {
+    eq = 0;
+    gt = 0;
+    for (std::uint64_t j = 0; j < 64; ++j) {
+      std::uint64_t a = (std::uint64_t)c[j];
+      std::uint64_t b = (std::uint64_t)c[j + 1];
+      eq |= (std::uint64_t)(a == b) << j;
+      gt |= (std::uint64_t)(a > b) << j;
+    }
+  }
+};
+
+#ifdef __AVX2__
+template<>
+struct type_compare_masks<std::uint8_t> {
+  static inline void compute(const std::uint8_t *c,
+      std::uint64_t &eq, std::uint64_t &gt) {
+    std::uint64_t le = 0;
+    eq = 0;
+    for (std::uint64_t j = 0; j < 64; j += 32) {
+      __m256i a = _mm256_loadu_si256((const __m256i *)(c + j));
+      __m256i b = _mm256_loadu_si256((const __m256i *)(c + j + 1));
+      eq |= (std::uint64_t)(std::uint32_t)_mm256_movemask_epi8(
+          _mm256_cmpeq_epi8(a, b)) << j;
+      le |= (std::uint64_t)(std::uint32_t)_mm256_movemask_epi8(
+          _mm256_cmpeq_epi8(_mm256_max_epu8(a, b), b)) << j;
+    }
+    gt = ~le;
+  }
+};
+
+template<>
+struct type_compare_masks<std::uint16_t> {
+
+  // Pack two vectors of 16-bit compare results into 32 bits.
+  static inline std::uint64_t movemask(__m256i x, __m256i y) {
+    return (std::uint32_t)_mm256_movemask_epi8(_mm256_permute4x64_epi64(
+          _mm256_packs_epi16(x, y), 0xD8));
+  }
+
+  static inline void compute(const std::uint16_t *c,
+      std::uint64_t &eq, std::uint64_t &gt) {
+    std::uint64_t le = 0;
+    eq = 0;
+    for (std::uint64_t j = 0; j < 64; j += 32) {
+      __m256i a0 = _mm256_loadu_si256((const __m256i *)(c + j));
+      __m256i b0 = _mm256_loadu_si256((const __m256i *)(c + j + 1));
+      __m256i a1 = _mm256_loadu_si256((const __m256i *)(c + j + 16));
+      __m256i b1 = _mm256_loadu_si256((const __m256i *)(c + j + 17));
+      eq |= movemask(_mm256_cmpeq_epi16(a0, b0),
+          _mm256_cmpeq_epi16(a1, b1)) << j;
+      le |= movemask(_mm256_cmpeq_epi16(_mm256_max_epu16(a0, b0), b0),
+          _mm256_cmpeq_epi16(_mm256_max_epu16(a1, b1), b1)) << j;
+    }
+    gt = ~le;
+  }
+};
+
+template<>
+struct type_compare_masks<std::uint32_t> {
+  static inline void compute(const std::uint32_t *c,
+      std::uint64_t &eq, std::uint64_t &gt) {
+    std::uint64_t le = 0;
+    eq = 0;
+    for (std::uint64_t j = 0; j < 64; j += 8) {
+      __m256i a = _mm256_loadu_si256((const __m256i *)(c + j));
+      __m256i b = _mm256_loadu_si256((const __m256i *)(c + j + 1));
+      eq |= (std::uint64_t)_mm256_movemask_ps(
+          _mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b))) << j;
+      le |= (std::uint64_t)_mm256_movemask_ps(_mm256_castsi256_ps(
+            _mm256_cmpeq_epi32(_mm256_max_epu32(a, b), b))) << j;
+    }
+    gt = ~le;
+  }
+};
+#endif  // __AVX2__
+
+// Compute the bitvector type_bv storing whether each position
+// i in [0..total_block_size) of the block (followed by the next
+// block, accessed via text_accessor) is of minus type (bit i set)
+// or not. The type of the last position is is_last_minus.
+//
+// Positions are processed 64 at a time, right to left. In each word,
+// the positions whose symbol differs from the next one get their
+// type from gt, and the types are then copied (bit-parallel, in
+// log(64) steps) into the runs of equal symbols from the first
+// position to their right with a different symbol or, if the run
+// reaches the end of the word, from the next word.
+template<typename char_type,
+  typename text_accessor_type>
+void im_compute_types(
+    const char_type *block,
+    std::uint64_t block_beg,
+    std::uint64_t block_size,
+    std::uint64_t next_block_size,
+    bool is_last_minus,
+    text_accessor_type *text_accessor,
+    std::uint64_t *type_bv) {
+  std::uint64_t total_block_size = block_size + next_block_size;
+  std::uint64_t bv_size = (total_block_size + 63) / 64;
+  char_type local_buf[65];
+  std::uint64_t next_word_first_type = 0;
+  for (std::uint64_t word_id = bv_size; word_id > 0; --word_id) {
+    std::uint64_t beg = (word_id - 1) * 64;
+    std::uint64_t end = std::min(beg + 64, total_block_size);
+
+    // Compare symbols at positions [beg..beg + 64) with the next ones.
+    const char_type *c = block + beg;
+    if (beg + 64 >= block_size) {
+      std::uint64_t local_end = std::min(beg + 65, total_block_size);
+      for (std::uint64_t j = beg; j < local_end; ++j)
+        local_buf[j - beg] = (j < block_size) ? block[j] :
+          (char_type)text_accessor->access(block_beg + j);
+      std::fill(local_buf + (local_end - beg), local_buf + 65, (char_type)0);
+      c = local_buf;
+    }
+    std::uint64_t eq = 0;
+    std::uint64_t gt = 0;
+    type_compare_masks<char_type>::compute(c, eq, gt);
+
+    // The last position has no next symbol.
+    if (end == total_block_size) {
+      std::uint64_t last = end - 1 - beg;
+      std::uint64_t below_last = (1UL << last) - 1;
+      eq &= below_last;
+      gt &= below_last;
+      gt |= ((std::uint64_t)is_last_minus << last);
+    }
+
+    // Copy the types into runs of equal symbols.
+    std::uint64_t types = gt & ~eq;
+    std::uint64_t run = eq;
+    for (std::uint64_t step = 1; step < 64; step <<= 1) {
+      types |= (types >> step) & run;
+      run &= (run >> step);
+    }
+    if (next_word_first_type) {
+      std::uint64_t neq = ~eq;
+      if (neq == 0) types = ~0UL;
+      else if (__builtin_clzll(neq) > 0)
+        types |= (~0UL << (64 - __builtin_clzll(neq)));
+    }
+    if (end - beg < 64)
+      types &= (1UL << (end - beg)) - 1;
+
+    type_bv[word_id - 1] = types;
+    next_word_first_type = (types & 1UL);
+  }
+}
+
+}  // namespace fsais_private
+
+#endif  // __FSAIS_SRC_IM_COMPUTE_TYPES_HPP_INCLUDED
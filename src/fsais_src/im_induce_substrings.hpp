@@ -47,9 +47,13 @@
 #include "io/async_bit_stream_writer.hpp"
 #include "io/simple_accessor.hpp"
 
+#include "im_compute_types.hpp"
+#include "induce_prefetch.hpp"
 #include "packed_pair.hpp"
 #include "radix_heap.hpp"
 #include "utils.hpp"
+#include "phase_stats.hpp"
+#include "progress_reporter.hpp"
 #include "../uint40.hpp"
 #include "../uint48.hpp"
 
@@ -102,6 +106,8 @@ im_induce_substrings_large_alphabet(
     std::uint64_t max_part_size,
     bool is_last_minus,
     std::string text_filename,
+    std::vector<std::uint64_t> &radix_logs,
+    typename radix_heap<char_type, ext_block_offset_type>::arena_type *arena,
     std::string output_plus_symbols_filename,
     std::string output_plus_type_filename,
     std::string output_minus_pos_filename,
@@ -206,24 +212,8 @@ im_induce_substrings_large_alphabet(
   // position is a minus position (true) or not (false).
   std::uint64_t bv_size = (total_block_size + 63) / 64;
   std::uint64_t *type_bv = utils::allocate_array<std::uint64_t>(bv_size);
-  std::fill(type_bv, type_bv + bv_size, 0UL);
-  {
-    if (is_last_minus) {
-      std::uint64_t i = total_block_size - 1;
-      type_bv[i >> 6] |= (1UL << (i & 63));
-    }
-    bool is_next_minus = is_last_minus;
-    std::uint64_t next_char = (next_block_size == 0) ? block[block_size - 1] : text_accessor->access(block_end + next_block_size - 1);
-    for (std::uint64_t iplus = total_block_size - 1; iplus > 0; --iplus) {
-      std::uint64_t i = iplus - 1;
-      std::uint64_t head_char = (i < block_size) ? block[i] : text_accessor->access(block_beg + i);
-      bool is_minus = (head_char == next_char) ? is_next_minus : (head_char > next_char);
-      if (is_minus)
-        type_bv[i >> 6] |= (1UL << (i & 63));
-      is_next_minus = is_minus;
-      next_char = head_char;
-    }
-  }
+  im_compute_types<char_type>(block, block_beg, block_size,
+      next_block_size, is_last_minus, text_accessor, type_bv);
 
 
 
@@ -257,19 +247,11 @@ im_induce_substrings_large_alphabet(
 
 
 
-  std::uint64_t max_char = (std::uint64_t)std::numeric_limits<char_type>::max();
-  std::vector<std::uint64_t> radix_logs;
-  {
-    std::uint64_t target_sum = 8UL * sizeof(char_type);
-    std::uint64_t cur_sum = 0;
-    while (cur_sum < target_sum) {
-      std::uint64_t radix_log = std::min(8UL, target_sum - cur_sum);
-      radix_logs.push_back(radix_log);
-      cur_sum += radix_log;
-    }
-  }
+  std::uint64_t max_char = text_alphabet_size - 1;
   typedef radix_heap<char_type, ext_block_offset_type> heap_type;
-  heap_type *heap = new heap_type(radix_logs, lastpos/*XXX ???*/);
+  heap_type *heap = new heap_type(radix_logs, arena);
+  heap->set_phase_name("IM induce substrings (plus), block [" +
+      utils::intToStr(block_beg) + ".." + utils::intToStr(block_end) + ")");
 
 
 
@@ -362,7 +344,9 @@ im_induce_substrings_large_alphabet(
 
 
 
-  heap_type *heap2 = new heap_type(radix_logs, lastpos/*XXX ???*/);
+  heap_type *heap2 = new heap_type(radix_logs, arena);
+  heap2->set_phase_name("IM induce substrings (minus), block [" +
+      utils::intToStr(block_beg) + ".." + utils::intToStr(block_end) + ")");
   std::reverse(vec2->begin(), vec2->end());
   for (std::uint64_t t = 0; t < vec2->size(); ++t)
     heap2->push((*vec2)[t].first, (*vec2)[t].second);
@@ -532,9 +516,13 @@ void im_induce_substrings_large_alphabet(
   std::uint64_t n_blocks = (text_length + max_block_size - 1) / max_block_size;
   std::uint64_t io_volume = 0;
 
+  // Keep the arrays and I/O threads of all blocks on one NUMA node.
+  utils::numa_thread_pin numa_pin;
+
   fprintf(stderr, "    IM induce substrings (large alphabet):\n");
   fprintf(stderr, "      sizeof(ext_block_offset_type) = %lu\n", sizeof(ext_block_offset_type));
   long double start = utils::wclock();
+  phase_stats::begin_phase("IM induce substrings (large alphabet)");
 
 #ifdef SAIS_DEBUG
   std::uint64_t max_part_size = utils::random_int64(1L, 50L);
@@ -543,8 +531,21 @@ void im_induce_substrings_large_alphabet(
   fprintf(stderr, "      Max part size = %lu (%.1LfMiB)\n", max_part_size, (1.L * max_part_size) / (1UL << 20));
 #endif
 
+  // Initialize the storage of radix heap queues. It is shared by all
+  // heaps created while processing the blocks, so that the RAM for
+  // heap queues is allocated only once. The number of items in each
+  // heap is bounded by the total size of current and next block.
+  typedef radix_heap<char_type, ext_block_offset_type> heap_type;
+  std::vector<std::uint64_t> radix_logs =
+    utils::radix_logs_for_keys(text_alphabet_size, 8UL);
+  std::uint64_t max_heap_items = std::min(text_length, 2UL * max_block_size);
+  typename heap_type::arena_type *arena =
+    new typename heap_type::arena_type(max_heap_items,
+        heap_type::queue_count(radix_logs), heap_type::default_pagesize());
+
   bool is_last_minus = true;
   std::uint64_t next_block_leftmost_minus_star = 0;
+  progress_reporter::set_items_expected(text_length);
   for (std::uint64_t block_id_plus = n_blocks; block_id_plus > 0; --block_id_plus) {
     std::uint64_t block_id = block_id_plus - 1;
     std::uint64_t block_beg = block_id * max_block_size;
@@ -562,6 +563,8 @@ void im_induce_substrings_large_alphabet(
           max_part_size,
           is_last_minus,
           text_filename,
+          radix_logs,
+          arena,
           output_plus_symbols_filenames[block_id],
           output_plus_type_filenames[block_id],
           output_minus_pos_filenames[block_id],
@@ -573,13 +576,19 @@ void im_induce_substrings_large_alphabet(
 
     next_block_leftmost_minus_star = ret.first;
     is_last_minus = ret.second;
+    progress_reporter::add_items_processed(
+        std::min(max_block_size, text_length - block_beg));
   }
 
+  // Clean up.
+  delete arena;
+
   // Update I/O volume.
   total_io_volume += io_volume;
 
   // Print summary.
   long double total_time = utils::wclock() - start;
+  phase_stats::end_phase();
   fprintf(stderr, "      Total time = %.2Lfs, I/O = %.2LfMiB/s, "
       "total I/O vol = %.1Lf bytes/symbol (of initial text)\n",
       total_time, (1.L * io_volume / (1L << 20)) / total_time,
@@ -735,30 +744,8 @@ im_induce_substrings_small_alphabet(
   // position is a minus position (true) or not (false).
   std::uint64_t bv_size = (total_block_size + 63) / 64;
   std::uint64_t *type_bv = utils::allocate_array<std::uint64_t>(bv_size);
-  std::fill(type_bv, type_bv + bv_size, 0UL);
-  {
-    if (is_last_minus) {
-      std::uint64_t i = total_block_size - 1;
-      type_bv[i >> 6] |= (1UL << (i & 63));
-    }
-    bool is_next_minus = is_last_minus;
-    std::uint64_t next_char =
-      (next_block_size == 0) ?
-      block[block_size - 1] :
-      text_accessor->access(block_end + next_block_size - 1);
-    for (std::uint64_t iplus = total_block_size - 1; iplus > 0; --iplus) {
-      std::uint64_t i = iplus - 1;
-      std::uint64_t head_char =
-        (i < block_size) ?
-        block[i] :
-        text_accessor->access(block_beg + i);
-      bool is_minus = (head_char == next_char) ? is_next_minus : (head_char > next_char);
-      if (is_minus)
-        type_bv[i >> 6] |= (1UL << (i & 63));
-      is_next_minus = is_minus;
-      next_char = head_char;
-    }
-  }
+  im_compute_types<char_type>(block, block_beg, block_size,
+      next_block_size, is_last_minus, text_accessor, type_bv);
 
 
 
@@ -983,6 +970,7 @@ im_induce_substrings_small_alphabet(
         ++local_buf_filled;
       }
       for (std::uint64_t j = 0; j < local_buf_filled; ++j) {
+        induce_prefetch::gather(local_buf, j, local_buf_filled, block, type_bv);
         std::uint64_t idx_1 = local_buf[j].m_idx_1;
         std::uint64_t idx_2 = local_buf[j].m_idx_2;
         std::uint64_t head_pos = local_buf[j].m_head_pos;
@@ -993,6 +981,8 @@ im_induce_substrings_small_alphabet(
 
       // Process buffer.
       for (std::uint64_t j = 0; j < local_buf_filled; ++j) {
+        induce_prefetch::commit(local_buf, j, local_buf_filled,
+            false, bucket_ptr, buckets);
         std::uint64_t i = iplus + (local_buf_filled - j - 1);
         std::uint64_t head_pos = local_buf[j].m_head_pos;
         std::uint64_t prev_pos = head_pos - 1;
@@ -1199,6 +1189,7 @@ im_induce_substrings_small_alphabet(
         ++local_buf_filled;
       }
       for (std::uint64_t j = 0; j < local_buf_filled; ++j) {
+        induce_prefetch::gather(local_buf, j, local_buf_filled, block, type_bv);
         std::uint64_t idx_1 = local_buf[j].m_idx_1;
         std::uint64_t idx_2 = local_buf[j].m_idx_2;
         std::uint64_t head_pos = local_buf[j].m_head_pos;
@@ -1209,6 +1200,8 @@ im_induce_substrings_small_alphabet(
 
       // Process buffer.
       for (std::uint64_t j = 0; j < local_buf_filled; ++j) {
+        induce_prefetch::commit(local_buf, j, local_buf_filled,
+            true, bucket_ptr, buckets);
         std::uint64_t head_pos = local_buf[j].m_head_pos;
         std::uint64_t prev_pos = head_pos - 1;
         std::uint64_t prev_pos_head_char = local_buf[j].m_prev_pos_head_char;
@@ -1337,9 +1330,13 @@ void im_induce_substrings_small_alphabet(
   std::uint64_t n_blocks = (text_length + max_block_size - 1) / max_block_size;
   std::uint64_t io_volume = 0;
 
+  // Keep the arrays and I/O threads of all blocks on one NUMA node.
+  utils::numa_thread_pin numa_pin;
+
   fprintf(stderr, "    IM induce substrings (small alphabet):\n");
   fprintf(stderr, "      sizeof(ext_block_offset_type) = %lu\n", sizeof(ext_block_offset_type));
   long double start = utils::wclock();
+  phase_stats::begin_phase("IM induce substrings (small alphabet)");
 
 #ifdef SAIS_DEBUG
   std::uint64_t max_part_size = utils::random_int64(1L, 50L);
@@ -1350,6 +1347,7 @@ void im_induce_substrings_small_alphabet(
 
   bool is_last_minus = true;
   std::uint64_t next_block_leftmost_minus_star = 0;
+  progress_reporter::set_items_expected(text_length);
   for (std::uint64_t block_id_plus = n_blocks; block_id_plus > 0; --block_id_plus) {
     std::uint64_t block_id = block_id_plus - 1;
     std::uint64_t block_beg = block_id * max_block_size;
@@ -1378,6 +1376,8 @@ void im_induce_substrings_small_alphabet(
 
     next_block_leftmost_minus_star = ret.first;
     is_last_minus = ret.second;
+    progress_reporter::add_items_processed(
+        std::min(max_block_size, text_length - block_beg));
   }
 
   // Update I/O volume.
@@ -1385,6 +1385,7 @@ void im_induce_substrings_small_alphabet(
 
   // Print summary.
   long double total_time = utils::wclock() - start;
+  phase_stats::end_phase();
   fprintf(stderr, "      Total time = %.2Lfs, I/O = %.2LfMiB/s, "
       "total I/O vol = %.1Lf bytes/symbol (of initial text)\n",
       total_time, (1.L * io_volume / (1L << 20)) / total_time,
@@ -0,0 +1,108 @@
+/**
+ * @file    fsais_src/induce_prefetch.hpp
+ * @section LICENCE
+ *
+ * This file is part of fSAIS v0.1.0
+ * See: https://github.com/dominikkempa/fsais
+ *
+ * Copyright (C) 2016-2020
+ *   Dominik Kempa <dominik.kempa (at) gmail.com>
+ *   Juha Karkkainen <juha.karkkainen (at) cs.helsinki.fi>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ **/
+
+#ifndef __FSAIS_SRC_INDUCE_PREFETCH_HPP_INCLUDED
+#define __FSAIS_SRC_INDUCE_PREFETCH_HPP_INCLUDED
+
+#include <cstdint>
+
+// Number of buffered items between the prefetch of the memory
+// locations accessed by an item and the access itself. 0 disables
+// prefetching.
+#ifndef FSAIS_PREFETCH_DISTANCE
+#define FSAIS_PREFETCH_DISTANCE 16
+#endif
+
+
+namespace fsais_private {
+
+// Software prefetching for the buffered in-RAM inducing sweeps.
+// The sweeps first collect a buffer of items (head_pos, idx_1, idx_2)
+// read from the buckets, then gather the symbols and types of these
+// positions, and finally commit the items, each of which writes into
+// a random bucket. While processing the j-th item in a buffer, the
+// gather stage prefetches the text symbol and type bits of the item
+// j + distance, and the commit stage prefetches the bucket pointer of
+// the item j + 2 * distance and the bucket slot pointed to by the
+// bucket pointer of the item j + distance.
+struct induce_prefetch {
+  static const std::uint64_t k_distance = FSAIS_PREFETCH_DISTANCE;
+
+  template<typename item_type,
+    typename char_type>
+  static inline void gather(
+      const item_type *buf,
+      std::uint64_t j,
+      std::uint64_t buf_filled,
+      const char_type *block,
+      const std::uint64_t *type_bv) {
+    if (k_distance > 0 && j + k_distance < buf_filled) {
+      const item_type &item = buf[j + k_distance];
+      __builtin_prefetch(block + item.m_idx_1);
+      __builtin_prefetch(type_bv + (item.m_head_pos >> 6));
+      __builtin_prefetch(type_bv + (item.m_idx_2 >> 6));
+    }
+  }
+
+  // Only items with m_is_prev_pos_minus == is_minus_sweep are
+  // inserted into buckets by the sweep.
+  template<typename item_type,
+    typename bucket_ptr_type,
+    typename bucket_type>
+  static inline void commit(
+      const item_type *buf,
+      std::uint64_t j,
+      std::uint64_t buf_filled,
+      bool is_minus_sweep,
+      const bucket_ptr_type *bucket_ptr,
+      const bucket_type *buckets) {
+    if (k_distance == 0)
+      return;
+    if (j + 2 * k_distance < buf_filled) {
+      const item_type &item = buf[j + 2 * k_distance];
+      if (item.m_is_prev_pos_minus == is_minus_sweep)
+        __builtin_prefetch(bucket_ptr + item.m_prev_pos_head_char, 1);
+    }
+    if (j + k_distance < buf_filled) {
+      const item_type &item = buf[j + k_distance];
+      if (item.m_is_prev_pos_minus == is_minus_sweep) {
+        std::uint64_t ptr = bucket_ptr[item.m_prev_pos_head_char];
+        __builtin_prefetch(buckets + ptr, 1);
+      }
+    }
+  }
+};
+
+}  // namespace fsais_private
+
+#endif  // __FSAIS_SRC_INDUCE_PREFETCH_HPP_INCLUDED
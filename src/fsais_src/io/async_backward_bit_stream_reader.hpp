@@ -86,6 +86,10 @@ class async_backward_bit_stream_reader {
       return m_internal_reader->bytes_read();
     }
 
+    inline const stream_wait_stats &wait_stats() const {
+      return m_internal_reader->wait_stats();
+    }
+
     ~async_backward_bit_stream_reader() {
       delete m_internal_reader;
     }
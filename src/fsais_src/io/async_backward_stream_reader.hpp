@@ -44,6 +44,8 @@
 #include <condition_variable>
 
 #include "../utils.hpp"
+#include "../packed_int_conversion.hpp"
+#include "stream_wait_stats.hpp"
 
 
 namespace fsais_private {
@@ -227,9 +229,11 @@ class async_backward_stream_reader {
 
         // Wait for an empty buffer (or a stop signal).
         std::unique_lock<std::mutex> lk(caller->m_empty_buffers->m_mutex);
+        long double wait_start = utils::wclock();
         while (caller->m_empty_buffers->empty() &&
             !(caller->m_empty_buffers->m_signal_stop))
           caller->m_empty_buffers->m_cv.wait(lk);
+        caller->m_wait_stats.add_io_thread_wait(utils::wclock() - wait_start);
 
         if (caller->m_empty_buffers->empty()) {
 
@@ -244,6 +248,7 @@ class async_backward_stream_reader {
 
         // Read the data from disk.
         buffer->read_from_file(caller->m_file);
+        caller->m_wait_stats.add_request(buffer->size_in_bytes());
         if (buffer->empty()) {
 
           // If we reached the end of file,
@@ -278,8 +283,10 @@ class async_backward_stream_reader {
 
       // Extract a filled buffer.
       std::unique_lock<std::mutex> lk(m_full_buffers->m_mutex);
+      long double wait_start = utils::wclock();
       while (m_full_buffers->empty() && !(m_full_buffers->m_signal_stop))
         m_full_buffers->m_cv.wait(lk);
+      m_wait_stats.add_consumer_wait(utils::wclock() - wait_start);
       if (m_full_buffers->empty()) {
         lk.unlock();
         m_cur_buffer_filled = 0;
@@ -300,6 +307,7 @@ class async_backward_stream_reader {
     value_type *m_mem;
     buffer_type *m_cur_buffer;
     std::thread *m_io_thread;
+    stream_wait_stats m_wait_stats;
 
   public:
 
@@ -388,6 +396,22 @@ class async_backward_stream_reader {
       }
     }
 
+    // Read 'howmany' items converted to std::uint64_t into 'dest'.
+    void read_unpacked(std::uint64_t *dest, std::uint64_t howmany) {
+      while (howmany > 0) {
+        if (m_cur_buffer_pos == 0)
+          receive_new_buffer();
+
+        std::uint64_t cur_buf_left = m_cur_buffer_pos;
+        std::uint64_t tocopy = std::min(howmany, cur_buf_left);
+        unpack_ints(m_cur_buffer->m_content + m_cur_buffer_pos - tocopy, dest, tocopy);
+        std::reverse(dest, dest + tocopy);
+        m_cur_buffer_pos -= tocopy;
+        dest += tocopy;
+        howmany -= tocopy;
+      }
+    }
+
     // Return the next item in the stream.
     inline value_type peek() {
       if (m_cur_buffer_pos == 0)
@@ -416,6 +440,12 @@ class async_backward_stream_reader {
       return m_bytes_read;
     }
 
+    // Time spent waiting on both sides of the stream
+    // (valid after the I/O thread has been stopped).
+    inline const stream_wait_stats &wait_stats() const {
+      return m_wait_stats;
+    }
+
     // Stop the I/O thread, now the user can
     // cafely call the bytes_read() method.
     void stop_reading() {
@@ -44,6 +44,7 @@
 #include <condition_variable>
 
 #include "../utils.hpp"
+#include "stream_wait_stats.hpp"
 
 
 namespace fsais_private {
@@ -229,9 +230,11 @@ class async_backward_stream_reader_multipart {
 
         // Wait for an empty buffer (or a stop signal).
         std::unique_lock<std::mutex> lk(caller->m_empty_buffers->m_mutex);
+        long double wait_start = utils::wclock();
         while (caller->m_empty_buffers->empty() &&
             !(caller->m_empty_buffers->m_signal_stop))
           caller->m_empty_buffers->m_cv.wait(lk);
+        caller->m_wait_stats.add_io_thread_wait(utils::wclock() - wait_start);
 
         if (caller->m_empty_buffers->empty()) {
 
@@ -251,6 +254,7 @@ class async_backward_stream_reader_multipart {
         }
 
         bool no_more_data = buffer->read_from_file(caller->m_file);
+        caller->m_wait_stats.add_request(buffer->size_in_bytes());
         if (buffer->empty()) {
 
           // Here we assume that any multipart writer produces
@@ -293,8 +297,10 @@ class async_backward_stream_reader_multipart {
 
       // Extract a filled buffer.
       std::unique_lock<std::mutex> lk(m_full_buffers->m_mutex);
+      long double wait_start = utils::wclock();
       while (m_full_buffers->empty() && !(m_full_buffers->m_signal_stop))
         m_full_buffers->m_cv.wait(lk);
+      m_wait_stats.add_consumer_wait(utils::wclock() - wait_start);
       if (!m_full_buffers->empty()) {
         m_cur_buffer = m_full_buffers->pop();
         m_cur_buffer_left = m_cur_buffer->m_filled;
@@ -313,6 +319,7 @@ class async_backward_stream_reader_multipart {
     value_type *m_mem;
     buffer_type *m_cur_buffer;
     std::thread *m_io_thread;
+    stream_wait_stats m_wait_stats;
 
   public:
     async_backward_stream_reader_multipart(std::string filename,
@@ -375,6 +382,12 @@ class async_backward_stream_reader_multipart {
       return m_bytes_read;
     }
 
+    // Time spent waiting on both sides of the stream
+    // (valid after the I/O thread has been stopped).
+    inline const stream_wait_stats &wait_stats() const {
+      return m_wait_stats;
+    }
+
     // Stop the I/O thread, now the user can
     // cafely call the bytes_read() method.
     void stop_reading() {
@@ -0,0 +1,139 @@
+/**
+ * @file    fsais_src/io/async_bit_packed_stream_reader.hpp
+ * @section LICENCE
+ *
+ * This file is part of fSAIS v0.1.0
+ * See: https://github.com/dominikkempa/fsais
+ *
+ * Copyright (C) 2016-2020
+ *   Dominik Kempa <dominik.kempa (at) gmail.com>
+ *   Juha Karkkainen <juha.karkkainen (at) cs.helsinki.fi>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ **/
+
+#ifndef __FSAIS_SRC_IO_ASYNC_BIT_PACKED_STREAM_READER_HPP_INCLUDED
+#define __FSAIS_SRC_IO_ASYNC_BIT_PACKED_STREAM_READER_HPP_INCLUDED
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <string>
+
+#include "async_stream_reader.hpp"
+#include "async_bit_packed_stream_writer.hpp"
+
+
+namespace fsais_private {
+
+// Reads the integers written by async_bit_packed_stream_writer,
+// e.g., the suffix array written by fSAIS with the --packed flag:
+//
+//   async_bit_packed_stream_reader *reader =
+//     new async_bit_packed_stream_reader(filename);
+//   for (std::uint64_t i = 0; i < reader->size(); ++i)
+//     std::uint64_t sa_i = reader->read();
+//   delete reader;
+//
+class async_bit_packed_stream_reader {
+  private:
+    typedef async_stream_reader<std::uint64_t> word_reader_type;
+    word_reader_type *m_word_reader;
+
+    std::uint64_t m_bits_per_item;
+    std::uint64_t m_n_items;
+    std::uint64_t m_mask;
+    std::uint64_t m_word;
+    std::uint64_t m_word_avail;
+
+    void init(std::string filename,
+        std::uint64_t total_buf_size_bytes,
+        std::uint64_t n_buffers) {
+      if (utils::file_size(filename) < async_bit_packed_stream_writer::k_header_size) {
+        fprintf(stderr, "\nError: %s is not a bit-packed file\n", filename.c_str());
+        std::exit(EXIT_FAILURE);
+      }
+      m_word_reader = new word_reader_type(filename, total_buf_size_bytes, n_buffers);
+      std::uint64_t magic = m_word_reader->read();
+      m_n_items = m_word_reader->read();
+      m_bits_per_item = m_word_reader->read();
+      if (magic != async_bit_packed_stream_writer::k_magic ||
+          m_bits_per_item == 0 || m_bits_per_item > 64) {
+        fprintf(stderr, "\nError: %s is not a bit-packed file\n", filename.c_str());
+        std::exit(EXIT_FAILURE);
+      }
+      m_mask = (m_bits_per_item == 64) ? ~0UL : ((1UL << m_bits_per_item) - 1);
+      m_word = 0;
+      m_word_avail = 0;
+    }
+
+  public:
+    async_bit_packed_stream_reader(std::string filename) {
+      init(filename, (8UL << 20), 4UL);
+    }
+
+    async_bit_packed_stream_reader(std::string filename,
+        std::uint64_t total_buf_size_bytes,
+        std::uint64_t n_buffers) {
+      init(filename, total_buf_size_bytes, n_buffers);
+    }
+
+    // Number of items in the file.
+    inline std::uint64_t size() const {
+      return m_n_items;
+    }
+
+    inline std::uint64_t bits_per_item() const {
+      return m_bits_per_item;
+    }
+
+    inline std::uint64_t read() {
+      std::uint64_t value = m_word;
+      if (m_word_avail >= m_bits_per_item) {
+        m_word_avail -= m_bits_per_item;
+        m_word = (m_bits_per_item < 64) ? (m_word >> m_bits_per_item) : 0;
+      } else {
+        std::uint64_t next_word = m_word_reader->read();
+        std::uint64_t next_word_used = m_bits_per_item - m_word_avail;
+        value |= (next_word << m_word_avail);
+        m_word = (next_word_used < 64) ? (next_word >> next_word_used) : 0;
+        m_word_avail = 64 - next_word_used;
+      }
+      return value & m_mask;
+    }
+
+    void stop_reading() {
+      m_word_reader->stop_reading();
+    }
+
+    inline std::uint64_t bytes_read() const {
+      return m_word_reader->bytes_read();
+    }
+
+    ~async_bit_packed_stream_reader() {
+      delete m_word_reader;
+    }
+};
+
+}  // namespace fsais_private
+
+#endif  // __FSAIS_SRC_IO_ASYNC_BIT_PACKED_STREAM_READER_HPP_INCLUDED
@@ -0,0 +1,140 @@
+/**
+ * @file    fsais_src/io/async_bit_packed_stream_writer.hpp
+ * @section LICENCE
+ *
+ * This file is part of fSAIS v0.1.0
+ * See: https://github.com/dominikkempa/fsais
+ *
+ * Copyright (C) 2016-2020
+ *   Dominik Kempa <dominik.kempa (at) gmail.com>
+ *   Juha Karkkainen <juha.karkkainen (at) cs.helsinki.fi>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ **/
+
+#ifndef __FSAIS_SRC_IO_ASYNC_BIT_PACKED_STREAM_WRITER_HPP_INCLUDED
+#define __FSAIS_SRC_IO_ASYNC_BIT_PACKED_STREAM_WRITER_HPP_INCLUDED
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <string>
+
+#include "async_stream_writer.hpp"
+
+
+namespace fsais_private {
+
+// Writes integers from [0..2^bits_per_item) using exactly
+// bits_per_item bits each. The file starts with a header of three
+// 64-bit words: the magic number k_magic, the number of items and
+// bits_per_item. It is followed by the items packed into 64-bit
+// words (starting from the least significant bit of each word,
+// an item can span two words). The last word is padded with zeros.
+// See async_bit_packed_stream_reader for the matching reader.
+class async_bit_packed_stream_writer {
+  public:
+    static const std::uint64_t k_magic = 0x314B505349415346UL;  // "FSAISPK1"
+    static const std::uint64_t k_header_size = 3 * sizeof(std::uint64_t);
+
+  private:
+    typedef async_stream_writer<std::uint64_t> word_writer_type;
+    word_writer_type *m_word_writer;
+
+    std::uint64_t m_bits_per_item;
+    std::uint64_t m_n_items;
+    std::uint64_t m_items_written;
+    std::uint64_t m_word;
+    std::uint64_t m_word_filled;
+
+  public:
+    // The minimal number of bits per item for values in [0..n).
+    static std::uint64_t bits_for(std::uint64_t n) {
+      std::uint64_t bits = 1;
+      while (bits < 64 && (1UL << bits) < n)
+        ++bits;
+      return bits;
+    }
+
+    // Size of the file storing n_items items.
+    static std::uint64_t file_size(std::uint64_t n_items,
+        std::uint64_t bits_per_item) {
+      return k_header_size + sizeof(std::uint64_t) *
+        ((n_items * bits_per_item + 63) / 64);
+    }
+
+    async_bit_packed_stream_writer(
+        std::string filename,
+        std::uint64_t n_items,
+        std::uint64_t bits_per_item,
+        std::uint64_t total_buf_size_bytes,
+        std::uint64_t n_buffers) {
+      if (bits_per_item == 0 || bits_per_item > 64) {
+        fprintf(stderr, "\nError in async_bit_packed_stream_writer: "
+            "bits_per_item = %lu\n", bits_per_item);
+        std::exit(EXIT_FAILURE);
+      }
+      m_bits_per_item = bits_per_item;
+      m_n_items = n_items;
+      m_items_written = 0;
+      m_word = 0;
+      m_word_filled = 0;
+
+      m_word_writer = new word_writer_type(filename, total_buf_size_bytes, n_buffers);
+      m_word_writer->write(k_magic);
+      m_word_writer->write(n_items);
+      m_word_writer->write(bits_per_item);
+    }
+
+    inline void write(std::uint64_t value) {
+      ++m_items_written;
+      m_word |= (value << m_word_filled);
+      m_word_filled += m_bits_per_item;
+      if (m_word_filled >= 64) {
+        m_word_writer->write(m_word);
+        m_word_filled -= 64;
+        m_word = (m_word_filled > 0) ?
+          (value >> (m_bits_per_item - m_word_filled)) : 0;
+      }
+    }
+
+    inline std::uint64_t bytes_written() const {
+      return m_word_writer->bytes_written() +
+        ((m_word_filled > 0) ? sizeof(std::uint64_t) : 0);
+    }
+
+    ~async_bit_packed_stream_writer() {
+      if (m_word_filled > 0)
+        m_word_writer->write(m_word);
+      delete m_word_writer;
+
+      if (m_items_written != m_n_items) {
+        fprintf(stderr, "\nError in async_bit_packed_stream_writer: "
+            "written %lu items, declared %lu\n", m_items_written, m_n_items);
+        std::exit(EXIT_FAILURE);
+      }
+    }
+};
+
+}  // namespace fsais_private
+
+#endif  // __FSAIS_SRC_IO_ASYNC_BIT_PACKED_STREAM_WRITER_HPP_INCLUDED
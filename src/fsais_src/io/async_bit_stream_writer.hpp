@@ -43,6 +43,7 @@
 #include <condition_variable>
 
 #include "../utils.hpp"
+#include "stream_wait_stats.hpp"
 
 
 namespace fsais_private {
@@ -54,8 +55,10 @@ class async_bit_stream_writer {
 
         // Wait until the passive buffer is available.
         std::unique_lock<std::mutex> lk(writer->m_mutex);
+        long double wait_start = utils::wclock();
         while (!(writer->m_avail) && !(writer->m_finished))
           writer->m_cv.wait(lk);
+        writer->m_wait_stats.add_io_thread_wait(utils::wclock() - wait_start);
 
         if (!(writer->m_avail) && (writer->m_finished)) {
 
@@ -68,6 +71,8 @@ class async_bit_stream_writer {
         // Safely write the data to disk.
         utils::write_to_file(writer->m_passive_buf,
             writer->m_passive_buf_filled, writer->m_file);
+        writer->m_wait_stats.add_request(
+            writer->m_passive_buf_filled * sizeof(std::uint64_t));
 
         // Let the caller know that the I/O thread finished writing.
         lk.lock();
@@ -83,8 +88,10 @@ class async_bit_stream_writer {
 
       // Wait until the I/O thread finishes writing the previous buffer.
       std::unique_lock<std::mutex> lk(m_mutex);
+      long double wait_start = utils::wclock();
       while (m_avail == true)
         m_cv.wait(lk);
+      m_wait_stats.add_consumer_wait(utils::wclock() - wait_start);
 
       // Set the new passive buffer.
       std::swap(m_active_buf, m_passive_buf);
@@ -184,6 +191,12 @@ class async_bit_stream_writer {
       return (std::uint64_t)8 * words_written;
     }
 
+    // Time spent waiting on both sides of the stream
+    // (valid after the I/O thread has been stopped).
+    inline const stream_wait_stats &wait_stats() const {
+      return m_wait_stats;
+    }
+
   private:
     std::uint64_t *m_mem;
     std::uint64_t *m_active_buf;
@@ -194,6 +207,7 @@ class async_bit_stream_writer {
     std::uint64_t m_active_buf_filled;
     std::uint64_t m_passive_buf_filled;
     std::uint64_t m_bits_written;
+    stream_wait_stats m_wait_stats;
 
     // Used for synchronization with the I/O thread.
     bool m_avail;
@@ -44,6 +44,7 @@
 #include <condition_variable>
 
 #include "../utils.hpp"
+#include "stream_wait_stats.hpp"
 
 
 namespace fsais_private {
@@ -197,9 +198,11 @@ class async_multi_stream_reader {
 
         // Wait for request or until 'no more requests' flag is set.
         std::unique_lock<std::mutex> lk(caller->m_read_requests.m_mutex);
+        long double wait_start = utils::wclock();
         while (caller->m_read_requests.empty() &&
             !(caller->m_read_requests.m_no_more_requests))
           caller->m_read_requests.m_cv.wait(lk);
+        caller->m_wait_stats.add_io_thread_wait(utils::wclock() - wait_start);
 
         if (caller->m_read_requests.empty() &&
             caller->m_read_requests.m_no_more_requests) {
@@ -216,6 +219,7 @@ class async_multi_stream_reader {
         // Process the request.
         request.m_buffer->read_from_file(caller->m_files[request.m_file_id]);
         caller->m_bytes_read += request.m_buffer->size_in_bytes();
+        caller->m_wait_stats.add_request(request.m_buffer->size_in_bytes());
 
         // Update the status of the buffer
         // and notify the waiting thread.
@@ -246,6 +250,7 @@ class async_multi_stream_reader {
 
     request_queue<request_type> m_read_requests;
     std::thread *m_io_thread;
+    stream_wait_stats m_wait_stats;
 
   private:
     void issue_read_request(std::uint64_t file_id) {
@@ -258,8 +263,10 @@ class async_multi_stream_reader {
 
       // Wait for the I/O thread to finish reading passive buffer.
       std::unique_lock<std::mutex> lk(m_mutexes[file_id]);
+      long double wait_start = utils::wclock();
       while (m_passive_buffers[file_id]->m_is_filled == false)
         m_cvs[file_id].wait(lk);
+      m_wait_stats.add_consumer_wait(utils::wclock() - wait_start);
 
       // Swap active and passive buffers.
       std::swap(m_active_buffers[file_id], m_passive_buffers[file_id]);
@@ -337,6 +344,12 @@ class async_multi_stream_reader {
       return m_bytes_read;
     }
 
+    // Time spent waiting on both sides of the stream
+    // (valid after the I/O thread has been stopped).
+    inline const stream_wait_stats &wait_stats() const {
+      return m_wait_stats;
+    }
+
     // Stop the I/O thread, now the user can
     // cafely call the bytes_read() method.
     void stop_reading() {
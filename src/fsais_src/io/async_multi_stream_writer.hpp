@@ -45,6 +45,7 @@
 #include <condition_variable>
 
 #include "../utils.hpp"
+#include "stream_wait_stats.hpp"
 
 
 namespace fsais_private {
@@ -232,9 +233,11 @@ class async_multi_stream_writer {
 
         // Wait for request or until 'no more requests' flag is set.
         std::unique_lock<std::mutex> lk(caller->m_write_requests.m_mutex);
+        long double wait_start = utils::wclock();
         while (caller->m_write_requests.empty() &&
             !(caller->m_write_requests.m_no_more_requests))
           caller->m_write_requests.m_cv.wait(lk);
+        caller->m_wait_stats.add_io_thread_wait(utils::wclock() - wait_start);
 
         if (caller->m_write_requests.empty() &&
             caller->m_write_requests.m_no_more_requests) {
@@ -249,6 +252,7 @@ class async_multi_stream_writer {
         lk.unlock();
 
         // Process the request.
+        caller->m_wait_stats.add_request(request.m_buffer->size_in_bytes());
         request.m_buffer->flush_to_file(caller->m_files[request.m_file_id]);
 
         // Add the (now empty) buffer to the collection
@@ -272,6 +276,7 @@ class async_multi_stream_writer {
     buffer_collection<buffer_type> m_empty_buffers;
     request_queue<request_type> m_write_requests;
     std::thread *m_io_thread;
+    stream_wait_stats m_wait_stats;
 
     // Issue a request to write to buffer.
     void issue_write_request(std::uint64_t file_id) {
@@ -284,8 +289,10 @@ class async_multi_stream_writer {
     // Get a free buffer from the collection of free buffers.
     buffer_type* get_empty_buffer() {
       std::unique_lock<std::mutex> lk(m_empty_buffers.m_mutex);
+      long double wait_start = utils::wclock();
       while (m_empty_buffers.empty())
         m_empty_buffers.m_cv.wait(lk);
+      m_wait_stats.add_consumer_wait(utils::wclock() - wait_start);
       buffer_type *ret = m_empty_buffers.get();
       lk.unlock();
       return ret;
@@ -367,6 +374,12 @@ class async_multi_stream_writer {
       return m_bytes_written;
     }
 
+    // Time spent waiting on both sides of the stream
+    // (valid after the I/O thread has been stopped).
+    inline const stream_wait_stats &wait_stats() const {
+      return m_wait_stats;
+    }
+
     // Destructor.
     ~async_multi_stream_writer() {
 
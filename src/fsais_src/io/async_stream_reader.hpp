@@ -44,6 +44,8 @@
 #include <condition_variable>
 
 #include "../utils.hpp"
+#include "../packed_int_conversion.hpp"
+#include "stream_wait_stats.hpp"
 
 
 namespace fsais_private {
@@ -219,9 +221,11 @@ class async_stream_reader {
 
         // Wait for an empty buffer (or a stop signal).
         std::unique_lock<std::mutex> lk(caller->m_empty_buffers->m_mutex);
+        long double wait_start = utils::wclock();
         while (caller->m_empty_buffers->empty() &&
             !(caller->m_empty_buffers->m_signal_stop))
           caller->m_empty_buffers->m_cv.wait(lk);
+        caller->m_wait_stats.add_io_thread_wait(utils::wclock() - wait_start);
 
         if (caller->m_empty_buffers->empty()) {
 
@@ -236,6 +240,7 @@ class async_stream_reader {
 
         // Read the data from disk.
         buffer->read_from_file(caller->m_file);
+        caller->m_wait_stats.add_request(buffer->size_in_bytes());
         caller->m_bytes_read += buffer->size_in_bytes();
 
         // Check if we reached the end of file.
@@ -275,8 +280,10 @@ class async_stream_reader {
 
       // Extract a filled buffer.
       std::unique_lock<std::mutex> lk(m_full_buffers->m_mutex);
+      long double wait_start = utils::wclock();
       while (m_full_buffers->empty() && !(m_full_buffers->m_signal_stop))
         m_full_buffers->m_cv.wait(lk);
+      m_wait_stats.add_consumer_wait(utils::wclock() - wait_start);
       m_cur_buffer_pos = 0;
       if (m_full_buffers->empty()) {
         lk.unlock();
@@ -297,6 +304,7 @@ class async_stream_reader {
     value_type *m_mem;
     buffer_type *m_cur_buffer;
     std::thread *m_io_thread;
+    stream_wait_stats m_wait_stats;
 
   public:
 
@@ -398,6 +406,21 @@ class async_stream_reader {
       }
     }
 
+    // Read 'howmany' items converted to std::uint64_t into 'dest'.
+    void read_unpacked(std::uint64_t *dest, std::uint64_t howmany) {
+      while (howmany > 0) {
+        if (m_cur_buffer_pos == m_cur_buffer_filled)
+          receive_new_buffer();
+
+        std::uint64_t cur_buf_left = m_cur_buffer_filled - m_cur_buffer_pos;
+        std::uint64_t tocopy = std::min(howmany, cur_buf_left);
+        unpack_ints(m_cur_buffer->m_content + m_cur_buffer_pos, dest, tocopy);
+        m_cur_buffer_pos += tocopy;
+        dest += tocopy;
+        howmany -= tocopy;
+      }
+    }
+
     // Skip the next 'howmany' items in the stream.
     void skip(std::uint64_t howmany) {
       while (howmany > 0) {
@@ -449,6 +472,12 @@ class async_stream_reader {
       return m_bytes_read;
     }
 
+    // Time spent waiting on both sides of the stream
+    // (valid after the I/O thread has been stopped).
+    inline const stream_wait_stats &wait_stats() const {
+      return m_wait_stats;
+    }
+
     // Stop the I/O thread, now the user can
     // cafely call the bytes_read() method.
     void stop_reading() {
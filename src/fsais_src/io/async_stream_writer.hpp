@@ -44,6 +44,8 @@
 #include <condition_variable>
 
 #include "../utils.hpp"
+#include "../packed_int_conversion.hpp"
+#include "stream_wait_stats.hpp"
 
 
 namespace fsais_private {
@@ -224,9 +226,11 @@ class async_stream_writer {
 
         // Wait for the full buffer (or a stop signal).
         std::unique_lock<std::mutex> lk(caller->m_full_buffers->m_mutex);
+        long double wait_start = utils::wclock();
         while (caller->m_full_buffers->empty() &&
             !(caller->m_full_buffers->m_signal_stop))
           caller->m_full_buffers->m_cv.wait(lk);
+        caller->m_wait_stats.add_io_thread_wait(utils::wclock() - wait_start);
 
         if (caller->m_full_buffers->empty()) {
           // We received the stop signal -- exit.
@@ -239,6 +243,7 @@ class async_stream_writer {
         lk.unlock();
 
         // Write the data to disk.
+        caller->m_wait_stats.add_request(buffer->size_in_bytes());
         buffer->write_to_file(caller->m_file);
 
         // Add the (now empty) buffer to the collection
@@ -251,8 +256,10 @@ class async_stream_writer {
     // Get an empty buffer from the collection of empty buffers.
     buffer_type* get_empty_buffer() {
       std::unique_lock<std::mutex> lk(m_empty_buffers->m_mutex);
+      long double wait_start = utils::wclock();
       while (m_empty_buffers->empty())
         m_empty_buffers->m_cv.wait(lk);
+      m_wait_stats.add_consumer_wait(utils::wclock() - wait_start);
       buffer_type *ret = m_empty_buffers->pop();
       lk.unlock();
       return ret;
@@ -267,6 +274,7 @@ class async_stream_writer {
     value_type *m_mem;
     buffer_type *m_cur_buffer;
     std::thread *m_io_thread;
+    stream_wait_stats m_wait_stats;
 
   public:
 
@@ -371,11 +379,34 @@ class async_stream_writer {
       }
     }
 
+    // Write values[0..length), converted to value_type, to the stream.
+    inline void write_packed(const std::uint64_t *values, std::uint64_t length) {
+      m_bytes_written += length * sizeof(value_type);
+      while (length > 0) {
+        std::uint64_t tocopy = std::min(length, m_cur_buffer->free_space());
+        pack_ints(values, m_cur_buffer->m_content + m_cur_buffer->m_filled, tocopy);
+        m_cur_buffer->m_filled += tocopy;
+        values += tocopy;
+        length -= tocopy;
+        if (m_cur_buffer->full()) {
+          m_full_buffers->push(m_cur_buffer);
+          m_full_buffers->m_cv.notify_one();
+          m_cur_buffer = get_empty_buffer();
+        }
+      }
+    }
+
     // Return performed I/O in bytes.
     inline std::uint64_t bytes_written() const {
       return m_bytes_written;
     }
 
+    // Time spent waiting on both sides of the stream
+    // (valid after the I/O thread has been stopped).
+    inline const stream_wait_stats &wait_stats() const {
+      return m_wait_stats;
+    }
+
     // Destructor.
     ~async_stream_writer() {
 
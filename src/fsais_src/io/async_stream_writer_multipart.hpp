@@ -44,6 +44,7 @@
 #include <condition_variable>
 
 #include "../utils.hpp"
+#include "stream_wait_stats.hpp"
 
 
 namespace fsais_private {
@@ -219,9 +220,11 @@ class async_stream_writer_multipart {
 
         // Wait for the full buffer (or a stop signal).
         std::unique_lock<std::mutex> lk(caller->m_full_buffers->m_mutex);
+        long double wait_start = utils::wclock();
         while (caller->m_full_buffers->empty() &&
             !(caller->m_full_buffers->m_signal_stop))
           caller->m_full_buffers->m_cv.wait(lk);
+        caller->m_wait_stats.add_io_thread_wait(utils::wclock() - wait_start);
 
         if (caller->m_full_buffers->empty()) {
           // We received the stop signal -- exit.
@@ -250,6 +253,7 @@ class async_stream_writer_multipart {
           std::uint64_t cur_part_items_left = caller->m_single_part_max_items - caller->m_cur_part_items_written;
           std::uint64_t towrite = std::min(cur_part_items_left, buffer->m_filled);
           utils::write_to_file(ptr, towrite, caller->m_file);
+          caller->m_wait_stats.add_request(towrite * sizeof(T));
           caller->m_cur_part_items_written += towrite;
           buffer->m_filled -= towrite;
           ptr += towrite;
@@ -265,8 +269,10 @@ class async_stream_writer_multipart {
     // Get an empty buffer from the collection of empty buffers.
     buffer_type* get_empty_buffer() {
       std::unique_lock<std::mutex> lk(m_empty_buffers->m_mutex);
+      long double wait_start = utils::wclock();
       while (m_empty_buffers->empty())
         m_empty_buffers->m_cv.wait(lk);
+      m_wait_stats.add_consumer_wait(utils::wclock() - wait_start);
       buffer_type *ret = m_empty_buffers->pop();
       lk.unlock();
       return ret;
@@ -285,6 +291,7 @@ class async_stream_writer_multipart {
     value_type *m_mem;
     buffer_type *m_cur_buffer;
     std::thread *m_io_thread;
+    stream_wait_stats m_wait_stats;
 
   public:
     async_stream_writer_multipart(std::string filename,
@@ -368,6 +375,12 @@ class async_stream_writer_multipart {
       return m_bytes_written;
     }
 
+    // Time spent waiting on both sides of the stream
+    // (valid after the I/O thread has been stopped).
+    inline const stream_wait_stats &wait_stats() const {
+      return m_wait_stats;
+    }
+
     // It's safe to call if the buffer is not full, though
     // in principle should only be called internally. Calling
     // it too often will lead to poor I/O performance.
@@ -0,0 +1,136 @@
+/**
+ * @file    fsais_src/io/stream_wait_stats.hpp
+ * @section LICENCE
+ *
+ * This file is part of fSAIS v0.1.0
+ * See: https://github.com/dominikkempa/fsais
+ *
+ * Copyright (C) 2016-2020
+ *   Dominik Kempa <dominik.kempa (at) gmail.com>
+ *   Juha Karkkainen <juha.karkkainen (at) cs.helsinki.fi>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ **/
+
+#ifndef __FSAIS_SRC_IO_STREAM_WAIT_STATS_HPP_INCLUDED
+#define __FSAIS_SRC_IO_STREAM_WAIT_STATS_HPP_INCLUDED
+
+#include <cstdint>
+#include <atomic>
+
+
+namespace fsais_private {
+
+// Time spent blocked on both sides of an async stream: by the
+// user of the stream (waiting for the I/O thread to read/write
+// a buffer) and by the I/O thread (waiting for the user to
+// consume/fill a buffer), plus the number and total size of
+// I/O requests. The consumer-side and I/O-thread-side fields
+// are each updated by a single thread. All updates are also
+// added to process-wide totals, used to compute per-phase stats.
+class stream_wait_stats {
+  private:
+    long double m_consumer_wait_time;
+    long double m_io_thread_wait_time;
+    std::uint64_t m_n_requests;
+    std::uint64_t m_request_bytes;
+
+    static std::atomic<std::uint64_t> &total_consumer_wait_ns() {
+      static std::atomic<std::uint64_t> value(0);
+      return value;
+    }
+
+    static std::atomic<std::uint64_t> &total_io_thread_wait_ns() {
+      static std::atomic<std::uint64_t> value(0);
+      return value;
+    }
+
+    static std::atomic<std::uint64_t> &total_n_requests() {
+      static std::atomic<std::uint64_t> value(0);
+      return value;
+    }
+
+    static std::atomic<std::uint64_t> &total_request_bytes() {
+      static std::atomic<std::uint64_t> value(0);
+      return value;
+    }
+
+  public:
+    stream_wait_stats()
+      : m_consumer_wait_time(0.L),
+        m_io_thread_wait_time(0.L),
+        m_n_requests(0),
+        m_request_bytes(0) {}
+
+    inline void add_consumer_wait(long double seconds) {
+      m_consumer_wait_time += seconds;
+      total_consumer_wait_ns() += (std::uint64_t)(seconds * 1000000000.L);
+    }
+
+    inline void add_io_thread_wait(long double seconds) {
+      m_io_thread_wait_time += seconds;
+      total_io_thread_wait_ns() += (std::uint64_t)(seconds * 1000000000.L);
+    }
+
+    inline void add_request(std::uint64_t bytes) {
+      ++m_n_requests;
+      m_request_bytes += bytes;
+      ++total_n_requests();
+      total_request_bytes() += bytes;
+    }
+
+    inline long double consumer_wait_time() const {
+      return m_consumer_wait_time;
+    }
+
+    inline long double io_thread_wait_time() const {
+      return m_io_thread_wait_time;
+    }
+
+    inline std::uint64_t n_requests() const {
+      return m_n_requests;
+    }
+
+    inline std::uint64_t request_bytes() const {
+      return m_request_bytes;
+    }
+
+    static long double get_total_consumer_wait_time() {
+      return total_consumer_wait_ns() / 1000000000.L;
+    }
+
+    static long double get_total_io_thread_wait_time() {
+      return total_io_thread_wait_ns() / 1000000000.L;
+    }
+
+    static std::uint64_t get_total_n_requests() {
+      return total_n_requests();
+    }
+
+    static std::uint64_t get_total_request_bytes() {
+      return total_request_bytes();
+    }
+};
+
+}  // namespace fsais_private
+
+#endif  // __FSAIS_SRC_IO_STREAM_WAIT_STATS_HPP_INCLUDED
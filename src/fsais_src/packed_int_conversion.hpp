@@ -0,0 +1,161 @@
+/**
+ * @file    fsais_src/packed_int_conversion.hpp
+ * @section LICENCE
+ *
+ * This file is part of fSAIS v0.1.0
+ * See: https://github.com/dominikkempa/fsais
+ *
+ * Copyright (C) 2016-2020
+ *   Dominik Kempa <dominik.kempa (at) gmail.com>
+ *   Juha Karkkainen <juha.karkkainen (at) cs.helsinki.fi>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ **/
+
+#ifndef __FSAIS_SRC_PACKED_INT_CONVERSION_HPP_INCLUDED
+#define __FSAIS_SRC_PACKED_INT_CONVERSION_HPP_INCLUDED
+
+#include <cstdint>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include "../uint24.hpp"
+#include "../uint40.hpp"
+#include "../uint48.hpp"
+
+
+namespace fsais_private {
+
+// Bulk conversion between arrays of integers of type int_type and
+// arrays of std::uint64_t. For the packed 3, 5 and 6-byte integers
+// (uint24, uint40, uint48), the conversion is done on the raw
+// (little-endian) bytes, four items at a time using AVX2 shuffles
+// if available. Other types are converted one item at a time.
+template<typename int_type>
+struct packed_int_conversion {
+  static void unpack(const int_type *src,
+      std::uint64_t *dest, std::uint64_t length) {
+    for (std::uint64_t i = 0; i < length; ++i)
+      dest[i] = (std::uint64_t)src[i];
+  }
+
+  static void pack(const std::uint64_t *src,
+      int_type *dest, std::uint64_t length) {
+    for (std::uint64_t i = 0; i < length; ++i)
+      dest[i] = (int_type)src[i];
+  }
+};
+
+template<typename int_type>
+struct packed_bytes_conversion {
+  static const std::uint64_t k_width = sizeof(int_type);
+
+  static void unpack(const int_type *src,
+      std::uint64_t *dest, std::uint64_t length) {
+    std::uint64_t i = 0;
+#ifdef __AVX2__
+
+    // Each 128-bit lane receives two consecutive items (2 * k_width
+    // bytes) and spreads them into two 64-bit words. A lane loads 16
+    // bytes, so the loop stops before reading past the end of src.
+    const std::uint8_t *src_bytes = (const std::uint8_t *)src;
+    std::uint8_t mask_bytes[32];
+    for (std::uint64_t j = 0; j < 32; ++j) {
+      std::uint64_t item = (j % 16) / 8;
+      std::uint64_t byte = j % 8;
+      mask_bytes[j] = (byte < k_width) ? item * k_width + byte : 0x80;
+    }
+    const __m256i mask = _mm256_loadu_si256((const __m256i *)mask_bytes);
+    for (; (i + 2) * k_width + 16 <= length * k_width; i += 4) {
+      const std::uint8_t *p = src_bytes + i * k_width;
+      __m256i x = _mm256_inserti128_si256(_mm256_castsi128_si256(
+            _mm_loadu_si128((const __m128i *)p)),
+          _mm_loadu_si128((const __m128i *)(p + 2 * k_width)), 1);
+      _mm256_storeu_si256((__m256i *)(dest + i), _mm256_shuffle_epi8(x, mask));
+    }
+#endif
+    for (; i < length; ++i)
+      dest[i] = (std::uint64_t)src[i];
+  }
+
+  static void pack(const std::uint64_t *src,
+      int_type *dest, std::uint64_t length) {
+    std::uint64_t i = 0;
+#ifdef __AVX2__
+
+    // Each 128-bit lane compacts two 64-bit words into its lowest
+    // 2 * k_width bytes. Lanes are stored as 16 bytes; the bytes past
+    // 2 * k_width are overwritten by the next store, so the loop
+    // stops before writing past the end of dest.
+    std::uint8_t *dest_bytes = (std::uint8_t *)dest;
+    std::uint8_t mask_bytes[32];
+    for (std::uint64_t j = 0; j < 32; ++j) {
+      std::uint64_t byte = j % 16;
+      mask_bytes[j] = (byte < 2 * k_width) ?
+        (byte / k_width) * 8 + byte % k_width : 0x80;
+    }
+    const __m256i mask = _mm256_loadu_si256((const __m256i *)mask_bytes);
+    for (; (i + 2) * k_width + 16 <= length * k_width; i += 4) {
+      __m256i x = _mm256_shuffle_epi8(
+          _mm256_loadu_si256((const __m256i *)(src + i)), mask);
+      std::uint8_t *p = dest_bytes + i * k_width;
+      _mm_storeu_si128((__m128i *)p, _mm256_castsi256_si128(x));
+      _mm_storeu_si128((__m128i *)(p + 2 * k_width),
+          _mm256_extracti128_si256(x, 1));
+    }
+#endif
+    for (; i < length; ++i)
+      dest[i] = (int_type)src[i];
+  }
+};
+
+template<>
+struct packed_int_conversion<uint24> :
+  public packed_bytes_conversion<uint24> {};
+
+template<>
+struct packed_int_conversion<uint40> :
+  public packed_bytes_conversion<uint40> {};
+
+template<>
+struct packed_int_conversion<uint48> :
+  public packed_bytes_conversion<uint48> {};
+
+// Convert src[0..length) into dest[0..length).
+template<typename int_type>
+inline void unpack_ints(const int_type *src,
+    std::uint64_t *dest, std::uint64_t length) {
+  packed_int_conversion<int_type>::unpack(src, dest, length);
+}
+
+// Convert src[0..length) into dest[0..length).
+template<typename int_type>
+inline void pack_ints(const std::uint64_t *src,
+    int_type *dest, std::uint64_t length) {
+  packed_int_conversion<int_type>::pack(src, dest, length);
+}
+
+}  // namespace fsais_private
+
+#endif  // __FSAIS_SRC_PACKED_INT_CONVERSION_HPP_INCLUDED
@@ -0,0 +1,154 @@
+/**
+ * @file    fsais_src/page_arena.hpp
+ * @section LICENCE
+ *
+ * This file is part of fSAIS v0.1.0
+ * See: https://github.com/dominikkempa/fsais
+ *
+ * Copyright (C) 2016-2020
+ *   Dominik Kempa <dominik.kempa (at) gmail.com>
+ *   Juha Karkkainen <juha.karkkainen (at) cs.helsinki.fi>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ **/
+
+#ifndef __FSAIS_SRC_PAGE_ARENA_HPP_INCLUDED
+#define __FSAIS_SRC_PAGE_ARENA_HPP_INCLUDED
+
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+
+#include "utils.hpp"
+
+
+namespace fsais_private {
+
+//=============================================================================
+// A pool of fixed-size pages used as the storage of internal queues of
+// radix_heap. The memory is requested from utils::allocate only once,
+// when the arena is created, so that the push/pop operations of the heap
+// never call the (globally locked) allocator. Freed pages are recycled
+// using a free list. The arena is meant to be created once per block
+// driver and reused by all heaps created while processing the blocks.
+// A single arena must not be used by more than one heap at a time.
+//
+// The beginning of the memory is aligned to the cache line and, if the
+// page size allows it, the page size is rounded up so that every page
+// starts at the cache line boundary.
+//=============================================================================
+template<typename ValueType>
+class page_arena {
+  public:
+    typedef ValueType value_type;
+
+  private:
+    static const std::uint64_t k_cache_line_size = 64;
+
+    std::uint64_t m_pagesize;
+    std::uint64_t m_n_pages;
+    std::uint64_t m_empty_pages_list_head;
+    std::uint64_t *m_pages_next;
+    value_type *m_pages_mem;
+
+  public:
+    static const std::uint64_t k_null_page =
+      std::numeric_limits<std::uint64_t>::max();
+
+    // Round up the page size so that the size of a
+    // page in bytes is a multiple of cache line size.
+    static std::uint64_t aligned_pagesize(std::uint64_t pagesize) {
+      if (pagesize * sizeof(value_type) < k_cache_line_size)
+        return pagesize;
+      std::uint64_t items_per_line = k_cache_line_size /
+        utils::gcd(k_cache_line_size, (std::uint64_t)sizeof(value_type));
+      return ((pagesize + items_per_line - 1) / items_per_line) * items_per_line;
+    }
+
+    // Create the arena capable of holding max_items items
+    // spread among at most max_queues concurrent queues.
+    page_arena(
+        std::uint64_t max_items,
+        std::uint64_t max_queues,
+        std::uint64_t pagesize) {
+      m_pagesize = aligned_pagesize(pagesize);
+      m_n_pages = max_items / m_pagesize + 2UL * max_queues;
+      m_pages_mem = utils::aligned_allocate_array<value_type>(
+          m_n_pages * m_pagesize, k_cache_line_size);
+      m_pages_next = utils::allocate_array<std::uint64_t>(m_n_pages);
+      reset();
+    }
+
+    // Mark all pages as empty.
+    void reset() {
+      for (std::uint64_t i = 0; i < m_n_pages; ++i) {
+        if (i + 1 != m_n_pages) m_pages_next[i] = i + 1;
+        else m_pages_next[i] = k_null_page;
+      }
+      m_empty_pages_list_head = 0;
+    }
+
+    inline std::uint64_t get_page() {
+      std::uint64_t page_id = m_empty_pages_list_head;
+      m_empty_pages_list_head = m_pages_next[page_id];
+      m_pages_next[page_id] = k_null_page;
+      return page_id;
+    }
+
+    inline void release_page(std::uint64_t page_id) {
+      m_pages_next[page_id] = m_empty_pages_list_head;
+      m_empty_pages_list_head = page_id;
+    }
+
+    inline std::uint64_t next_page(std::uint64_t page_id) const {
+      return m_pages_next[page_id];
+    }
+
+    inline void set_next_page(
+        std::uint64_t page_id,
+        std::uint64_t next_page_id) {
+      m_pages_next[page_id] = next_page_id;
+    }
+
+    inline value_type &item(
+        std::uint64_t page_id,
+        std::uint64_t offset) const {
+      return m_pages_mem[page_id * m_pagesize + offset];
+    }
+
+    inline std::uint64_t pagesize() const {
+      return m_pagesize;
+    }
+
+    inline std::uint64_t n_pages() const {
+      return m_n_pages;
+    }
+
+    ~page_arena() {
+      utils::deallocate(m_pages_next);
+      utils::aligned_deallocate(m_pages_mem);
+    }
+};
+
+}  // namespace fsais_private
+
+#endif  // __FSAIS_SRC_PAGE_ARENA_HPP_INCLUDED
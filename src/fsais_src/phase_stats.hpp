@@ -0,0 +1,328 @@
+/**
+ * @file    fsais_src/phase_stats.hpp
+ * @section LICENCE
+ *
+ * This file is part of fSAIS v0.1.0
+ * See: https://github.com/dominikkempa/fsais
+ *
+ * Copyright (C) 2016-2020
+ *   Dominik Kempa <dominik.kempa (at) gmail.com>
+ *   Juha Karkkainen <juha.karkkainen (at) cs.helsinki.fi>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ **/
+
+#ifndef __FSAIS_SRC_PHASE_STATS_HPP_INCLUDED
+#define __FSAIS_SRC_PHASE_STATS_HPP_INCLUDED
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "io/stream_wait_stats.hpp"
+#include "progress_reporter.hpp"
+#include "utils.hpp"
+
+
+namespace fsais_private {
+
+// Collects wall time, CPU time, I/O and peak RAM/disk of every
+// phase of the computation. Phases are nested (e.g., recursion
+// levels contain induce phases) and are delimited by calls to
+// begin_phase and end_phase (always from the main thread).
+// The resulting tree can be written as a JSON document.
+class phase_stats {
+  private:
+    struct phase_record {
+      std::string m_name;
+      std::uint64_t m_recursion_level;
+
+      long double m_wall_time;
+      long double m_cpu_time;
+      std::uint64_t m_bytes_read;
+      std::uint64_t m_bytes_written;
+      std::uint64_t m_peak_ram;
+      std::uint64_t m_peak_disk;
+
+      // Time spent waiting by the users of async streams and by
+      // their I/O threads, and the number/size of I/O requests.
+      long double m_consumer_wait_time;
+      long double m_io_thread_wait_time;
+      std::uint64_t m_n_io_requests;
+      std::uint64_t m_io_request_bytes;
+      std::vector<phase_record*> m_subphases;
+
+      // Counter values at the beginning of the phase.
+      long double m_start_wall_time;
+      std::clock_t m_start_cpu_time;
+      std::uint64_t m_start_bytes_read;
+      std::uint64_t m_start_bytes_written;
+      std::uint64_t m_parent_peak_ram;
+      std::uint64_t m_parent_peak_disk;
+      long double m_start_consumer_wait_time;
+      long double m_start_io_thread_wait_time;
+      std::uint64_t m_start_n_io_requests;
+      std::uint64_t m_start_io_request_bytes;
+
+      ~phase_record() {
+        for (std::uint64_t i = 0; i < m_subphases.size(); ++i)
+          delete m_subphases[i];
+      }
+    };
+
+    std::vector<phase_record*> m_phases;
+    std::vector<phase_record*> m_stack;
+
+    static phase_stats &instance() {
+      static phase_stats stats;
+      return stats;
+    }
+
+    ~phase_stats() {
+      for (std::uint64_t i = 0; i < m_phases.size(); ++i)
+        delete m_phases[i];
+    }
+
+    static std::string json_escape(std::string s) {
+      std::string ret;
+      for (std::uint64_t i = 0; i < s.length(); ++i) {
+        unsigned char c = s[i];
+        if (c == '"' || c == '\\') {
+          ret += '\\';
+          ret += c;
+        } else if (c < 0x20) {
+          char buf[8];
+          std::sprintf(buf, "\\u%04x", (unsigned)c);
+          ret += buf;
+        } else ret += c;
+      }
+      return ret;
+    }
+
+    static void write_phase_json(std::FILE *f,
+        const phase_record *p, std::string indent) {
+      fprintf(f, "%s{\n", indent.c_str());
+      fprintf(f, "%s  \"name\": \"%s\",\n", indent.c_str(),
+          json_escape(p->m_name).c_str());
+      fprintf(f, "%s  \"recursion_level\": %lu,\n",
+          indent.c_str(), p->m_recursion_level);
+      fprintf(f, "%s  \"wall_time_sec\": %.6Lf,\n",
+          indent.c_str(), p->m_wall_time);
+      fprintf(f, "%s  \"cpu_time_sec\": %.6Lf,\n",
+          indent.c_str(), p->m_cpu_time);
+      fprintf(f, "%s  \"bytes_read\": %lu,\n",
+          indent.c_str(), p->m_bytes_read);
+      fprintf(f, "%s  \"bytes_written\": %lu,\n",
+          indent.c_str(), p->m_bytes_written);
+      fprintf(f, "%s  \"peak_ram_bytes\": %lu,\n",
+          indent.c_str(), p->m_peak_ram);
+      fprintf(f, "%s  \"peak_disk_bytes\": %lu,\n",
+          indent.c_str(), p->m_peak_disk);
+      fprintf(f, "%s  \"consumer_wait_sec\": %.6Lf,\n",
+          indent.c_str(), p->m_consumer_wait_time);
+      fprintf(f, "%s  \"io_thread_wait_sec\": %.6Lf,\n",
+          indent.c_str(), p->m_io_thread_wait_time);
+      fprintf(f, "%s  \"io_requests\": %lu,\n",
+          indent.c_str(), p->m_n_io_requests);
+      fprintf(f, "%s  \"io_request_bytes\": %lu,\n",
+          indent.c_str(), p->m_io_request_bytes);
+      fprintf(f, "%s  \"io_bound\": %s,\n",
+          indent.c_str(), is_io_bound(p) ? "true" : "false");
+      fprintf(f, "%s  \"phases\": [", indent.c_str());
+      for (std::uint64_t i = 0; i < p->m_subphases.size(); ++i) {
+        fprintf(f, (i == 0) ? "\n" : ",\n");
+        write_phase_json(f, p->m_subphases[i], indent + "    ");
+      }
+      if (!p->m_subphases.empty())
+        fprintf(f, "\n%s  ", indent.c_str());
+      fprintf(f, "]\n%s}", indent.c_str());
+    }
+
+    static void print_io_wait_summary(const phase_record *p) {
+      for (std::uint64_t i = 0; i < p->m_subphases.size(); ++i)
+        print_io_wait_summary(p->m_subphases[i]);
+      if (!p->m_subphases.empty() || p->m_n_io_requests == 0)
+        return;
+      fprintf(stderr, "    Level %lu, %s: consumers = %.2Lfs (%.0Lf%%), "
+          "I/O threads = %.2Lfs, requests = %lu (avg %.1LfKiB) -> %s\n",
+          p->m_recursion_level, p->m_name.c_str(), p->m_consumer_wait_time,
+          (100.L * p->m_consumer_wait_time) / std::max(p->m_wall_time, (long double)1e-9),
+          p->m_io_thread_wait_time, p->m_n_io_requests,
+          (1.L * p->m_io_request_bytes / p->m_n_io_requests) / 1024.L,
+          is_io_bound(p) ? "I/O-bound" : "CPU-bound");
+    }
+
+    // A phase is I/O-bound if the computation spends at
+    // least half of the time waiting for the I/O threads.
+    static bool is_io_bound(const phase_record *p) {
+      return p->m_consumer_wait_time >= p->m_wall_time / 2;
+    }
+
+    // Publish the innermost active phase to the progress reporter.
+    static void publish_current_phase() {
+      phase_stats &s = instance();
+      if (s.m_stack.empty()) {
+        progress_reporter::set_phase(json_string(""), 0, utils::wclock());
+        return;
+      }
+      std::string name;
+      for (std::uint64_t i = 0; i < s.m_stack.size(); ++i)
+        name += ((i > 0) ? " / " : "") + s.m_stack[i]->m_name;
+      progress_reporter::set_phase(json_string(name),
+          s.m_stack.back()->m_recursion_level,
+          s.m_stack.back()->m_start_wall_time);
+    }
+
+  public:
+
+    // Discard all recorded phases.
+    static void reset() {
+      phase_stats &s = instance();
+      for (std::uint64_t i = 0; i < s.m_phases.size(); ++i)
+        delete s.m_phases[i];
+      s.m_phases.clear();
+      s.m_stack.clear();
+    }
+
+    // Start a new phase nested in the current one. The
+    // recursion level is inherited from the enclosing phase.
+    static void begin_phase(std::string name) {
+      phase_stats &s = instance();
+      std::uint64_t level = s.m_stack.empty() ? 0 :
+        s.m_stack.back()->m_recursion_level;
+      begin_phase(name, level);
+    }
+
+    static void begin_phase(std::string name,
+        std::uint64_t recursion_level) {
+      phase_stats &s = instance();
+      phase_record *p = new phase_record();
+      p->m_name = name;
+      p->m_recursion_level = recursion_level;
+      p->m_start_wall_time = utils::wclock();
+      p->m_start_cpu_time = std::clock();
+      p->m_start_bytes_read = utils::get_total_bytes_read();
+      p->m_start_bytes_written = utils::get_total_bytes_written();
+
+      // Save the peaks of the enclosing phase and restart
+      // the counters, so that they record the new phase only.
+      p->m_parent_peak_ram = utils::get_phase_peak_ram_allocation();
+      p->m_parent_peak_disk = utils::get_phase_peak_disk_allocation();
+      utils::set_phase_peak_ram_allocation(0);
+      utils::set_phase_peak_disk_allocation(0);
+
+      p->m_start_consumer_wait_time = stream_wait_stats::get_total_consumer_wait_time();
+      p->m_start_io_thread_wait_time = stream_wait_stats::get_total_io_thread_wait_time();
+      p->m_start_n_io_requests = stream_wait_stats::get_total_n_requests();
+      p->m_start_io_request_bytes = stream_wait_stats::get_total_request_bytes();
+
+      if (s.m_stack.empty()) s.m_phases.push_back(p);
+      else s.m_stack.back()->m_subphases.push_back(p);
+      s.m_stack.push_back(p);
+      publish_current_phase();
+    }
+
+    static void end_phase() {
+      phase_stats &s = instance();
+      if (s.m_stack.empty()) {
+        fprintf(stderr, "\nError: end_phase without begin_phase!\n");
+        std::exit(EXIT_FAILURE);
+      }
+
+      phase_record *p = s.m_stack.back();
+      s.m_stack.pop_back();
+      p->m_wall_time = utils::wclock() - p->m_start_wall_time;
+      p->m_cpu_time = (long double)(std::clock() -
+          p->m_start_cpu_time) / CLOCKS_PER_SEC;
+      p->m_bytes_read = utils::get_total_bytes_read() -
+        p->m_start_bytes_read;
+      p->m_bytes_written = utils::get_total_bytes_written() -
+        p->m_start_bytes_written;
+      p->m_peak_ram = utils::get_phase_peak_ram_allocation();
+      p->m_peak_disk = utils::get_phase_peak_disk_allocation();
+      publish_current_phase();
+
+      // The peaks of the enclosing phase include this phase.
+      utils::set_phase_peak_ram_allocation(
+          std::max(p->m_parent_peak_ram, p->m_peak_ram));
+      utils::set_phase_peak_disk_allocation(
+          std::max(p->m_parent_peak_disk, p->m_peak_disk));
+
+      p->m_consumer_wait_time = stream_wait_stats::get_total_consumer_wait_time() -
+        p->m_start_consumer_wait_time;
+      p->m_io_thread_wait_time = stream_wait_stats::get_total_io_thread_wait_time() -
+        p->m_start_io_thread_wait_time;
+      p->m_n_io_requests = stream_wait_stats::get_total_n_requests() -
+        p->m_start_n_io_requests;
+      p->m_io_request_bytes = stream_wait_stats::get_total_request_bytes() -
+        p->m_start_io_request_bytes;
+    }
+
+    // Print the I/O wait summary of every innermost completed
+    // phase that issued I/O requests (one line per phase).
+    static void print_io_wait_summary() {
+      phase_stats &s = instance();
+      fprintf(stderr, "  I/O wait of phases:\n");
+      for (std::uint64_t i = 0; i < s.m_phases.size(); ++i)
+        print_io_wait_summary(s.m_phases[i]);
+    }
+
+    // Write all completed phases as a JSON document. The
+    // fields of the header are written as top-level members.
+    static void write_json(std::string filename,
+        std::vector<std::pair<std::string, std::string> > &header) {
+      phase_stats &s = instance();
+      std::FILE *f = utils::file_open(filename, "w");
+      fprintf(f, "{\n");
+      for (std::uint64_t i = 0; i < header.size(); ++i)
+        fprintf(f, "  \"%s\": %s,\n", json_escape(header[i].first).c_str(),
+            header[i].second.c_str());
+      fprintf(f, "  \"phases\": [");
+      for (std::uint64_t i = 0; i < s.m_phases.size(); ++i) {
+        fprintf(f, (i == 0) ? "\n" : ",\n");
+        write_phase_json(f, s.m_phases[i], "    ");
+      }
+      if (!s.m_phases.empty())
+        fprintf(f, "\n  ");
+      fprintf(f, "]\n}\n");
+      std::fclose(f);
+    }
+
+    static std::string json_string(std::string s) {
+      return "\"" + json_escape(s) + "\"";
+    }
+
+    // Format time (in seconds) as the wall times of phases.
+    static std::string json_time(long double t) {
+      char buf[64];
+      std::snprintf(buf, sizeof(buf), "%.6Lf", t);
+      return std::string(buf);
+    }
+};
+
+}  // namespace fsais_private
+
+#endif  // __FSAIS_SRC_PHASE_STATS_HPP_INCLUDED
@@ -0,0 +1,245 @@
+/**
+ * @file    fsais_src/progress_reporter.hpp
+ * @section LICENCE
+ *
+ * This file is part of fSAIS v0.1.0
+ * See: https://github.com/dominikkempa/fsais
+ *
+ * Copyright (C) 2016-2020
+ *   Dominik Kempa <dominik.kempa (at) gmail.com>
+ *   Juha Karkkainen <juha.karkkainen (at) cs.helsinki.fi>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ **/
+
+#ifndef __FSAIS_SRC_PROGRESS_REPORTER_HPP_INCLUDED
+#define __FSAIS_SRC_PROGRESS_REPORTER_HPP_INCLUDED
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <algorithm>
+
+#include "utils.hpp"
+
+
+namespace fsais_private {
+
+// Publishes the progress of the computation. The current phase
+// (set by phase_stats) announces the number of items it expects
+// to process (for some phases only an upper bound, e.g., the text
+// length) and periodically updates the number of processed items.
+// If started, a reporter thread rewrites the status file (in JSON
+// format) every second with the current phase, its progress, the
+// ETA of the phase (based on the measured item throughput) and the
+// I/O volume and throughput.
+class progress_reporter {
+  private:
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::thread *m_thread;
+    std::string m_filename;
+    bool m_stop;
+
+    std::string m_phase_name_json;
+    std::uint64_t m_recursion_level;
+    long double m_start_time;
+    long double m_phase_start_time;
+    std::atomic<std::uint64_t> m_items_expected;
+    std::atomic<std::uint64_t> m_items_processed;
+
+    // State of the previous report (used to compute the throughput).
+    long double m_prev_report_time;
+    std::uint64_t m_prev_report_io_volume;
+
+    progress_reporter()
+      : m_thread(NULL),
+        m_stop(false),
+        m_phase_name_json("\"\""),
+        m_recursion_level(0),
+        m_start_time(0.L),
+        m_phase_start_time(0.L),
+        m_items_expected(0),
+        m_items_processed(0),
+        m_prev_report_time(0.L),
+        m_prev_report_io_volume(0) {}
+
+    static progress_reporter &instance() {
+      static progress_reporter r;
+      return r;
+    }
+
+    static void write_status(bool finished) {
+      progress_reporter &r = instance();
+      long double now = utils::wclock();
+      std::uint64_t bytes_read = utils::get_total_bytes_read();
+      std::uint64_t bytes_written = utils::get_total_bytes_written();
+      std::uint64_t io_volume = bytes_read + bytes_written;
+      std::uint64_t items_expected = r.m_items_expected;
+      std::uint64_t items_processed = r.m_items_processed;
+
+      std::string phase_name_json;
+      std::uint64_t recursion_level = 0;
+      long double phase_elapsed = 0.L;
+      {
+        std::lock_guard<std::mutex> lk(r.m_mutex);
+        phase_name_json = r.m_phase_name_json;
+        recursion_level = r.m_recursion_level;
+        phase_elapsed = now - r.m_phase_start_time;
+      }
+
+      long double io_throughput = 0.L;
+      if (now > r.m_prev_report_time)
+        io_throughput = (io_volume - r.m_prev_report_io_volume) /
+          (now - r.m_prev_report_time);
+      r.m_prev_report_time = now;
+      r.m_prev_report_io_volume = io_volume;
+
+      // Write to a temporary file first, so that
+      // the status file is always complete.
+      std::string temp_filename = r.m_filename + ".tmp";
+      std::FILE *f = utils::file_open(temp_filename, "w");
+      fprintf(f, "{\n");
+      fprintf(f, "  \"finished\": %s,\n", finished ? "true" : "false");
+      fprintf(f, "  \"elapsed_sec\": %.3Lf,\n", now - r.m_start_time);
+      fprintf(f, "  \"phase\": %s,\n", phase_name_json.c_str());
+      fprintf(f, "  \"recursion_level\": %lu,\n", recursion_level);
+      fprintf(f, "  \"phase_elapsed_sec\": %.3Lf,\n", phase_elapsed);
+      fprintf(f, "  \"items_processed\": %lu,\n", items_processed);
+      fprintf(f, "  \"items_expected\": %lu,\n", items_expected);
+      if (items_expected > 0 && items_processed > 0) {
+        long double done = std::min(1.L, (1.L * items_processed) / items_expected);
+        fprintf(f, "  \"phase_fraction_done\": %.4Lf,\n", done);
+        fprintf(f, "  \"phase_eta_sec\": %.3Lf,\n",
+            (phase_elapsed * (1.L - done)) / done);
+      } else {
+        fprintf(f, "  \"phase_fraction_done\": null,\n");
+        fprintf(f, "  \"phase_eta_sec\": null,\n");
+      }
+      fprintf(f, "  \"bytes_read\": %lu,\n", bytes_read);
+      fprintf(f, "  \"bytes_written\": %lu,\n", bytes_written);
+      fprintf(f, "  \"io_bytes_per_sec\": %.0Lf\n", io_throughput);
+      fprintf(f, "}\n");
+      std::fclose(f);
+      if (std::rename(temp_filename.c_str(), r.m_filename.c_str())) {
+        std::perror(r.m_filename.c_str());
+        std::exit(EXIT_FAILURE);
+      }
+    }
+
+    static void reporter_thread_code() {
+      progress_reporter &r = instance();
+      std::unique_lock<std::mutex> lk(r.m_mutex);
+      while (!r.m_stop) {
+        r.m_cv.wait_for(lk, std::chrono::seconds(1));
+        if (r.m_stop) break;
+        lk.unlock();
+        write_status(false);
+        lk.lock();
+      }
+    }
+
+  public:
+
+    // Start the reporter thread writing to the given file.
+    static void start(std::string filename) {
+      progress_reporter &r = instance();
+      r.m_filename = filename;
+      r.m_stop = false;
+      r.m_start_time = utils::wclock();
+      r.m_prev_report_time = r.m_start_time;
+      r.m_prev_report_io_volume = utils::get_total_bytes_read() +
+        utils::get_total_bytes_written();
+      r.m_thread = new std::thread(reporter_thread_code);
+    }
+
+    // Stop the reporter thread and write the final status.
+    static void stop() {
+      progress_reporter &r = instance();
+      if (r.m_thread == NULL)
+        return;
+      {
+        std::lock_guard<std::mutex> lk(r.m_mutex);
+        r.m_stop = true;
+      }
+      r.m_cv.notify_one();
+      r.m_thread->join();
+      delete r.m_thread;
+      r.m_thread = NULL;
+      write_status(true);
+    }
+
+    // Set the current phase and reset its progress. The name of
+    // the phase is given as a JSON string (see phase_stats::json_string).
+    static void set_phase(std::string name_json,
+        std::uint64_t recursion_level,
+        long double phase_start_time) {
+      progress_reporter &r = instance();
+      std::lock_guard<std::mutex> lk(r.m_mutex);
+      r.m_phase_name_json = name_json;
+      r.m_recursion_level = recursion_level;
+      r.m_phase_start_time = phase_start_time;
+      r.m_items_expected = 0;
+      r.m_items_processed = 0;
+    }
+
+    static void set_items_expected(std::uint64_t value) {
+      instance().m_items_expected = value;
+    }
+
+    static void set_items_processed(std::uint64_t value) {
+      instance().m_items_processed = value;
+    }
+
+    static void add_items_processed(std::uint64_t value) {
+      instance().m_items_processed += value;
+    }
+};
+
+// Counts the items processed in the main loop of a
+// phase and publishes the count every 2^16 items.
+class progress_counter {
+  private:
+    static const std::uint64_t k_publish_mask = (1UL << 16) - 1;
+    std::uint64_t m_count;
+
+  public:
+    progress_counter(std::uint64_t items_expected)
+      : m_count(0) {
+      progress_reporter::set_items_expected(items_expected);
+    }
+
+    inline void increment() {
+      if (((++m_count) & k_publish_mask) == 0)
+        progress_reporter::set_items_processed(m_count);
+    }
+};
+
+}  // namespace fsais_private
+
+#endif  // __FSAIS_SRC_PROGRESS_REPORTER_HPP_INCLUDED
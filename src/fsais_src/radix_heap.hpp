@@ -43,6 +43,8 @@
 #include <numeric>
 #include <algorithm>
 
+#include "page_arena.hpp"
+#include "heap_stats.hpp"
 #include "utils.hpp"
 
 
@@ -84,6 +86,9 @@ class radix_heap {
   private:
     typedef packed_pair<key_type, value_type> pair_type;
 
+  public:
+    typedef page_arena<pair_type> arena_type;
+
   private:
     std::uint64_t m_size;
     std::uint64_t m_key_lower_bound;
@@ -106,73 +111,60 @@ class radix_heap {
     std::vector<std::uint64_t> m_level_ptr;
 
     // Internal queues.
-    std::uint64_t m_empty_pages_list_head;
-    std::uint64_t *m_pages_next;
-    pair_type *m_pages_mem;
+    arena_type *m_arena;
+    bool m_owns_arena;
     queue_header *m_queue_headers;
 
+#ifdef MONITOR_HEAP_STATS
+    heap_stats m_stats;
+#endif
+
   private:
     inline bool is_internal_queue_empty(std::uint64_t queue_id) const {
       queue_header &h = m_queue_headers[queue_id];
-      return (h.m_tail_page_id == std::numeric_limits<std::uint64_t>::max()) ||
+      return (h.m_tail_page_id == arena_type::k_null_page) ||
         (h.m_tail_page_id == h.m_head_page_id && h.m_tail_ptr == h.m_head_ptr);
     }
 
     inline pair_type& internal_queue_front(std::uint64_t queue_id) const {
       queue_header &h = m_queue_headers[queue_id];
-      return m_pages_mem[h.m_tail_page_id * m_pagesize + h.m_tail_ptr];
+      return m_arena->item(h.m_tail_page_id, h.m_tail_ptr);
     }
 
     inline void internal_queue_pop(std::uint64_t queue_id) {
       queue_header &h = m_queue_headers[queue_id];
       ++h.m_tail_ptr;
       if (h.m_tail_ptr == m_pagesize) {
-        std::uint64_t next_tail_page_id = m_pages_next[h.m_tail_page_id];
-        m_pages_next[h.m_tail_page_id] = m_empty_pages_list_head;
-        m_empty_pages_list_head = h.m_tail_page_id;
+        std::uint64_t next_tail_page_id = m_arena->next_page(h.m_tail_page_id);
+        m_arena->release_page(h.m_tail_page_id);
         h.m_tail_page_id = next_tail_page_id;
         h.m_tail_ptr = 0;
       } else if (h.m_tail_ptr == h.m_head_ptr && h.m_tail_page_id == h.m_head_page_id) {
-        m_pages_next[h.m_tail_page_id] = m_empty_pages_list_head;
-        m_empty_pages_list_head = h.m_tail_page_id;
-        h.m_tail_page_id = std::numeric_limits<std::uint64_t>::max();
-        h.m_head_page_id = std::numeric_limits<std::uint64_t>::max();
+        m_arena->release_page(h.m_tail_page_id);
+        h.m_tail_page_id = arena_type::k_null_page;
+        h.m_head_page_id = arena_type::k_null_page;
       }
     }
 
     inline void internal_queue_push(std::uint64_t queue_id, pair_type x) {
       queue_header &h = m_queue_headers[queue_id];
-      if (h.m_head_page_id == std::numeric_limits<std::uint64_t>::max()) {
-        h.m_head_page_id = m_empty_pages_list_head;
-        m_empty_pages_list_head = m_pages_next[m_empty_pages_list_head];
-        m_pages_next[h.m_head_page_id] = std::numeric_limits<std::uint64_t>::max();
+      if (h.m_head_page_id == arena_type::k_null_page) {
+        h.m_head_page_id = m_arena->get_page();
         h.m_tail_page_id = h.m_head_page_id;
         h.m_head_ptr = 0;
         h.m_tail_ptr = 0;
       }
 
-      m_pages_mem[h.m_head_page_id * m_pagesize + h.m_head_ptr++] = x;
+      m_arena->item(h.m_head_page_id, h.m_head_ptr++) = x;
       if (h.m_head_ptr == m_pagesize) {
-        std::uint64_t new_head_page_id = m_empty_pages_list_head;
-        m_empty_pages_list_head = m_pages_next[m_empty_pages_list_head];
-        m_pages_next[new_head_page_id] = std::numeric_limits<std::uint64_t>::max();
-        m_pages_next[h.m_head_page_id] = new_head_page_id;
+        std::uint64_t new_head_page_id = m_arena->get_page();
+        m_arena->set_next_page(h.m_head_page_id, new_head_page_id);
         h.m_head_page_id = new_head_page_id;
         h.m_head_ptr = 0;
       }
     }
 
-  public:
-    radix_heap(std::vector<std::uint64_t> radix_logs,
-        std::uint64_t max_items,
-        std::uint64_t pagesize =
-#ifdef SAIS_DEBUG
-          (std::uint64_t)1
-#else
-          (std::uint64_t)4096
-#endif
-        ) {
-      m_pagesize = pagesize;
+    void init(std::vector<std::uint64_t> &radix_logs) {
       std::uint64_t radix_logs_sum = std::accumulate(radix_logs.begin(), radix_logs.end(), 0UL);
       if (radix_logs_sum == 0) {
         fprintf(stderr, "\nError: radix_logs_sum == 0 in radix_heap constructor!\n");
@@ -220,24 +212,61 @@ class radix_heap {
       m_queue_count = sum_of_radixes - (radix_logs.size() - 1);
       m_queue_min = std::vector<std::uint64_t>(m_queue_count,
           std::numeric_limits<std::uint64_t>::max());
-      std::uint64_t n_pages = max_items / m_pagesize +
-        (std::uint64_t)2 * m_queue_count;
-
-      m_pages_mem = utils::allocate_array<pair_type>(n_pages * m_pagesize);
-      m_pages_next = utils::allocate_array<std::uint64_t>(n_pages);
       m_queue_headers = utils::allocate_array<queue_header>(m_queue_count);
-      m_empty_pages_list_head = 0;
 
       for (std::uint64_t i = 0; i < m_queue_count; ++i) {
         queue_header &h = m_queue_headers[i];
-        h.m_tail_page_id = std::numeric_limits<std::uint64_t>::max();
-        h.m_head_page_id = std::numeric_limits<std::uint64_t>::max();
+        h.m_tail_page_id = arena_type::k_null_page;
+        h.m_head_page_id = arena_type::k_null_page;
       }
 
-      for (std::uint64_t i = 0; i < n_pages; ++i) {
-        if (i + 1 != n_pages) m_pages_next[i] = i + 1;
-        else m_pages_next[i] = std::numeric_limits<std::uint64_t>::max();
-      }
+#ifdef MONITOR_HEAP_STATS
+      std::vector<std::uint64_t> queue_level(m_queue_count, 0UL);
+      for (std::uint64_t level = 1; level < radix_logs.size(); ++level)
+        for (std::uint64_t id = m_sum_of_radixes[level] + 1;
+            id < m_sum_of_radixes[level + 1] + 1; ++id)
+          queue_level[id] = level;
+      m_stats.init("radix_heap", queue_level);
+#endif
+    }
+
+  public:
+    static std::uint64_t default_pagesize() {
+#ifdef SAIS_DEBUG
+      return (std::uint64_t)1;
+#else
+      return (std::uint64_t)4096;
+#endif
+    }
+
+    // Return the number of internal queues of the heap
+    // with the given radix_logs (used to size the arena).
+    static std::uint64_t queue_count(std::vector<std::uint64_t> &radix_logs) {
+      std::uint64_t sum_of_radixes = 0;
+      for (std::uint64_t i = 0; i < radix_logs.size(); ++i)
+        sum_of_radixes += (1UL << radix_logs[i]);
+      return sum_of_radixes - (radix_logs.size() - 1);
+    }
+
+    radix_heap(std::vector<std::uint64_t> radix_logs,
+        std::uint64_t max_items,
+        std::uint64_t pagesize = default_pagesize()) {
+      init(radix_logs);
+      m_arena = new arena_type(max_items, m_queue_count, pagesize);
+      m_owns_arena = true;
+      m_pagesize = m_arena->pagesize();
+    }
+
+    // Use the pages from the (externally owned) arena. The arena
+    // has to be created for at least queue_count(radix_logs)
+    // queues and the number of items ever stored in the heap.
+    radix_heap(std::vector<std::uint64_t> radix_logs,
+        arena_type *arena) {
+      init(radix_logs);
+      m_arena = arena;
+      m_arena->reset();
+      m_owns_arena = false;
+      m_pagesize = m_arena->pagesize();
     }
 
   private:
@@ -260,6 +289,9 @@ class radix_heap {
       internal_queue_push(id, pair_type(key, value));
       m_queue_min[id] = std::min(m_queue_min[id], (std::uint64_t)key);
       m_min_compare_ptr = std::min(m_min_compare_ptr, id);
+#ifdef MONITOR_HEAP_STATS
+      m_stats.push(id);
+#endif
     }
 
     // Return true iff x <= key, where x is the
@@ -281,6 +313,9 @@ class radix_heap {
         redistribute();
       pair_type p = internal_queue_front(m_bottom_level_queue_ptr);
       internal_queue_pop(m_bottom_level_queue_ptr);
+#ifdef MONITOR_HEAP_STATS
+      m_stats.pop(m_bottom_level_queue_ptr);
+#endif
       key_type key = p.first;
       value_type value = p.second;
       --m_size;
@@ -295,10 +330,23 @@ class radix_heap {
       return m_size == 0;
     }
 
+    // Name of the phase using the heap, reported
+    // together with the MONITOR_HEAP_STATS counters.
+    void set_phase_name(std::string phase_name) {
+#ifdef MONITOR_HEAP_STATS
+      m_stats.set_phase_name(phase_name);
+#else
+      (void) phase_name;
+#endif
+    }
+
     ~radix_heap() {
-      utils::deallocate(m_pages_mem);
-      utils::deallocate(m_pages_next);
+#ifdef MONITOR_HEAP_STATS
+      m_stats.print();
+#endif
       utils::deallocate(m_queue_headers);
+      if (m_owns_arena)
+        delete m_arena;
     }
 
   private:
@@ -329,13 +377,24 @@ class radix_heap {
         m_key_lower_bound = m_queue_min[id];
 
         // Redistribute elements in internal queue.
+#ifdef MONITOR_HEAP_STATS
+        std::uint64_t n_redistributed = 0;
+#endif
         while (!is_internal_queue_empty(id)) {
           pair_type p = internal_queue_front(id);
           internal_queue_pop(id);
           std::uint64_t newid = get_queue_id(p.first);
           internal_queue_push(newid, p);
           m_queue_min[newid] = std::min(m_queue_min[newid], (std::uint64_t)p.first);
+#ifdef MONITOR_HEAP_STATS
+          m_stats.remove_from_queue(id);
+          m_stats.add_to_queue(newid);
+          ++n_redistributed;
+#endif
         }
+#ifdef MONITOR_HEAP_STATS
+        m_stats.redistribute(n_redistributed);
+#endif
         m_bottom_level_queue_ptr = get_queue_id(m_key_lower_bound);
         m_queue_min[id] = std::numeric_limits<std::uint64_t>::max();
       }
@@ -0,0 +1,310 @@
+/**
+ * @file    fsais_src/sampled_sa_writer.hpp
+ * @section LICENCE
+ *
+ * This file is part of fSAIS v0.1.0
+ * See: https://github.com/dominikkempa/fsais
+ *
+ * Copyright (C) 2016-2020
+ *   Dominik Kempa <dominik.kempa (at) gmail.com>
+ *   Juha Karkkainen <juha.karkkainen (at) cs.helsinki.fi>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ **/
+
+#ifndef __FSAIS_SRC_SAMPLED_SA_WRITER_HPP_INCLUDED
+#define __FSAIS_SRC_SAMPLED_SA_WRITER_HPP_INCLUDED
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include "io/async_stream_reader.hpp"
+#include "io/async_stream_writer.hpp"
+#include "io/async_multi_stream_writer.hpp"
+#include "io/async_bit_packed_stream_writer.hpp"
+#include "utils.hpp"
+
+
+namespace fsais_private {
+
+// Receives the suffixes in the lexicographical order (as computed
+// by the final inducing pass) and writes the suffix array sampled
+// by rank (SA[0], SA[k], SA[2k], ...) and/or the inverse suffix
+// array sampled by text position (ISA[0], ISA[k], ISA[2k], ...).
+// Sample rate k = 1 gives the full SA/ISA. The ISA samples are
+// distributed into blocks (of max_isa_block_size samples) during
+// the pass and permuted into text order by finish(). The
+// entries are written either as text_offset_type integers or
+// bit-packed using ceil(log2(text_length)) bits each. Given the
+// starting positions of documents in the text, the writer also
+// writes the document array, i.e., the id of the document
+// containing each of the written SA samples. Given the bit vector
+// of text positions (bit i of word i / 64 is set if position i is
+// selected), only the SA entries with selected positions are
+// written (the sparse suffix array).
+template<typename text_offset_type>
+class sampled_sa_writer {
+  private:
+    typedef async_stream_writer<text_offset_type> sa_writer_type;
+    typedef async_multi_stream_writer<text_offset_type> isa_pairs_writer_type;
+    typedef async_bit_packed_stream_writer packed_writer_type;
+
+    std::uint64_t m_text_length;
+    std::uint64_t m_sample_rate;
+    std::uint64_t m_rank;
+    std::uint64_t m_next_sample_rank;
+    std::uint64_t m_max_isa_block_size;
+    std::uint64_t m_io_volume;
+    bool m_pack_output;
+    std::string m_isa_filename;
+    std::vector<std::string> m_isa_pairs_filenames;
+    const std::vector<std::uint64_t> *m_doc_starts;
+    const std::uint64_t *m_sa_positions;
+
+    sa_writer_type *m_sa_writer;
+    packed_writer_type *m_packed_sa_writer;
+    isa_pairs_writer_type *m_isa_pairs_writer;
+    sa_writer_type *m_da_writer;
+    packed_writer_type *m_packed_da_writer;
+
+    void write_document_id(std::uint64_t pos) {
+      std::uint64_t doc_id = (std::upper_bound(m_doc_starts->begin(),
+            m_doc_starts->end(), pos) - m_doc_starts->begin()) - 1;
+      if (m_da_writer != NULL)
+        m_da_writer->write(doc_id);
+      else m_packed_da_writer->write(doc_id);
+    }
+
+    void write_isa_sample(std::uint64_t pos) {
+      std::uint64_t sample_id = pos / m_sample_rate;
+      if (sample_id * m_sample_rate == pos) {
+        std::uint64_t block_id = sample_id / m_max_isa_block_size;
+        m_isa_pairs_writer->write_to_ith_file(block_id, sample_id - block_id * m_max_isa_block_size);
+        m_isa_pairs_writer->write_to_ith_file(block_id, m_rank);
+      }
+    }
+
+  public:
+    static std::uint64_t n_samples(std::uint64_t text_length,
+        std::uint64_t sample_rate) {
+      return (text_length + sample_rate - 1) / sample_rate;
+    }
+
+    static std::uint64_t n_selected(std::uint64_t text_length,
+        const std::uint64_t *sa_positions) {
+      std::uint64_t n = 0;
+      for (std::uint64_t i = 0; i < (text_length + 63) / 64; ++i)
+        n += __builtin_popcountll(sa_positions[i]);
+      return n;
+    }
+
+    // Size of the file storing the SA or ISA samples.
+    static std::uint64_t output_file_size(std::uint64_t text_length,
+        std::uint64_t sample_rate, bool pack_output,
+        const std::uint64_t *sa_positions = NULL) {
+      std::uint64_t n = (sa_positions != NULL) ?
+        n_selected(text_length, sa_positions) :
+        n_samples(text_length, sample_rate);
+      if (pack_output)
+        return packed_writer_type::file_size(n, packed_writer_type::bits_for(text_length));
+      else return n * sizeof(text_offset_type);
+    }
+
+    // Size of the file storing the document array.
+    static std::uint64_t document_array_file_size(std::uint64_t text_length,
+        std::uint64_t sample_rate, std::uint64_t n_docs, bool pack_output) {
+      std::uint64_t n = n_samples(text_length, sample_rate);
+      if (pack_output)
+        return packed_writer_type::file_size(n, packed_writer_type::bits_for(n_docs));
+      else return n * sizeof(text_offset_type);
+    }
+
+    // Empty sa_filename (isa_filename, da_filename) disables the
+    // SA (ISA, document array) output. The document array requires
+    // doc_starts, the sorted starting positions of documents. The
+    // bit vector sa_positions (if not NULL) requires sample_rate = 1
+    // and disables the ISA and document array output.
+    sampled_sa_writer(
+        std::uint64_t text_length,
+        std::uint64_t sample_rate,
+        std::uint64_t max_isa_block_size,
+        std::string sa_filename,
+        std::string isa_filename,
+        std::uint64_t buf_size,
+        bool pack_output = false,
+        std::string da_filename = std::string(""),
+        const std::vector<std::uint64_t> *doc_starts = NULL,
+        const std::uint64_t *sa_positions = NULL) {
+      m_text_length = text_length;
+      m_sample_rate = sample_rate;
+      m_rank = 0;
+      m_next_sample_rank = 0;
+      m_max_isa_block_size = max_isa_block_size;
+      m_io_volume = 0;
+      m_pack_output = pack_output;
+      m_isa_filename = isa_filename;
+      m_sa_writer = NULL;
+      m_packed_sa_writer = NULL;
+      m_isa_pairs_writer = NULL;
+      m_doc_starts = NULL;
+      m_sa_positions = sa_positions;
+      m_da_writer = NULL;
+      m_packed_da_writer = NULL;
+
+      if (!sa_filename.empty()) {
+        if (pack_output)
+          m_packed_sa_writer = new packed_writer_type(sa_filename, (sa_positions != NULL) ?
+              n_selected(text_length, sa_positions) : n_samples(text_length, sample_rate),
+              packed_writer_type::bits_for(text_length), 4UL * buf_size, 4UL);
+        else m_sa_writer = new sa_writer_type(sa_filename, 4UL * buf_size, 4UL);
+      }
+      if (!da_filename.empty()) {
+        m_doc_starts = doc_starts;
+        if (pack_output)
+          m_packed_da_writer = new packed_writer_type(da_filename, n_samples(text_length, sample_rate),
+              packed_writer_type::bits_for(doc_starts->size()), 4UL * buf_size, 4UL);
+        else m_da_writer = new sa_writer_type(da_filename, 4UL * buf_size, 4UL);
+      }
+      if (!isa_filename.empty()) {
+        std::uint64_t n_isa_blocks = (n_samples(text_length, sample_rate) +
+            max_isa_block_size - 1) / max_isa_block_size;
+        m_isa_pairs_filenames.resize(n_isa_blocks);
+        m_isa_pairs_writer = new isa_pairs_writer_type(n_isa_blocks, buf_size, 4UL);
+        for (std::uint64_t block_id = 0; block_id < n_isa_blocks; ++block_id) {
+          m_isa_pairs_filenames[block_id] = isa_filename + "tmp." + utils::random_string_hash();
+          m_isa_pairs_writer->add_file(m_isa_pairs_filenames[block_id]);
+        }
+      }
+    }
+
+    inline void write(std::uint64_t pos) {
+      if (m_sa_positions != NULL) {
+        if (m_sa_positions[pos >> 6] & (1UL << (pos & 63))) {
+          if (m_sa_writer != NULL)
+            m_sa_writer->write(pos);
+          else if (m_packed_sa_writer != NULL)
+            m_packed_sa_writer->write(pos);
+        }
+        return;
+      }
+      if (m_rank == m_next_sample_rank) {
+        if (m_sa_writer != NULL)
+          m_sa_writer->write(pos);
+        else if (m_packed_sa_writer != NULL)
+          m_packed_sa_writer->write(pos);
+        if (m_doc_starts != NULL)
+          write_document_id(pos);
+        m_next_sample_rank += m_sample_rate;
+      }
+      if (m_isa_pairs_writer != NULL)
+        write_isa_sample(pos);
+      ++m_rank;
+    }
+
+    // Flush the SA samples and write the ISA samples in text order.
+    void finish() {
+      if (m_sa_writer != NULL) {
+        m_io_volume += m_sa_writer->bytes_written();
+        delete m_sa_writer;
+        m_sa_writer = NULL;
+      }
+      if (m_packed_sa_writer != NULL) {
+        m_io_volume += m_packed_sa_writer->bytes_written();
+        delete m_packed_sa_writer;
+        m_packed_sa_writer = NULL;
+      }
+      if (m_da_writer != NULL) {
+        m_io_volume += m_da_writer->bytes_written();
+        delete m_da_writer;
+        m_da_writer = NULL;
+      }
+      if (m_packed_da_writer != NULL) {
+        m_io_volume += m_packed_da_writer->bytes_written();
+        delete m_packed_da_writer;
+        m_packed_da_writer = NULL;
+      }
+      if (m_isa_pairs_writer == NULL)
+        return;
+
+      m_io_volume += m_isa_pairs_writer->bytes_written();
+      delete m_isa_pairs_writer;
+      m_isa_pairs_writer = NULL;
+
+      std::uint64_t isa_n_samples = n_samples(m_text_length, m_sample_rate);
+      text_offset_type *block_isa = utils::allocate_array<text_offset_type>(
+          std::min(m_max_isa_block_size, isa_n_samples));
+      sa_writer_type *isa_writer = NULL;
+      packed_writer_type *packed_isa_writer = NULL;
+      if (m_pack_output)
+        packed_isa_writer = new packed_writer_type(m_isa_filename, isa_n_samples,
+            packed_writer_type::bits_for(m_text_length), (4UL << 20), 4UL);
+      else isa_writer = new sa_writer_type(m_isa_filename, (4UL << 20), 4UL);
+      for (std::uint64_t block_id = 0; block_id < m_isa_pairs_filenames.size(); ++block_id) {
+        std::uint64_t block_beg = block_id * m_max_isa_block_size;
+        std::uint64_t block_end = std::min(block_beg + m_max_isa_block_size, isa_n_samples);
+
+        typedef async_stream_reader<text_offset_type> isa_pairs_reader_type;
+        isa_pairs_reader_type *isa_pairs_reader =
+          new isa_pairs_reader_type(m_isa_pairs_filenames[block_id], (4UL << 20), 4UL);
+        for (std::uint64_t j = block_beg; j < block_end; ++j) {
+          std::uint64_t block_offset = isa_pairs_reader->read();
+          block_isa[block_offset] = isa_pairs_reader->read();
+        }
+        isa_pairs_reader->stop_reading();
+        m_io_volume += isa_pairs_reader->bytes_read();
+        delete isa_pairs_reader;
+        utils::file_delete(m_isa_pairs_filenames[block_id]);
+
+        if (m_pack_output) {
+          for (std::uint64_t j = 0; j < block_end - block_beg; ++j)
+            packed_isa_writer->write(block_isa[j]);
+        } else {
+          for (std::uint64_t j = 0; j < block_end - block_beg; ++j)
+            isa_writer->write(block_isa[j]);
+        }
+      }
+      if (m_pack_output) {
+        m_io_volume += packed_isa_writer->bytes_written();
+        delete packed_isa_writer;
+      } else {
+        m_io_volume += isa_writer->bytes_written();
+        delete isa_writer;
+      }
+      utils::deallocate(block_isa);
+    }
+
+    inline std::uint64_t io_volume() const {
+      return m_io_volume;
+    }
+
+    ~sampled_sa_writer() {
+      finish();
+    }
+};
+
+}  // namespace fsais_private
+
+#endif  // __FSAIS_SRC_SAMPLED_SA_WRITER_HPP_INCLUDED
@@ -40,10 +40,15 @@
 #include <sys/time.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sched.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <string>
+#include <vector>
 #include <mutex>
+#include <atomic>
 #include <fstream>
 #include <algorithm>
 
@@ -53,25 +58,129 @@
 namespace fsais_private {
 namespace utils {
 
-std::mutex io_mutex;
-std::mutex allocator_mutex;
-std::uint64_t current_ram_allocation;
-std::uint64_t current_io_volume;
-std::uint64_t current_disk_allocation;
-std::uint64_t peak_ram_allocation;
-std::uint64_t peak_disk_allocation;
+std::atomic<std::uint64_t> current_ram_allocation(0);
+std::atomic<std::uint64_t> current_io_volume(0);
+std::atomic<std::uint64_t> current_disk_allocation(0);
+std::atomic<std::uint64_t> peak_ram_allocation(0);
+std::atomic<std::uint64_t> peak_disk_allocation(0);
+std::atomic<std::uint64_t> phase_peak_ram_allocation(0);
+std::atomic<std::uint64_t> phase_peak_disk_allocation(0);
+std::atomic<std::uint64_t> total_bytes_read(0);
+std::atomic<std::uint64_t> total_bytes_written(0);
+std::atomic<std::uint64_t> ram_limit(0);
+std::atomic<std::uint64_t> huge_pages_mode(huge_pages_none);
+std::atomic<std::uint64_t> huge_pages_threshold(default_huge_pages_threshold);
+std::atomic<std::uint64_t> numa_policy(numa_none);
+std::atomic<std::uint64_t> numa_nodes(1);
+
+// The 8 bytes preceding each allocated array store its size. For
+// arrays allocated with mmap, the two highest bits of the size are
+// set to mark the mapping and its kind.
+static const std::uint64_t mmap_flag = (1UL << 63);
+static const std::uint64_t hugetlb_flag = (1UL << 62);
+static const std::uint64_t huge_page_size = (2UL << 20);
+
+// Value of MPOL_PREFERRED from <numaif.h> (not included to avoid
+// the dependency on libnuma).
+static const std::uint64_t mpol_preferred = 1;
+
+void atomic_max(std::atomic<std::uint64_t> &x,
+    const std::uint64_t value) {
+  std::uint64_t cur = x.load(std::memory_order_relaxed);
+  while (cur < value && !x.compare_exchange_weak(cur, value,
+        std::memory_order_relaxed));
+}
+
+void ram_limit_exceeded(const std::uint64_t bytes,
+    const std::uint64_t limit) {
+  fprintf(stderr, "\nError: allocation of %lu bytes exceeds the "
+      "RAM limit (cur = %lu bytes, limit = %lu bytes)\n"
+      "Consider decreasing the RAM used for computation.\n",
+      bytes, (std::uint64_t)current_ram_allocation, limit);
+  std::exit(EXIT_FAILURE);
+}
+
+// Return the length of the mapping storing an array of given size.
+std::uint64_t mapped_length(const std::uint64_t bytes,
+    const bool hugetlb) {
+  const std::uint64_t page_size = hugetlb ?
+    huge_page_size : (std::uint64_t)sysconf(_SC_PAGESIZE);
+  return ((bytes + 8 + page_size - 1) / page_size) * page_size;
+}
+
+// In the local NUMA policy, place the pages of the mapping on the
+// node of the calling thread.
+void place_on_local_node(std::uint8_t * const ptr,
+    const std::uint64_t length, const bool is_numa_local) {
+  if (is_numa_local && !numa_bind(ptr, length, numa_current_node()))
+    numa_first_touch(ptr, length);
+}
+
+// Map the memory for an array of given size (including the 8-byte
+// header) and set the header flags. Return NULL if the array should
+// be allocated with malloc.
+std::uint8_t *map_array(const std::uint64_t bytes,
+    std::uint64_t &flags) {
+  const std::uint64_t mode = huge_pages_mode;
+  const bool is_numa_local = (numa_policy == numa_local && numa_nodes > 1);
+  if ((mode == huge_pages_none && !is_numa_local) ||
+      bytes < huge_pages_threshold)
+    return NULL;
+
+#ifdef MAP_HUGETLB
+  if (mode == huge_pages_hugetlb) {
+    const std::uint64_t length = mapped_length(bytes, true);
+    void * const ptr = mmap(NULL, length, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (ptr != MAP_FAILED) {
+      place_on_local_node((std::uint8_t *)ptr, length, is_numa_local);
+      flags = mmap_flag | hugetlb_flag;
+      return (std::uint8_t *)ptr;
+    }
+  }
+#endif
+
+  // Fall back to transparent huge pages. The mapping is
+  // over-allocated and trimmed to start at a huge page boundary,
+  // so that the whole array can be backed by huge pages.
+  const std::uint64_t length = mapped_length(bytes, false);
+  void * const ptr = mmap(NULL, length + huge_page_size,
+      PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (ptr == MAP_FAILED)
+    return NULL;
+  std::uint8_t * const beg = (std::uint8_t *)ptr;
+  std::uint8_t * const aligned_beg = (std::uint8_t *)
+    ((((std::uint64_t)beg + huge_page_size - 1) / huge_page_size) *
+     huge_page_size);
+  const std::uint64_t head = aligned_beg - beg;
+  if (head > 0)
+    munmap(beg, head);
+  munmap(aligned_beg + length, huge_page_size - head);
+#ifdef MADV_HUGEPAGE
+  if (mode != huge_pages_none)
+    madvise(aligned_beg, length, MADV_HUGEPAGE);
+#endif
+  place_on_local_node(aligned_beg, length, is_numa_local);
+  flags = mmap_flag;
+  return aligned_beg;
+}
 
 void *allocate(const std::uint64_t bytes) {
-  std::lock_guard<std::mutex> lk(allocator_mutex);
-  std::uint8_t * const ptr =
-    (std::uint8_t *)malloc(bytes + 8);
+  const std::uint64_t cur = current_ram_allocation.fetch_add(bytes) + bytes;
+  const std::uint64_t limit = ram_limit;
+  if (limit > 0 && cur > limit) {
+    current_ram_allocation.fetch_sub(bytes);
+    ram_limit_exceeded(bytes, limit);
+  }
+  atomic_max(peak_ram_allocation, cur);
+  atomic_max(phase_peak_ram_allocation, cur);
+  std::uint64_t flags = 0;
+  std::uint8_t *ptr = map_array(bytes, flags);
+  if (ptr == NULL)
+    ptr = (std::uint8_t *)malloc(bytes + 8);
   std::uint64_t * const ptr64 = (std::uint64_t *)ptr;
-  *ptr64 = bytes;
+  *ptr64 = bytes | flags;
   std::uint8_t * const ret = ptr + 8;
-  current_ram_allocation += bytes;
-  peak_ram_allocation =
-    std::max(peak_ram_allocation,
-        current_ram_allocation);
   return (void *)ret;
 }
 
@@ -90,12 +199,14 @@ void *aligned_allocate(
 }
 
 void deallocate(const void * const tab) {
-  std::lock_guard<std::mutex> lk(allocator_mutex);
   std::uint8_t * const ptr = (std::uint8_t *)tab - 8;
   const std::uint64_t * const ptr64 = (std::uint64_t *)ptr;
-  const std::uint64_t bytes = *ptr64;
-  current_ram_allocation -= bytes;
-  free(ptr);
+  const std::uint64_t flags = *ptr64 & (mmap_flag | hugetlb_flag);
+  const std::uint64_t bytes = *ptr64 & ~(mmap_flag | hugetlb_flag);
+  current_ram_allocation.fetch_sub(bytes);
+  if (flags & mmap_flag)
+    munmap(ptr, mapped_length(bytes, (flags & hugetlb_flag) != 0));
+  else free(ptr);
 }
 
 void aligned_deallocate(const void * const tab) {
@@ -110,6 +221,10 @@ void initialize_stats() {
   current_io_volume = 0;
   peak_ram_allocation = 0;
   peak_disk_allocation = 0;
+  phase_peak_ram_allocation = 0;
+  phase_peak_disk_allocation = 0;
+  total_bytes_read = 0;
+  total_bytes_written = 0;
 }
 
 std::uint64_t get_current_ram_allocation() {
@@ -132,6 +247,149 @@ std::uint64_t get_peak_disk_allocation() {
   return peak_disk_allocation;
 }
 
+std::uint64_t get_total_bytes_read() {
+  return total_bytes_read;
+}
+
+std::uint64_t get_total_bytes_written() {
+  return total_bytes_written;
+}
+
+std::uint64_t get_phase_peak_ram_allocation() {
+  return phase_peak_ram_allocation;
+}
+
+std::uint64_t get_phase_peak_disk_allocation() {
+  return phase_peak_disk_allocation;
+}
+
+void set_phase_peak_ram_allocation(const std::uint64_t value) {
+  phase_peak_ram_allocation = std::max(value,
+      (std::uint64_t)current_ram_allocation);
+}
+
+void set_phase_peak_disk_allocation(const std::uint64_t value) {
+  phase_peak_disk_allocation = std::max(value,
+      (std::uint64_t)current_disk_allocation);
+}
+
+void add_disk_allocation(const std::uint64_t bytes) {
+  const std::uint64_t cur = current_disk_allocation.fetch_add(bytes) + bytes;
+  atomic_max(peak_disk_allocation, cur);
+  atomic_max(phase_peak_disk_allocation, cur);
+}
+
+void set_ram_limit(const std::uint64_t limit) {
+  ram_limit = limit;
+}
+
+std::uint64_t get_ram_limit() {
+  return ram_limit;
+}
+
+void set_huge_pages(const huge_pages_mode_type mode,
+    const std::uint64_t threshold) {
+  huge_pages_mode = (std::uint64_t)mode;
+  huge_pages_threshold = threshold;
+}
+
+// Parse a list of the form "0-3,8,10-11" (as used in the files in
+// /sys/devices/system/node) and return the listed integers.
+std::vector<std::uint64_t> parse_sysfs_list(const std::string filename) {
+  std::vector<std::uint64_t> ret;
+  std::ifstream file(filename.c_str());
+  std::string line;
+  if (!file || !std::getline(file, line))
+    return ret;
+  std::stringstream ss(line);
+  std::string range;
+  while (std::getline(ss, range, ',')) {
+    std::uint64_t beg = 0;
+    std::uint64_t end = 0;
+    if (std::sscanf(range.c_str(), "%lu-%lu", &beg, &end) == 2) {
+      for (std::uint64_t j = beg; j <= end; ++j)
+        ret.push_back(j);
+    } else if (std::sscanf(range.c_str(), "%lu", &beg) == 1)
+      ret.push_back(beg);
+  }
+  return ret;
+}
+
+void set_numa_policy(const numa_policy_type policy) {
+  numa_nodes = numa_node_count();
+  numa_policy = (std::uint64_t)policy;
+}
+
+numa_policy_type get_numa_policy() {
+  return (numa_policy_type)(std::uint64_t)numa_policy;
+}
+
+std::uint64_t numa_node_count() {
+  std::vector<std::uint64_t> nodes =
+    parse_sysfs_list("/sys/devices/system/node/online");
+  if (nodes.empty())
+    return 1;
+  return *std::max_element(nodes.begin(), nodes.end()) + 1;
+}
+
+std::uint64_t numa_current_node() {
+#ifdef SYS_getcpu
+  unsigned cpu = 0;
+  unsigned node = 0;
+  if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0)
+    return node;
+#endif
+  return 0;
+}
+
+bool numa_bind(const void * const ptr,
+    const std::uint64_t bytes, const std::uint64_t node) {
+#ifdef SYS_mbind
+  const std::uint64_t page_size = sysconf(_SC_PAGESIZE);
+  const std::uint64_t beg = ((std::uint64_t)ptr / page_size) * page_size;
+  const std::uint64_t end = (std::uint64_t)ptr + bytes;
+  std::vector<unsigned long> nodemask(node / 64 + 1, 0UL);
+  nodemask[node / 64] = (1UL << (node % 64));
+  return syscall(SYS_mbind, beg, end - beg, mpol_preferred,
+      nodemask.data(), nodemask.size() * 64 + 1, 0) == 0;
+#else
+  (void) ptr;
+  (void) bytes;
+  (void) node;
+  return false;
+#endif
+}
+
+void numa_first_touch(void * const ptr, const std::uint64_t bytes) {
+  const std::uint64_t page_size = sysconf(_SC_PAGESIZE);
+  volatile std::uint8_t * const tab = (std::uint8_t *)ptr;
+  for (std::uint64_t j = 0; j < bytes; j += page_size)
+    tab[j] = 0;
+}
+
+numa_thread_pin::numa_thread_pin()
+  : m_pinned(false) {
+  if (numa_policy != numa_local || numa_nodes <= 1)
+    return;
+  std::vector<std::uint64_t> cpus = parse_sysfs_list(
+      "/sys/devices/system/node/node" +
+      intToStr(numa_current_node()) + "/cpulist");
+  if (cpus.empty() ||
+      sched_getaffinity(0, sizeof(m_old_mask), &m_old_mask) != 0)
+    return;
+  cpu_set_t mask;
+  CPU_ZERO(&mask);
+  for (std::uint64_t j = 0; j < cpus.size(); ++j)
+    if (cpus[j] < CPU_SETSIZE)
+      CPU_SET(cpus[j], &mask);
+  m_pinned = (sched_setaffinity(0, sizeof(mask), &mask) == 0);
+}
+
+numa_thread_pin::~numa_thread_pin() {
+  if (m_pinned)
+    sched_setaffinity(0, sizeof(m_old_mask), &m_old_mask);
+}
+
 long double wclock() {
   timeval tim;
   gettimeofday(&tim, NULL);
@@ -191,18 +449,38 @@ bool file_exists(const std::string filename) {
   return result;
 }
 
-void file_delete(const std::string filename) {
-
-#ifdef MONITOR_DISK_USAGE
-  std::lock_guard<std::mutex> lk(io_mutex);
-  current_disk_allocation -= file_size(filename);
-#endif
-
+// Delete the file and return its size.
+std::uint64_t remove_file(const std::string filename) {
+  struct stat st;
+  const int stat_res = stat(filename.c_str(), &st);
   const int res = std::remove(filename.c_str());
-  if (res != 0) {
+  if (stat_res != 0 || res != 0) {
     std::perror(filename.c_str());
     std::exit(EXIT_FAILURE);
   }
+  return st.st_size;
+}
+
+void file_delete(const std::string filename) {
+  const std::uint64_t bytes = remove_file(filename);
+
+  // Never let the counter wrap: a file with more bytes than
+  // currently allocated was not (only) written by write_to_file.
+  std::uint64_t cur = current_disk_allocation;
+  while (!current_disk_allocation.compare_exchange_weak(cur,
+        cur - std::min(cur, bytes)));
+  if (bytes > cur) {
+    fprintf(stderr, "\nWarning: deleting %s releases %lu bytes, "
+        "but only %lu bytes are allocated on disk\n",
+        filename.c_str(), bytes, cur);
+#ifdef SAIS_DEBUG
+    std::exit(EXIT_FAILURE);
+#endif
+  }
+}
+
+void file_delete_untracked(const std::string filename) {
+  remove_file(filename);
 }
 
 std::string absolute_path(std::string filename) {
@@ -217,7 +495,7 @@ std::string absolute_path(std::string filename) {
     std::exit(EXIT_FAILURE);
   }
   if (created)
-    file_delete(filename);
+    file_delete_untracked(filename);
   return std::string(path);
 }
 
@@ -299,5 +577,20 @@ std::uint64_t log2floor(const std::uint64_t x) {
   return w;
 }
 
+// Split the bits of keys in [0..key_range) into the smallest number
+// of radix heap levels of at most max_radix_log bits each, and make
+// the levels as even as possible (fewer queues than filling all
+// levels but the last one).
+std::vector<std::uint64_t> radix_logs_for_keys(
+    const std::uint64_t key_range,
+    const std::uint64_t max_radix_log) {
+  const std::uint64_t key_bits = std::max(1UL, log2ceil(key_range));
+  const std::uint64_t n_levels = (key_bits + max_radix_log - 1) / max_radix_log;
+  std::vector<std::uint64_t> radix_logs(n_levels, key_bits / n_levels);
+  for (std::uint64_t i = 0; i < key_bits % n_levels; ++i)
+    ++radix_logs[i];
+  return radix_logs;
+}
+
 }  // namespace utils
 }  // namespace fsais_private
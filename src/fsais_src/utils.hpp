@@ -38,19 +38,25 @@
 #include <cstdlib>
 #include <cstdint>
 #include <string>
+#include <vector>
 #include <mutex>
+#include <atomic>
 #include <sstream>
+#include <sched.h>
 
 
 namespace fsais_private {
 namespace utils {
 
-extern std::uint64_t current_ram_allocation;
-extern std::uint64_t current_io_volume;
-extern std::uint64_t current_disk_allocation;
-extern std::uint64_t peak_ram_allocation;
-extern std::uint64_t peak_disk_allocation;
-extern std::mutex io_mutex;
+extern std::atomic<std::uint64_t> current_ram_allocation;
+extern std::atomic<std::uint64_t> current_io_volume;
+extern std::atomic<std::uint64_t> current_disk_allocation;
+extern std::atomic<std::uint64_t> peak_ram_allocation;
+extern std::atomic<std::uint64_t> peak_disk_allocation;
+extern std::atomic<std::uint64_t> phase_peak_ram_allocation;
+extern std::atomic<std::uint64_t> phase_peak_disk_allocation;
+extern std::atomic<std::uint64_t> total_bytes_read;
+extern std::atomic<std::uint64_t> total_bytes_written;
 
 long double wclock();
 void sleep(const long double);
@@ -60,12 +66,78 @@ void *aligned_allocate(const std::uint64_t, const std::uint64_t);
 void deallocate(const void * const);
 void aligned_deallocate(const void * const);
 
+// Hard limit on the tracked RAM allocation (0 = no limit). An
+// allocation exceeding the limit prints a diagnostic (the size of
+// the allocation, the current allocation and the limit) and exits.
+void set_ram_limit(const std::uint64_t);
+std::uint64_t get_ram_limit();
+
+// Arrays of at least the threshold size are allocated with mmap
+// and backed by huge pages: reserved ones (MAP_HUGETLB) in the
+// hugetlb mode (if the reservation fails, and in the transparent
+// mode, by transparent huge pages requested with madvise). If mmap
+// fails, or in the none mode (the default), all arrays are allocated
+// with malloc.
+// The RAM accounting is the same for all allocation paths.
+enum huge_pages_mode_type {
+  huge_pages_none = 0,
+  huge_pages_transparent = 1,
+  huge_pages_hugetlb = 2
+};
+static const std::uint64_t default_huge_pages_threshold = (32UL << 20);
+void set_huge_pages(const huge_pages_mode_type,
+    const std::uint64_t = default_huge_pages_threshold);
+
+// NUMA placement (using raw system calls, without libnuma). In the
+// local policy on a multi-node machine, arrays of at least the huge
+// page threshold are mapped with mmap and bound (mbind with
+// MPOL_PREFERRED) to the node of the allocating thread or, if mbind
+// fails, initialized (first-touched) by that thread.
+enum numa_policy_type {
+  numa_none = 0,
+  numa_local = 1
+};
+void set_numa_policy(const numa_policy_type);
+numa_policy_type get_numa_policy();
+std::uint64_t numa_node_count();
+std::uint64_t numa_current_node();
+bool numa_bind(const void * const, const std::uint64_t, const std::uint64_t);
+void numa_first_touch(void * const, const std::uint64_t);
+
+// In the local policy on a multi-node machine, pin the calling
+// thread to the CPUs of the node it currently runs on, until the
+// object is destroyed. The threads started in the meantime (e.g.,
+// the I/O threads of the asynchronous streams) inherit the pinning,
+// so that all arrays and I/O buffers of a block stay on one node.
+class numa_thread_pin {
+  public:
+    numa_thread_pin();
+    ~numa_thread_pin();
+
+  private:
+    bool m_pinned;
+    cpu_set_t m_old_mask;
+};
+
 void initialize_stats();
 std::uint64_t get_current_ram_allocation();
 std::uint64_t get_peak_ram_allocation();
 std::uint64_t get_current_io_volume();
 std::uint64_t get_current_disk_allocation();
 std::uint64_t get_peak_disk_allocation();
+std::uint64_t get_total_bytes_read();
+std::uint64_t get_total_bytes_written();
+
+// Peak RAM/disk allocation since the last call to the
+// setter (used to compute the peaks of nested phases).
+std::uint64_t get_phase_peak_ram_allocation();
+std::uint64_t get_phase_peak_disk_allocation();
+void set_phase_peak_ram_allocation(const std::uint64_t);
+void set_phase_peak_disk_allocation(const std::uint64_t);
+
+// Record the bytes appended to a file (the bytes
+// are released when the file is deleted).
+void add_disk_allocation(const std::uint64_t);
 
 template<typename value_type>
 value_type *allocate_array(const std::uint64_t size) {
@@ -83,7 +155,14 @@ std::FILE *file_open(const std::string, const std::string);
 std::FILE *file_open_nobuf(const std::string, const std::string);
 std::uint64_t file_size(const std::string);
 bool file_exists(const std::string);
+// Delete a file and release its size from the disk allocation. Only
+// files written entirely using write_to_file (e.g., by the stream
+// writers) may be passed to file_delete; if the size exceeds the
+// allocation, a warning is printed and the allocation drops to zero
+// (an error with SAIS_DEBUG).
+// Files written otherwise are deleted with file_delete_untracked.
 void file_delete(const std::string);
+void file_delete_untracked(const std::string);
 std::string absolute_path(const std::string);
 void empty_page_cache(const std::string);
 std::string get_timestamp();
@@ -93,19 +172,13 @@ void write_to_file(
     const value_type * const src,
     const std::uint64_t length,
     std::FILE * const f) {
-
-#ifdef MONITOR_DISK_USAGE
-  std::lock_guard<std::mutex> lk(io_mutex);
-#endif
-
   const std::uint64_t fwrite_ret =
     std::fwrite(src, sizeof(value_type), length, f);
+  total_bytes_written += sizeof(value_type) * length;
+  add_disk_allocation(sizeof(value_type) * length);
 
-#ifdef MONITOR_DISK_USAGE
+#ifdef MONITOR_IO_VOLUME
   current_io_volume += sizeof(value_type) * length;
-  current_disk_allocation += sizeof(value_type) * length;
-  peak_disk_allocation =
-    std::max(peak_disk_allocation, current_disk_allocation);
 #endif
 
   if (fwrite_ret != length) {
@@ -119,15 +192,11 @@ void write_to_file_inplace(
     const value_type * const src,
     const std::uint64_t length,
     std::FILE * const f) {
-
-#ifdef MONITOR_DISK_USAGE
-  std::lock_guard<std::mutex> lk(io_mutex);
-#endif
-
   const std::uint64_t fwrite_ret =
     std::fwrite(src, sizeof(value_type), length, f);
+  total_bytes_written += sizeof(value_type) * length;
 
-#ifdef MONITOR_DISK_USAGE
+#ifdef MONITOR_IO_VOLUME
   current_io_volume += sizeof(value_type) * length;
 #endif
 
@@ -162,15 +231,11 @@ void read_from_file(
     value_type * const dest,
     const std::uint64_t length,
     std::FILE * const f) {
-
-#ifdef MONITOR_DISK_USAGE
-  std::lock_guard<std::mutex> lk(io_mutex);
-#endif
-
   const std::uint64_t fread_ret =
     std::fread(dest, sizeof(value_type), length, f);
+  total_bytes_read += sizeof(value_type) * length;
 
-#ifdef MONITOR_DISK_USAGE
+#ifdef MONITOR_IO_VOLUME
   current_io_volume += sizeof(value_type) * length;
 #endif
 
@@ -196,14 +261,10 @@ void read_from_file(
     const std::uint64_t max_items,
     std::uint64_t &items_read,
     std::FILE * const f) {
-
-#ifdef MONITOR_DISK_USAGE
-  std::lock_guard<std::mutex> lk(io_mutex);
-#endif
-
   items_read = std::fread(dest, sizeof(value_type), max_items, f);
+  total_bytes_read += sizeof(value_type) * items_read;
 
-#ifdef MONITOR_DISK_USAGE
+#ifdef MONITOR_IO_VOLUME
   current_io_volume += sizeof(value_type) * items_read;
 #endif
 
@@ -244,6 +305,8 @@ std::string random_string_hash();
 
 std::uint64_t log2ceil(const std::uint64_t);
 std::uint64_t log2floor(const std::uint64_t);
+std::vector<std::uint64_t> radix_logs_for_keys(const std::uint64_t,
+    const std::uint64_t);
 
 template<typename int_type>
 std::string intToStr(const int_type x) {
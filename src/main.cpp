@@ -42,6 +42,9 @@
 #include <unistd.h>
 
 #include "fsais_src/em_compute_sa.hpp"
+#include "fsais_src/em_compute_gsa.hpp"
+#include "fsais_src/em_update_sa.hpp"
+#include "fsais_src/em_compute_sparse_sa.hpp"
 #include "uint40.hpp"
 
 
@@ -56,11 +59,70 @@ void usage(int status) {
 "Mandatory arguments to long options are mandatory for short options too.\n"
 "  -h, --help              display this help and exit\n"
 "  -m, --mem=MEM           use MEM bytes of RAM for computation. Metric and IEC\n"
-"                          suffixes are recognized, e.g., -l 10k, -l 1Mi, -l 3G\n"
+"                          suffixes are recognized, e.g., -m 10k, -m 1Mi, -m 3G\n"
 "                          gives MEM = 10^4, 2^20, 3*10^6. Default: 3584Mi\n"
 "  -o, --output=OUTFILE    specify output filename. Default: FILE.saX, where\n"
 "                          X = integer size used to encode the suffix array\n"
-"                          (5 bytes by default)\n",
+"                          (5 bytes by default)\n"
+"  -j, --stats-json=FILE   write time, I/O and peak RAM/disk of every phase\n"
+"                          of the computation to FILE in JSON format\n"
+"  -L, --ram-limit=LIMIT   exit with a diagnostic if the tracked RAM allocation\n"
+"                          exceeds LIMIT bytes (suffixes as for MEM). Default:\n"
+"                          no limit\n"
+"  -p, --progress=FILE     every second, write the current phase, its progress\n"
+"                          and ETA, and the I/O volume to FILE (JSON format)\n"
+"  -b, --bwt=FILE          also write the BWT of the text to FILE (and the\n"
+"                          position of the end-of-text symbol to FILE.pidx)\n"
+"  -l, --lcp               also write the LCP array to FILE.lcpW, where W is\n"
+"                          the integer size used to encode the LCP array\n"
+"  -w, --lcp-width=W       encode the LCP array using W-byte integers (W = 1,\n"
+"                          2, 3, 4, 5, 6 or 8, larger values are saturated).\n"
+"                          Default: 5\n"
+"  -s, --sample-rate=K     write only every K-th entry of the suffix array (by\n"
+"                          rank) or of the inverse suffix array (by text\n"
+"                          position). Default: 1 (full arrays)\n"
+"  -S, --sample=WHAT       which arrays to write: sa, isa or both. The ISA is\n"
+"                          written to FILE.isaX (FILE.sisaX if K > 1), the SA\n"
+"                          to OUTFILE (default: FILE.ssaX if K > 1). Default: sa\n"
+"  -P, --packed            write the SA/ISA entries using ceil(log2 n) bits each\n"
+"                          (X = p in the default filenames)\n"
+"  -f, --file-list         FILE is a list of document filenames (one per line),\n"
+"                          compute the generalized suffix array of documents\n"
+"  -d, --doc-offsets=OFFS  FILE is a concatenation of documents starting at\n"
+"                          offsets given (in decimal) in the file OFFS,\n"
+"                          compute the generalized suffix array of documents\n"
+"  -D, --doc-array         also write the document array (for -f and -d) to\n"
+"                          FILE.daX (FILE.sdaX if K > 1)\n"
+"  -c, --compact-alphabet  remap the text to the alphabet of symbols occurring\n"
+"                          in it before the computation (one extra pass)\n"
+"  -B, --symbol-bytes=B    the text consists of B-byte symbols (B = 1, 2 or 4,\n"
+"                          little-endian). Default: 1\n"
+"  -a, --alphabet-size=SIGMA  all symbols are smaller than SIGMA. Default: 256\n"
+"                          for B = 1, otherwise detected by a scan of FILE\n"
+"  -u, --update=OLDSA      FILE was obtained by appending symbols to the text\n"
+"                          with the suffix array stored in OLDSA, compute the\n"
+"                          suffix array of FILE by sorting only the suffixes\n"
+"                          affected by appending and merging them into OLDSA\n"
+"  -k, --sparse=K          compute the sparse suffix array containing only the\n"
+"                          suffixes starting at positions 0, K, 2K, ..., and\n"
+"                          write it to OUTFILE (default: FILE.spsaX)\n"
+"  -K, --sparse-positions=BITS  compute the sparse suffix array containing only\n"
+"                          the suffixes starting at positions i such that bit\n"
+"                          i %% 8 of byte i / 8 of the file BITS is set\n"
+"  -C, --calibrate=PROFILE measure the disk bandwidth (using a temporary file\n"
+"                          in the directory of PROFILE) and the CPU throughput,\n"
+"                          save the results to PROFILE and exit (FILE is not\n"
+"                          needed)\n"
+"  -H, --profile=PROFILE   choose the I/O request sizes and the RAM split\n"
+"                          between the I/O buffers and the radix heap using\n"
+"                          the hardware profile stored in PROFILE\n"
+"  -T, --huge-pages=MODE   back the arrays of at least 32MiB by huge pages:\n"
+"                          none, thp (transparent huge pages) or hugetlb\n"
+"                          (reserved huge pages, falls back to thp if none\n"
+"                          are available). Default: none\n"
+"  -N, --numa-local        on multi-socket machines, keep the arrays of at\n"
+"                          least 32MiB and the threads processing the text\n"
+"                          blocks in RAM on the NUMA node of the thread\n",
 
     program_name);
 
@@ -144,18 +206,64 @@ int main(int argc, char **argv) {
   program_name = argv[0];
 
   static struct option long_options[] = {
-    {"help",     no_argument,       NULL, 'h'},
-    {"mem",      required_argument, NULL, 'm'},
-    {"output",   required_argument, NULL, 'o'},
-    {NULL,       0,                 NULL, 0}
+    {"help",       no_argument,       NULL, 'h'},
+    {"mem",        required_argument, NULL, 'm'},
+    {"output",     required_argument, NULL, 'o'},
+    {"stats-json", required_argument, NULL, 'j'},
+    {"ram-limit",  required_argument, NULL, 'L'},
+    {"progress",   required_argument, NULL, 'p'},
+    {"bwt",        required_argument, NULL, 'b'},
+    {"lcp",        no_argument,       NULL, 'l'},
+    {"lcp-width",  required_argument, NULL, 'w'},
+    {"sample-rate", required_argument, NULL, 's'},
+    {"sample",     required_argument, NULL, 'S'},
+    {"packed",     no_argument,       NULL, 'P'},
+    {"file-list",  no_argument,       NULL, 'f'},
+    {"doc-offsets", required_argument, NULL, 'd'},
+    {"doc-array",  no_argument,       NULL, 'D'},
+    {"compact-alphabet", no_argument, NULL, 'c'},
+    {"symbol-bytes", required_argument, NULL, 'B'},
+    {"alphabet-size", required_argument, NULL, 'a'},
+    {"update",     required_argument, NULL, 'u'},
+    {"sparse",     required_argument, NULL, 'k'},
+    {"sparse-positions", required_argument, NULL, 'K'},
+    {"calibrate",  required_argument, NULL, 'C'},
+    {"profile",    required_argument, NULL, 'H'},
+    {"huge-pages", required_argument, NULL, 'T'},
+    {"numa-local", no_argument,       NULL, 'N'},
+    {NULL,         0,                 NULL, 0}
   };
 
   std::uint64_t ram_use = ((std::uint64_t)3584 << 20);
   std::string output_filename("");
+  std::string stats_json_filename("");
+  std::string progress_filename("");
+  std::string bwt_filename("");
+  bool compute_lcp = false;
+  std::uint64_t lcp_width = 5;
+  std::uint64_t sample_rate = 1;
+  bool write_sa = true;
+  bool write_isa = false;
+  bool pack_output = false;
+  bool file_list = false;
+  std::string offsets_filename("");
+  bool write_da = false;
+  bool compact_alphabet = false;
+  std::uint64_t symbol_bytes = 1;
+  std::uint64_t text_alphabet_size = 0;
+  std::string old_sa_filename("");
+  std::uint64_t sparse_rate = 0;
+  std::string sparse_positions_filename("");
+  std::string calibrate_filename("");
+  std::string profile_filename("");
+  std::uint64_t ram_limit = 0;
+  fsais_private::utils::huge_pages_mode_type huge_pages =
+    fsais_private::utils::huge_pages_none;
+  bool numa_local = false;
 
   // Parse command-line options.
   int c;
-  while ((c = getopt_long(argc, argv, "hm:o:",
+  while ((c = getopt_long(argc, argv, "hm:o:j:L:p:b:lw:s:S:Pfd:DcB:a:u:k:K:C:H:T:N",
           long_options, NULL)) != -1) {
     switch(c) {
       case 'h':
@@ -178,12 +286,141 @@ int main(int argc, char **argv) {
       case 'o':
         output_filename = std::string(optarg);
         break;
+      case 'j':
+        stats_json_filename = std::string(optarg);
+        break;
+      case 'p':
+        progress_filename = std::string(optarg);
+        break;
+      case 'b':
+        bwt_filename = std::string(optarg);
+        break;
+      case 'l':
+        compute_lcp = true;
+        break;
+      case 'w':
+        {
+          bool ok = parse_number(optarg, &lcp_width);
+          if (!ok || lcp_width == 0 || lcp_width == 7 || lcp_width > 8) {
+            fprintf(stderr, "Error: invalid LCP integer "
+                "width (%s)\n\n", optarg);
+            usage(EXIT_FAILURE);
+          }
+          break;
+        }
+      case 's':
+        {
+          bool ok = parse_number(optarg, &sample_rate);
+          if (!ok || sample_rate == 0) {
+            fprintf(stderr, "Error: invalid sample rate (%s)\n\n", optarg);
+            usage(EXIT_FAILURE);
+          }
+          break;
+        }
+      case 'P':
+        pack_output = true;
+        break;
+      case 'f':
+        file_list = true;
+        break;
+      case 'd':
+        offsets_filename = std::string(optarg);
+        break;
+      case 'D':
+        write_da = true;
+        break;
+      case 'c':
+        compact_alphabet = true;
+        break;
+      case 'B':
+        {
+          bool ok = parse_number(optarg, &symbol_bytes);
+          if (!ok || (symbol_bytes != 1 && symbol_bytes != 2 && symbol_bytes != 4)) {
+            fprintf(stderr, "Error: invalid symbol size (%s)\n\n", optarg);
+            usage(EXIT_FAILURE);
+          }
+          break;
+        }
+      case 'a':
+        {
+          bool ok = parse_number(optarg, &text_alphabet_size);
+          if (!ok || text_alphabet_size == 0) {
+            fprintf(stderr, "Error: invalid alphabet size (%s)\n\n", optarg);
+            usage(EXIT_FAILURE);
+          }
+          break;
+        }
+      case 'u':
+        old_sa_filename = std::string(optarg);
+        break;
+      case 'k':
+        {
+          bool ok = parse_number(optarg, &sparse_rate);
+          if (!ok || sparse_rate == 0) {
+            fprintf(stderr, "Error: invalid sparse rate (%s)\n\n", optarg);
+            usage(EXIT_FAILURE);
+          }
+          break;
+        }
+      case 'K':
+        sparse_positions_filename = std::string(optarg);
+        break;
+      case 'C':
+        calibrate_filename = std::string(optarg);
+        break;
+      case 'H':
+        profile_filename = std::string(optarg);
+        break;
+      case 'S':
+        {
+          std::string what(optarg);
+          if (what != "sa" && what != "isa" && what != "both") {
+            fprintf(stderr, "Error: invalid sampled arrays (%s)\n\n", optarg);
+            usage(EXIT_FAILURE);
+          }
+          write_sa = (what != "isa");
+          write_isa = (what != "sa");
+          break;
+        }
+      case 'L':
+        {
+          bool ok = parse_number(optarg, &ram_limit);
+          if (!ok || ram_limit == 0) {
+            fprintf(stderr, "Error: parsing hard RAM "
+                "limit (%s) failed\n\n", optarg);
+            usage(EXIT_FAILURE);
+          }
+          break;
+        }
+      case 'N':
+        numa_local = true;
+        break;
+      case 'T':
+        {
+          std::string mode(optarg);
+          if (mode == "none")
+            huge_pages = fsais_private::utils::huge_pages_none;
+          else if (mode == "thp")
+            huge_pages = fsais_private::utils::huge_pages_transparent;
+          else if (mode == "hugetlb")
+            huge_pages = fsais_private::utils::huge_pages_hugetlb;
+          else {
+            fprintf(stderr, "Error: invalid huge pages mode (%s)\n\n", optarg);
+            usage(EXIT_FAILURE);
+          }
+          break;
+        }
       default:
         usage(EXIT_FAILURE);
         break;
     }
   }
 
+  if (!calibrate_filename.empty()) {
+    fsais_private::hardware_profile::calibrate(calibrate_filename);
+    std::exit(EXIT_SUCCESS);
+  }
+
   if (optind >= argc) {
     fprintf(stderr, "Error: FILE not provided\n\n");
     usage(EXIT_FAILURE);
@@ -197,14 +434,80 @@ int main(int argc, char **argv) {
   }
 
   // TODO: eliminate hardcoded values/types.
-  typedef std::uint8_t/*std::uint32_t*/ char_type;
   typedef uint40 text_offset_type;
-  std::uint64_t text_alphabet_size = 256/*100000000*/;
+  if (text_alphabet_size > (1UL << (8 * symbol_bytes))) {
+    fprintf(stderr, "Error: alphabet size (%lu) too large for %lu-byte "
+        "symbols\n\n", text_alphabet_size, symbol_bytes);
+    usage(EXIT_FAILURE);
+  }
+  // A user-supplied alphabet size smaller than the number
+  // of distinct symbol values is checked against the text.
+  bool check_alphabet_size = (text_alphabet_size > 0 &&
+      text_alphabet_size < (1UL << (8 * symbol_bytes)));
+  if (text_alphabet_size == 0 && symbol_bytes == 1)
+    text_alphabet_size = 256;
 
   // Set default output filename (if not provided).
+  std::string output_type_suffix = pack_output ?
+    std::string("p") : intToStr(sizeof(text_offset_type));
+  bool sparse = (sparse_rate > 0 || !sparse_positions_filename.empty());
   if (output_filename.empty())
-    output_filename = text_filename + ".sa" +
-        intToStr(sizeof(text_offset_type));
+    output_filename = text_filename + (sparse ? ".spsa" :
+        ((sample_rate > 1) ? ".ssa" : ".sa")) + output_type_suffix;
+
+  // Set the LCP and ISA filenames.
+  std::string lcp_filename("");
+  if (compute_lcp) {
+    if (sample_rate > 1 || !write_sa || pack_output) {
+      fprintf(stderr, "Error: the LCP array requires the full (not "
+          "packed) suffix array\n\n");
+      usage(EXIT_FAILURE);
+    }
+    lcp_filename = text_filename + ".lcp" + intToStr(lcp_width);
+  }
+  std::string isa_filename("");
+  if (write_isa)
+    isa_filename = text_filename + ((sample_rate > 1) ? ".sisa" : ".isa") +
+        output_type_suffix;
+
+  // Set the document array filename.
+  bool collection = (file_list || !offsets_filename.empty());
+  if (file_list && !offsets_filename.empty()) {
+    fprintf(stderr, "Error: flags -f and -d cannot be used together\n\n");
+    usage(EXIT_FAILURE);
+  }
+  if (collection && symbol_bytes > 1) {
+    fprintf(stderr, "Error: documents must consist of 1-byte symbols\n\n");
+    usage(EXIT_FAILURE);
+  }
+  if (write_da && !collection) {
+    fprintf(stderr, "Error: the document array requires a document "
+        "collection (-f or -d)\n\n");
+    usage(EXIT_FAILURE);
+  }
+  std::string da_filename("");
+  if (!old_sa_filename.empty() && (collection || compute_lcp || sample_rate > 1 ||
+        !write_sa || write_isa || pack_output || compact_alphabet ||
+        !bwt_filename.empty() || !stats_json_filename.empty() ||
+        !progress_filename.empty())) {
+    fprintf(stderr, "Error: the update of the suffix array (-u) only "
+        "supports the full (not packed) suffix array as output\n\n");
+    usage(EXIT_FAILURE);
+  }
+  if (sparse && (sparse_rate > 0) == !sparse_positions_filename.empty()) {
+    fprintf(stderr, "Error: flags -k and -K cannot be used together\n\n");
+    usage(EXIT_FAILURE);
+  }
+  if (sparse && (collection || compute_lcp || sample_rate > 1 || !write_sa ||
+        write_isa || !old_sa_filename.empty() || (sparse_rate > 0 &&
+          (compact_alphabet || !bwt_filename.empty())))) {
+    fprintf(stderr, "Error: the sparse suffix array cannot be combined with "
+        "other outputs (except -b and -c for -K) or flags -f, -d, -u\n\n");
+    usage(EXIT_FAILURE);
+  }
+  if (write_da)
+    da_filename = text_filename + ((sample_rate > 1) ? ".sda" : ".da") +
+        output_type_suffix;
 
   // Check for the existence of text.
   if (!file_exists(text_filename)) {
@@ -212,8 +515,23 @@ int main(int argc, char **argv) {
         text_filename.c_str());
     usage(EXIT_FAILURE);
   }
+  if (!collection && fsais_private::utils::file_size(text_filename) % symbol_bytes) {
+    fprintf(stderr, "Error: the size of input file (%s) is not a multiple "
+        "of the symbol size\n\n", text_filename.c_str());
+    usage(EXIT_FAILURE);
+  }
+  if (!profile_filename.empty() && !file_exists(profile_filename)) {
+    fprintf(stderr, "Error: hardware profile (%s) does not exist\n\n",
+        profile_filename.c_str());
+    usage(EXIT_FAILURE);
+  }
+  if (!old_sa_filename.empty() && !file_exists(old_sa_filename)) {
+    fprintf(stderr, "Error: old suffix array (%s) does not exist\n\n",
+        old_sa_filename.c_str());
+    usage(EXIT_FAILURE);
+  }
 
-  if (file_exists(output_filename)) {
+  if (write_sa && file_exists(output_filename)) {
 
     // Output file exists, should we proceed?
     char *line = NULL;
@@ -237,11 +555,121 @@ int main(int argc, char **argv) {
     free(line);
   }
 
-  fsais_private::em_compute_sa<
-    char_type,
-    text_offset_type>(
+  fsais_private::utils::set_ram_limit(ram_limit);
+  fsais_private::utils::set_huge_pages(huge_pages);
+  if (numa_local)
+    fsais_private::utils::set_numa_policy(fsais_private::utils::numa_local);
+  if (!profile_filename.empty())
+    fsais_private::hardware_profile::load(profile_filename);
+
+  // The alphabet compaction pass checks the symbols itself.
+  if (check_alphabet_size && !collection && !(compact_alphabet &&
+        sparse_rate == 0 && old_sa_filename.empty())) {
+    if (symbol_bytes == 1)
+      fsais_private::em_check_alphabet_size<std::uint8_t>(
+          text_alphabet_size, text_filename);
+    else if (symbol_bytes == 2)
+      fsais_private::em_check_alphabet_size<std::uint16_t>(
+          text_alphabet_size, text_filename);
+    else
+      fsais_private::em_check_alphabet_size<std::uint32_t>(
+          text_alphabet_size, text_filename);
+  }
+
+  if (collection) {
+    std::vector<std::string> document_filenames;
+    std::vector<std::uint64_t> doc_offsets;
+    if (file_list)
+      document_filenames = fsais_private::read_document_filenames(text_filename);
+    else {
+      document_filenames.push_back(text_filename);
+      doc_offsets = fsais_private::read_document_offsets(offsets_filename,
+          fsais_private::utils::file_size(text_filename));
+    }
+    for (std::uint64_t j = 0; j < document_filenames.size(); ++j) {
+      if (!file_exists(document_filenames[j])) {
+        fprintf(stderr, "Error: document (%s) does not exist\n\n",
+            document_filenames[j].c_str());
+        usage(EXIT_FAILURE);
+      }
+    }
+    fsais_private::em_compute_gsa<text_offset_type>(
         ram_use,
-        text_alphabet_size,
-        text_filename,
-        output_filename);
+        document_filenames,
+        doc_offsets,
+        output_filename,
+        da_filename,
+        stats_json_filename,
+        progress_filename,
+        bwt_filename,
+        lcp_filename,
+        lcp_width,
+        sample_rate,
+        write_sa,
+        isa_filename,
+        pack_output,
+        compact_alphabet);
+    return 0;
+  }
+
+  if (sparse_rate > 0) {
+    if (symbol_bytes == 1)
+      fsais_private::em_compute_sparse_sa<std::uint8_t, text_offset_type>(ram_use,
+          text_alphabet_size, sparse_rate, text_filename, output_filename,
+          stats_json_filename, progress_filename, pack_output);
+    else if (symbol_bytes == 2)
+      fsais_private::em_compute_sparse_sa<std::uint16_t, text_offset_type>(ram_use,
+          text_alphabet_size, sparse_rate, text_filename, output_filename,
+          stats_json_filename, progress_filename, pack_output);
+    else
+      fsais_private::em_compute_sparse_sa<std::uint32_t, text_offset_type>(ram_use,
+          text_alphabet_size, sparse_rate, text_filename, output_filename,
+          stats_json_filename, progress_filename, pack_output);
+    return 0;
+  }
+
+  std::uint64_t *sa_positions = NULL;
+  if (!sparse_positions_filename.empty()) {
+    if (!file_exists(sparse_positions_filename)) {
+      fprintf(stderr, "Error: bit vector of positions (%s) does not exist\n\n",
+          sparse_positions_filename.c_str());
+      usage(EXIT_FAILURE);
+    }
+    sa_positions = fsais_private::read_sparse_positions(sparse_positions_filename,
+        fsais_private::utils::file_size(text_filename) / symbol_bytes);
+  }
+
+  if (!old_sa_filename.empty()) {
+    if (symbol_bytes == 1)
+      fsais_private::em_update_sa<std::uint8_t, text_offset_type>(ram_use,
+          text_alphabet_size, text_filename, old_sa_filename, output_filename);
+    else if (symbol_bytes == 2)
+      fsais_private::em_update_sa<std::uint16_t, text_offset_type>(ram_use,
+          text_alphabet_size, text_filename, old_sa_filename, output_filename);
+    else
+      fsais_private::em_update_sa<std::uint32_t, text_offset_type>(ram_use,
+          text_alphabet_size, text_filename, old_sa_filename, output_filename);
+    return 0;
+  }
+
+  if (symbol_bytes == 1)
+    fsais_private::em_compute_sa<std::uint8_t, text_offset_type>(ram_use,
+        text_alphabet_size, text_filename, output_filename, stats_json_filename,
+        progress_filename, bwt_filename, lcp_filename, lcp_width, sample_rate,
+        write_sa, isa_filename, pack_output, std::string(""), NULL, compact_alphabet,
+        sa_positions);
+  else if (symbol_bytes == 2)
+    fsais_private::em_compute_sa<std::uint16_t, text_offset_type>(ram_use,
+        text_alphabet_size, text_filename, output_filename, stats_json_filename,
+        progress_filename, bwt_filename, lcp_filename, lcp_width, sample_rate,
+        write_sa, isa_filename, pack_output, std::string(""), NULL, compact_alphabet,
+        sa_positions);
+  else
+    fsais_private::em_compute_sa<std::uint32_t, text_offset_type>(ram_use,
+        text_alphabet_size, text_filename, output_filename, stats_json_filename,
+        progress_filename, bwt_filename, lcp_filename, lcp_width, sample_rate,
+        write_sa, isa_filename, pack_output, std::string(""), NULL, compact_alphabet,
+        sa_positions);
+  if (sa_positions != NULL)
+    fsais_private::utils::deallocate(sa_positions);
 }
@@ -0,0 +1,252 @@
+/**
+ * @file    src/verify_sa.cpp
+ * @section LICENCE
+ *
+ * This file is part of fSAIS v0.1.0
+ * See: https://github.com/dominikkempa/fsais
+ *
+ * Copyright (C) 2016-2020
+ *   Dominik Kempa <dominik.kempa (at) gmail.com>
+ *   Juha Karkkainen <juha.karkkainen (at) cs.helsinki.fi>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ **/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <ctime>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <algorithm>
+#include <getopt.h>
+#include <unistd.h>
+
+#include "fsais_src/em_verify_sa.hpp"
+#include "uint40.hpp"
+
+
+char *program_name;
+
+void usage(int status) {
+  printf(
+
+"Usage: %s [OPTION]... FILE SAFILE\n"
+"Check that SAFILE contains the suffix array of text stored in FILE.\n"
+"\n"
+"Mandatory arguments to long options are mandatory for short options too.\n"
+"  -B, --symbol-bytes=B    the text consists of B-byte symbols (B = 1, 2 or 4,\n"
+"                          little-endian). Default: 1\n"
+"  -h, --help              display this help and exit\n"
+"  -m, --mem=MEM           use MEM bytes of RAM for computation. Metric and IEC\n"
+"                          suffixes are recognized, e.g., -m 10k, -m 1Mi, -m 3G\n"
+"                          gives MEM = 10^4, 2^20, 3*10^6. Default: 3584Mi\n"
+"  -t, --threads=T         process text blocks using T threads. Default: the\n"
+"                          number of hardware threads\n",
+
+    program_name);
+
+  std::exit(status);
+}
+
+bool file_exists(std::string filename) {
+  std::FILE *f = std::fopen(filename.c_str(), "r");
+  bool ret = (f != NULL);
+  if (f != NULL) std::fclose(f);
+
+  return ret;
+}
+
+template<typename int_type>
+bool parse_number(char *str, int_type *ret) {
+  *ret = 0;
+  std::uint64_t n_digits = 0;
+  std::uint64_t str_len = std::strlen(str);
+  while (n_digits < str_len && std::isdigit(str[n_digits])) {
+    std::uint64_t digit = str[n_digits] - '0';
+    *ret = (*ret) * 10 + digit;
+    ++n_digits;
+  }
+
+  if (n_digits == 0)
+    return false;
+
+  std::uint64_t suffix_length = str_len - n_digits;
+  if (suffix_length > 0) {
+    if (suffix_length > 2)
+      return false;
+
+    for (std::uint64_t j = 0; j < suffix_length; ++j)
+      str[n_digits + j] = std::tolower(str[n_digits + j]);
+    if (suffix_length == 2 && str[n_digits + 1] != 'i')
+      return false;
+
+    switch(str[n_digits]) {
+      case 'k':
+        if (suffix_length == 1)
+          *ret *= 1000;
+        else
+          *ret <<= 10;
+        break;
+      case 'm':
+        if (suffix_length == 1)
+          *ret *= 1000000;
+        else
+          *ret <<= 20;
+        break;
+      case 'g':
+        if (suffix_length == 1)
+          *ret *= 1000000000;
+        else
+          *ret <<= 30;
+        break;
+      case 't':
+        if (suffix_length == 1)
+          *ret *= 1000000000000;
+        else
+          *ret <<= 40;
+        break;
+      default:
+        return false;
+    }
+  }
+
+  return true;
+}
+
+int main(int argc, char **argv) {
+  srand(time(0) + getpid());
+  program_name = argv[0];
+
+  static struct option long_options[] = {
+    {"symbol-bytes", required_argument, NULL, 'B'},
+    {"help",     no_argument,       NULL, 'h'},
+    {"mem",      required_argument, NULL, 'm'},
+    {"threads",  required_argument, NULL, 't'},
+    {NULL,       0,                 NULL, 0}
+  };
+
+  std::uint64_t ram_use = ((std::uint64_t)3584 << 20);
+  std::uint64_t symbol_bytes = 1;
+  std::uint64_t n_threads = std::max(1U, std::thread::hardware_concurrency());
+
+  // Parse command-line options.
+  int c;
+  while ((c = getopt_long(argc, argv, "B:hm:t:",
+          long_options, NULL)) != -1) {
+    switch(c) {
+      case 'B':
+        {
+          bool ok = parse_number(optarg, &symbol_bytes);
+          if (!ok || (symbol_bytes != 1 && symbol_bytes != 2 && symbol_bytes != 4)) {
+            fprintf(stderr, "Error: invalid symbol size (%s)\n\n", optarg);
+            usage(EXIT_FAILURE);
+          }
+          break;
+        }
+      case 'h':
+        usage(EXIT_FAILURE);
+        break;
+      case 'm':
+        {
+          bool ok = parse_number(optarg, &ram_use);
+          if (!ok) {
+            fprintf(stderr, "Error: parsing RAM "
+                "limit (%s) failed\n\n", optarg);
+            usage(EXIT_FAILURE);
+          }
+          if (ram_use == 0) {
+            fprintf(stderr, "Error: invalid RAM limit (%lu)\n\n", ram_use);
+            usage(EXIT_FAILURE);
+          }
+          break;
+        }
+      case 't':
+        {
+          bool ok = parse_number(optarg, &n_threads);
+          if (!ok || n_threads == 0) {
+            fprintf(stderr, "Error: invalid number of threads (%s)\n\n", optarg);
+            usage(EXIT_FAILURE);
+          }
+          break;
+        }
+      default:
+        usage(EXIT_FAILURE);
+        break;
+    }
+  }
+
+  if (optind + 1 >= argc) {
+    fprintf(stderr, "Error: FILE or SAFILE not provided\n\n");
+    usage(EXIT_FAILURE);
+  }
+
+  // Parse the text and SA filenames.
+  std::string text_filename = std::string(argv[optind++]);
+  std::string sa_filename = std::string(argv[optind++]);
+
+  // TODO: eliminate hardcoded values/types.
+  typedef uint40 text_offset_type;
+
+  // Check for the existence of files.
+  if (!file_exists(text_filename)) {
+    fprintf(stderr, "Error: input file (%s) does not exist\n\n",
+        text_filename.c_str());
+    usage(EXIT_FAILURE);
+  }
+  if (!file_exists(sa_filename)) {
+    fprintf(stderr, "Error: SA file (%s) does not exist\n\n",
+        sa_filename.c_str());
+    usage(EXIT_FAILURE);
+  }
+
+  if (fsais_private::utils::file_size(text_filename) % symbol_bytes) {
+    fprintf(stderr, "Error: the size of input file (%s) is not a multiple "
+        "of the symbol size\n\n", text_filename.c_str());
+    usage(EXIT_FAILURE);
+  }
+
+  std::uint64_t text_length =
+    fsais_private::utils::file_size(text_filename) / symbol_bytes;
+  std::uint64_t first_violation = 0;
+  if (symbol_bytes == 1)
+    first_violation = fsais_private::em_verify_sa<std::uint8_t, text_offset_type>(
+        ram_use, n_threads, text_filename, sa_filename);
+  else if (symbol_bytes == 2)
+    first_violation = fsais_private::em_verify_sa<std::uint16_t, text_offset_type>(
+        ram_use, n_threads, text_filename, sa_filename);
+  else
+    first_violation = fsais_private::em_verify_sa<std::uint32_t, text_offset_type>(
+        ram_use, n_threads, text_filename, sa_filename);
+
+  if (first_violation == text_length &&
+      fsais_private::utils::file_size(sa_filename) ==
+      text_length * sizeof(text_offset_type)) {
+    fprintf(stderr, "Result: OK\n");
+    return EXIT_SUCCESS;
+  } else {
+    fprintf(stderr, "Result: FAILED (check fails at SA position %lu)\n",
+        first_violation);
+    return EXIT_FAILURE;
+  }
+}